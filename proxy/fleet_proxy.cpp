@@ -0,0 +1,1495 @@
+// =============================================================================
+// FLEET PROXY - One AccuWeather request per location, shared by every device
+// =============================================================================
+// Each satellite looks up its postal code and fetches its forecast itself, so
+// a dozen of them showing the same town spend the API quota a dozen times.
+// This service sits in front of the API on the LAN instead: the first device
+// to ask for a location or forecast makes the one upstream request, and the
+// rest get the cached answer until its TTL runs out. Devices asking while
+// that request is out wait for it rather than making their own.
+//
+// Answers are trimmed to the fields the firmware reads (the filters in
+// fetchAccuWeatherLocation() and parseForecast() in src/main.cpp) and sent as
+// compact JSON, or as MessagePack to a client that accepts it. Each has an
+// ETag and a max-age of the time left in the cache, so a device revalidates
+// with a 304 instead of downloading it again.
+//
+// Point the firmware at it as at the replay server: -DWEATHER_BASE_URL=
+// \"http://<host>:8080\" or the setup portal's weather server field. The
+// proxy uses its own API key; whatever devices send is not passed on.
+//
+// Build and run (Linux; needs the OpenSSL headers, libssl-dev on Debian):
+//   g++ -std=c++17 -O2 -pthread proxy/fleet_proxy.cpp -o fleet_proxy -lssl -lcrypto
+//   ACCUWEATHER_API_KEY=... ./fleet_proxy
+//   ./fleet_proxy --offline
+//
+// Options:
+//   --port N            Listen on port N (8080)
+//   --upstream URL      API base URL (https://dataservice.accuweather.com);
+//                       http:// works too, e.g. for test/replay_server, but
+//                       then the API key is not sent
+//   --api-key KEY       API key (ACCUWEATHER_API_KEY from the environment);
+//                       needed for an https:// upstream
+//   --offline           No network: every location and forecast is the
+//                       recording in --fixtures
+//   --fixtures DIR      Recordings for --offline (test/fixtures)
+//   --location-ttl S    How long a location lookup is kept (86400)
+//   --forecast-ttl S    How long a forecast is kept (1800)
+//   --error-ttl S       How long an upstream error is kept, so devices
+//                       retrying don't spend quota either (60)
+//   --stale S           How long past its TTL an answer is still served while
+//                       the API fails (21600)
+//
+// GET /metrics reports requests, cache hits and upstream requests per
+// endpoint in the Prometheus text format.
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Options
+{
+  uint16_t port = 8080;
+  std::string upstream = "https://dataservice.accuweather.com";
+  std::string apiKey;
+  bool offline = false;
+  std::string fixturesDir = "test/fixtures";
+  uint32_t locationTtl = 86400;
+  uint32_t forecastTtl = 1800;
+  uint32_t errorTtl = 60;
+  uint32_t stale = 21600;
+};
+
+// Where upstream requests go, split from --upstream
+struct Upstream
+{
+  bool tls = true;
+  std::string host;
+  uint16_t port = 443;
+  std::string pathPrefix;  // Without a trailing slash
+};
+
+// =============================================================================
+// JSON
+// =============================================================================
+
+enum JsonType : uint8_t
+{
+  JSON_NULL,
+  JSON_BOOL,
+  JSON_NUMBER,
+  JSON_STRING,
+  JSON_ARRAY,
+  JSON_OBJECT
+};
+
+// A parsed JSON value. Numbers keep the text they were written as, so the
+// compact JSON has exactly the digits the API sent.
+struct Value
+{
+  JsonType type = JSON_NULL;
+  bool boolean = false;
+  std::string text;  // String contents, unescaped, or the number
+  std::vector<Value> items;
+  std::vector<std::pair<std::string, Value>> members;  // In the order received
+};
+
+class JsonParser
+{
+public:
+  explicit JsonParser(const std::string &text) : text_(text) {}
+
+  // The whole text as one value; false on a syntax error or anything after it
+  bool parse(Value &out)
+  {
+    if (!parseValue(out, 0))
+    {
+      return false;
+    }
+    skipSpace();
+    return pos_ == text_.size();
+  }
+
+private:
+  static const int MAX_DEPTH = 32;
+
+  const std::string &text_;
+  size_t pos_ = 0;
+
+  static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+  static bool isNumberChar(char c)
+  {
+    return isdigit((unsigned char)c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-';
+  }
+
+  void skipSpace()
+  {
+    while (pos_ < text_.size() && isSpace(text_[pos_]))
+    {
+      pos_++;
+    }
+  }
+
+  bool consume(char c)
+  {
+    skipSpace();
+    if (pos_ < text_.size() && text_[pos_] == c)
+    {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool literal(const char *word)
+  {
+    size_t len = strlen(word);
+    if (text_.compare(pos_, len, word) != 0)
+    {
+      return false;
+    }
+    pos_ += len;
+    return true;
+  }
+
+  bool parseValue(Value &out, int depth)
+  {
+    skipSpace();
+    if (pos_ >= text_.size() || depth > MAX_DEPTH)
+    {
+      return false;
+    }
+    char c = text_[pos_];
+    if (c == '{')
+    {
+      return parseObject(out, depth);
+    }
+    if (c == '[')
+    {
+      return parseArray(out, depth);
+    }
+    if (c == '"')
+    {
+      out.type = JSON_STRING;
+      return parseString(out.text);
+    }
+    if (literal("true"))
+    {
+      out.type = JSON_BOOL;
+      out.boolean = true;
+      return true;
+    }
+    if (literal("false"))
+    {
+      out.type = JSON_BOOL;
+      return true;
+    }
+    if (literal("null"))
+    {
+      out.type = JSON_NULL;
+      return true;
+    }
+    return parseNumber(out);
+  }
+
+  bool parseObject(Value &out, int depth)
+  {
+    out.type = JSON_OBJECT;
+    pos_++;  // '{'
+    if (consume('}'))
+    {
+      return true;
+    }
+    do
+    {
+      std::string key;
+      Value member;
+      skipSpace();
+      if (pos_ >= text_.size() || text_[pos_] != '"' || !parseString(key) || !consume(':') ||
+          !parseValue(member, depth + 1))
+      {
+        return false;
+      }
+      out.members.emplace_back(std::move(key), std::move(member));
+    } while (consume(','));
+    return consume('}');
+  }
+
+  bool parseArray(Value &out, int depth)
+  {
+    out.type = JSON_ARRAY;
+    pos_++;  // '['
+    if (consume(']'))
+    {
+      return true;
+    }
+    do
+    {
+      Value item;
+      if (!parseValue(item, depth + 1))
+      {
+        return false;
+      }
+      out.items.push_back(std::move(item));
+    } while (consume(','));
+    return consume(']');
+  }
+
+  // Loosely: a digit (after an optional minus) and then whatever strtod()
+  // takes as the rest of one number
+  bool parseNumber(Value &out)
+  {
+    size_t start = pos_;
+    while (pos_ < text_.size() && isNumberChar(text_[pos_]))
+    {
+      pos_++;
+    }
+    std::string number = text_.substr(start, pos_ - start);
+    size_t firstDigit = (!number.empty() && number[0] == '-') ? 1 : 0;
+    if (number.size() <= firstDigit || !isdigit((unsigned char)number[firstDigit]))
+    {
+      return false;
+    }
+    char *end;
+    strtod(number.c_str(), &end);
+    if (*end != '\0')
+    {
+      return false;
+    }
+    out.type = JSON_NUMBER;
+    out.text = number;
+    return true;
+  }
+
+  bool parseHex4(uint32_t &out)
+  {
+    if (pos_ + 4 > text_.size())
+    {
+      return false;
+    }
+    out = 0;
+    for (int i = 0; i < 4; i++)
+    {
+      char c = text_[pos_++];
+      out <<= 4;
+      if (c >= '0' && c <= '9') out |= (uint32_t)(c - '0');
+      else if (c >= 'a' && c <= 'f') out |= (uint32_t)(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F') out |= (uint32_t)(c - 'A' + 10);
+      else return false;
+    }
+    return true;
+  }
+
+  static void appendUtf8(uint32_t code, std::string &out)
+  {
+    if (code < 0x80)
+    {
+      out += (char)code;
+    }
+    else if (code < 0x800)
+    {
+      out += (char)(0xC0 | (code >> 6));
+      out += (char)(0x80 | (code & 0x3F));
+    }
+    else if (code < 0x10000)
+    {
+      out += (char)(0xE0 | (code >> 12));
+      out += (char)(0x80 | ((code >> 6) & 0x3F));
+      out += (char)(0x80 | (code & 0x3F));
+    }
+    else
+    {
+      out += (char)(0xF0 | (code >> 18));
+      out += (char)(0x80 | ((code >> 12) & 0x3F));
+      out += (char)(0x80 | ((code >> 6) & 0x3F));
+      out += (char)(0x80 | (code & 0x3F));
+    }
+  }
+
+  bool parseString(std::string &out)
+  {
+    pos_++;  // Opening quote
+    while (pos_ < text_.size())
+    {
+      unsigned char c = (unsigned char)text_[pos_++];
+      if (c == '"')
+      {
+        return true;
+      }
+      if (c < 0x20)
+      {
+        return false;
+      }
+      if (c != '\\')
+      {
+        out += (char)c;
+        continue;
+      }
+      if (pos_ >= text_.size())
+      {
+        return false;
+      }
+      char escape = text_[pos_++];
+      switch (escape)
+      {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u':
+        {
+          uint32_t code;
+          if (!parseHex4(code))
+          {
+            return false;
+          }
+          // A high surrogate needs its low half to make one code point
+          if (code >= 0xD800 && code < 0xDC00)
+          {
+            uint32_t low;
+            if (!literal("\\u") || !parseHex4(low) || low < 0xDC00 || low >= 0xE000)
+            {
+              return false;
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+          }
+          else if (code >= 0xDC00 && code < 0xE000)
+          {
+            return false;
+          }
+          appendUtf8(code, out);
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+    return false;  // Unterminated
+  }
+};
+
+// What ArduinoJson's DeserializationOption::Filter keeps: the object members
+// the filter names (true keeps the whole value, an object filters it
+// further) and every array element through the filter's first element.
+// Anything else becomes null.
+Value applyFilter(const Value &value, const Value &filter)
+{
+  if (filter.type == JSON_BOOL)
+  {
+    return filter.boolean ? value : Value();
+  }
+  Value out;
+  if (filter.type == JSON_OBJECT && value.type == JSON_OBJECT)
+  {
+    out.type = JSON_OBJECT;
+    for (const auto &member : value.members)
+    {
+      for (const auto &wanted : filter.members)
+      {
+        if (wanted.first == member.first)
+        {
+          out.members.emplace_back(member.first, applyFilter(member.second, wanted.second));
+          break;
+        }
+      }
+    }
+  }
+  else if (filter.type == JSON_ARRAY && value.type == JSON_ARRAY && !filter.items.empty())
+  {
+    out.type = JSON_ARRAY;
+    for (const Value &item : value.items)
+    {
+      out.items.push_back(applyFilter(item, filter.items[0]));
+    }
+  }
+  return out;
+}
+
+void writeJsonString(const std::string &text, std::string &out)
+{
+  out += '"';
+  for (unsigned char c : text)
+  {
+    if (c == '"' || c == '\\')
+    {
+      out += '\\';
+      out += (char)c;
+    }
+    else if (c < 0x20)
+    {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    }
+    else
+    {
+      out += (char)c;
+    }
+  }
+  out += '"';
+}
+
+// Compact JSON, no whitespace
+void writeJson(const Value &value, std::string &out)
+{
+  switch (value.type)
+  {
+    case JSON_NULL:
+      out += "null";
+      break;
+    case JSON_BOOL:
+      out += value.boolean ? "true" : "false";
+      break;
+    case JSON_NUMBER:
+      out += value.text;
+      break;
+    case JSON_STRING:
+      writeJsonString(value.text, out);
+      break;
+    case JSON_ARRAY:
+      out += '[';
+      for (size_t i = 0; i < value.items.size(); i++)
+      {
+        if (i > 0) out += ',';
+        writeJson(value.items[i], out);
+      }
+      out += ']';
+      break;
+    case JSON_OBJECT:
+      out += '{';
+      for (size_t i = 0; i < value.members.size(); i++)
+      {
+        if (i > 0) out += ',';
+        writeJsonString(value.members[i].first, out);
+        out += ':';
+        writeJson(value.members[i].second, out);
+      }
+      out += '}';
+      break;
+  }
+}
+
+// =============================================================================
+// MESSAGEPACK - The same encoding as tools/json_to_msgpack.py
+// =============================================================================
+
+void appendBigEndian(std::string &out, uint64_t value, int bytes)
+{
+  for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8)
+  {
+    out += (char)((value >> shift) & 0xFF);
+  }
+}
+
+void packTag(std::string &out, uint8_t tag, uint64_t value, int bytes)
+{
+  out += (char)tag;
+  appendBigEndian(out, value, bytes);
+}
+
+// fixarray/fixmap up to 15 entries, then the 16- and 32-bit forms
+void packLength(std::string &out, size_t length, uint8_t fix, uint8_t wide16)
+{
+  if (length < 16) out += (char)(fix | length);
+  else if (length < 0x10000) packTag(out, wide16, length, 2);
+  else packTag(out, wide16 + 1, length, 4);
+}
+
+void packString(std::string &out, const std::string &text)
+{
+  size_t len = text.size();
+  if (len < 32) out += (char)(0xA0 | len);
+  else if (len < 0x100) packTag(out, 0xD9, len, 1);
+  else if (len < 0x10000) packTag(out, 0xDA, len, 2);
+  else packTag(out, 0xDB, len, 4);
+  out += text;
+}
+
+// Integers take the smallest encoding; anything with a fraction or exponent
+// is a float32 when that holds it exactly (as ArduinoJson's
+// serializeMsgPack() does), else a float64
+void packNumber(std::string &out, const std::string &text)
+{
+  if (text.find_first_of(".eE") == std::string::npos)
+  {
+    errno = 0;
+    long long value = strtoll(text.c_str(), nullptr, 10);
+    if (errno == 0)
+    {
+      if (value >= 0 && value < 0x80) out += (char)value;
+      else if (value >= -32 && value < 0) out += (char)(value & 0xFF);
+      else if (value >= 0 && value < 0x100) packTag(out, 0xCC, (uint64_t)value, 1);
+      else if (value >= 0 && value < 0x10000) packTag(out, 0xCD, (uint64_t)value, 2);
+      else if (value >= 0 && value < 0x100000000LL) packTag(out, 0xCE, (uint64_t)value, 4);
+      else if (value >= 0) packTag(out, 0xCF, (uint64_t)value, 8);
+      else if (value >= -0x80) packTag(out, 0xD0, (uint64_t)value & 0xFF, 1);
+      else if (value >= -0x8000) packTag(out, 0xD1, (uint64_t)value & 0xFFFF, 2);
+      else if (value >= -0x80000000LL) packTag(out, 0xD2, (uint64_t)value & 0xFFFFFFFF, 4);
+      else packTag(out, 0xD3, (uint64_t)value, 8);
+      return;
+    }
+    // Out of int64 range: a double, like the rest
+  }
+  double value = strtod(text.c_str(), nullptr);
+  float narrow = (float)value;
+  if ((double)narrow == value)
+  {
+    uint32_t bits;
+    memcpy(&bits, &narrow, sizeof(bits));
+    packTag(out, 0xCA, bits, 4);
+  }
+  else
+  {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    packTag(out, 0xCB, bits, 8);
+  }
+}
+
+void writeMsgPack(const Value &value, std::string &out)
+{
+  switch (value.type)
+  {
+    case JSON_NULL:
+      out += (char)0xC0;
+      break;
+    case JSON_BOOL:
+      out += (char)(value.boolean ? 0xC3 : 0xC2);
+      break;
+    case JSON_NUMBER:
+      packNumber(out, value.text);
+      break;
+    case JSON_STRING:
+      packString(out, value.text);
+      break;
+    case JSON_ARRAY:
+      packLength(out, value.items.size(), 0x90, 0xDC);
+      for (const Value &item : value.items)
+      {
+        writeMsgPack(item, out);
+      }
+      break;
+    case JSON_OBJECT:
+      packLength(out, value.members.size(), 0x80, 0xDE);
+      for (const auto &member : value.members)
+      {
+        packString(out, member.first);
+        writeMsgPack(member.second, out);
+      }
+      break;
+  }
+}
+
+// =============================================================================
+// CACHE
+// =============================================================================
+
+struct Representation
+{
+  std::string body;
+  std::string etag;
+};
+
+// One cached answer. While `fetching`, a request for it is out upstream and
+// everyone else wanting it waits on `ready`.
+struct Entry
+{
+  bool fetching = false;
+  uint32_t waiters = 0;  // Keeps it in the cache until they have their answer
+  bool filled = false;
+  int status = 0;
+  Representation json;
+  Representation msgpack;  // Only for a 200
+  Clock::time_point freshUntil;
+  Clock::time_point usableUntil;  // A 200 stands in for failed refreshes until then
+  std::condition_variable ready;
+};
+
+// What a request is answered with, copied out of the cache
+struct Answer
+{
+  int status = 0;
+  Representation json;
+  Representation msgpack;
+  uint32_t maxAge = 0;
+  const char *source = "";  // For the log: hit, shared, fetched, stale or error
+};
+
+struct Endpoint
+{
+  const char *name;     // Label on /metrics
+  const char *prefix;   // Request paths it answers
+  const char *fixture;  // Recording for --offline
+  const char *filterText;
+  uint32_t ttl;
+  Value filter;
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> hits{0};      // From the cache
+  std::atomic<uint64_t> shared{0};    // Waited for another device's upstream request
+  std::atomic<uint64_t> upstream{0};  // Upstream requests made
+  std::atomic<uint64_t> upstreamErrors{0};
+  std::atomic<uint64_t> stale{0};     // Old answers served because the refresh failed
+};
+
+const uint32_t IDLE_TIMEOUT_S = 30;      // Close a kept-alive connection idle this long
+const uint32_t UPSTREAM_TIMEOUT_S = 15;  // Connect, send and each receive
+const size_t MAX_REQUEST_HEADER = 8192;
+
+// The fields the firmware reads; keep these in step with src/main.cpp
+const char *LOCATION_FILTER =
+    R"([{"Key":true,"TimeZone":{"Name":true,"GmtOffset":true,"IsDaylightSaving":true,"NextOffsetChange":true}}])";
+const char *FORECAST_FILTER =
+    R"({"DailyForecasts":[{"Date":true,"Day":{"Icon":true},)"
+    R"("Temperature":{"Minimum":{"Value":true},"Maximum":{"Value":true}}}]})";
+
+Options options;
+Upstream upstream;
+SSL_CTX *tlsContext = nullptr;
+Endpoint endpoints[] = {
+    {"location", "/locations/v1/postalcodes/search", "location.json", LOCATION_FILTER, 0, {}},
+    {"forecast", "/forecasts/v1/daily/5day/", "forecast_5day.json", FORECAST_FILTER, 0, {}},
+};
+
+std::mutex cacheMutex;
+std::map<std::string, Entry> cache;  // By request target, less any apikey
+std::atomic<uint32_t> requestCount{0};
+
+bool parseUint(const char *text, uint32_t &out)
+{
+  char *end;
+  unsigned long value = strtoul(text, &end, 10);
+  if (end == text || *end != '\0' || value > UINT32_MAX)
+  {
+    return false;
+  }
+  out = (uint32_t)value;
+  return true;
+}
+
+bool parseOptions(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--offline")
+    {
+      options.offline = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      fprintf(stderr, "missing value for %s\n", arg.c_str());
+      return false;
+    }
+    const char *value = argv[++i];
+    bool ok = true;
+    if (arg == "--port")
+    {
+      uint32_t port = 0;
+      ok = parseUint(value, port) && port > 0 && port <= 65535;
+      options.port = (uint16_t)port;
+    }
+    else if (arg == "--upstream") options.upstream = value;
+    else if (arg == "--api-key") options.apiKey = value;
+    else if (arg == "--fixtures") options.fixturesDir = value;
+    else if (arg == "--location-ttl") ok = parseUint(value, options.locationTtl);
+    else if (arg == "--forecast-ttl") ok = parseUint(value, options.forecastTtl);
+    else if (arg == "--error-ttl") ok = parseUint(value, options.errorTtl);
+    else if (arg == "--stale") ok = parseUint(value, options.stale);
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", arg.c_str());
+      return false;
+    }
+    if (!ok)
+    {
+      fprintf(stderr, "bad value for %s: %s\n", arg.c_str(), value);
+      return false;
+    }
+  }
+  return true;
+}
+
+// http(s)://host[:port][/path], as the firmware's parseBaseUrl() takes it
+bool parseUpstream(const std::string &url, Upstream &out)
+{
+  size_t hostStart;
+  if (url.compare(0, 8, "https://") == 0)
+  {
+    out.tls = true;
+    out.port = 443;
+    hostStart = 8;
+  }
+  else if (url.compare(0, 7, "http://") == 0)
+  {
+    out.tls = false;
+    out.port = 80;
+    hostStart = 7;
+  }
+  else
+  {
+    return false;
+  }
+  size_t hostEnd = url.find_first_of(":/", hostStart);
+  if (hostEnd == std::string::npos)
+  {
+    hostEnd = url.size();
+  }
+  out.host = url.substr(hostStart, hostEnd - hostStart);
+  if (out.host.empty() || url.find_first_of("?# ") != std::string::npos)
+  {
+    return false;
+  }
+  size_t pathStart = hostEnd;
+  if (hostEnd < url.size() && url[hostEnd] == ':')
+  {
+    pathStart = url.find('/', hostEnd);
+    if (pathStart == std::string::npos)
+    {
+      pathStart = url.size();
+    }
+    uint32_t port;
+    if (!parseUint(url.substr(hostEnd + 1, pathStart - hostEnd - 1).c_str(), port) || port == 0 || port > 65535)
+    {
+      return false;
+    }
+    out.port = (uint16_t)port;
+  }
+  out.pathPrefix = url.substr(pathStart);
+  while (!out.pathPrefix.empty() && out.pathPrefix.back() == '/')
+  {
+    out.pathPrefix.pop_back();
+  }
+  return true;
+}
+
+// FNV-1a of the body, quoted, as a strong ETag
+std::string etagOf(const std::string &body)
+{
+  uint64_t hash = 1469598103934665603ULL;
+  for (unsigned char c : body)
+  {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  char text[24];
+  snprintf(text, sizeof(text), "\"%016llx\"", (unsigned long long)hash);
+  return text;
+}
+
+std::string lower(std::string text)
+{
+  std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)tolower(c); });
+  return text;
+}
+
+// The request target without an apikey query parameter: the proxy sends its
+// own key, and devices with different keys share the cache entry
+std::string withoutApiKey(const std::string &target)
+{
+  size_t query = target.find('?');
+  if (query == std::string::npos)
+  {
+    return target;
+  }
+  std::string out = target.substr(0, query);
+  char separator = '?';
+  size_t start = query + 1;
+  while (start <= target.size())
+  {
+    size_t end = target.find('&', start);
+    if (end == std::string::npos)
+    {
+      end = target.size();
+    }
+    std::string param = target.substr(start, end - start);
+    if (!param.empty() && lower(param.substr(0, 7)) != "apikey=")
+    {
+      out += separator;
+      out += param;
+      separator = '&';
+    }
+    start = end + 1;
+  }
+  return out;
+}
+
+// Only printable ASCII, and no way out of the API's path
+bool validTarget(const std::string &target)
+{
+  for (unsigned char c : target)
+  {
+    if (c <= ' ' || c > '~')
+    {
+      return false;
+    }
+  }
+  return target.find("..") == std::string::npos;
+}
+
+// =============================================================================
+// UPSTREAM
+// =============================================================================
+
+struct UpstreamResponse
+{
+  int status = 0;  // 0 if there was no response
+  std::string body;
+  std::string error;  // Why there was no response
+};
+
+int connectTcp(const std::string &host, uint16_t port, std::string &error)
+{
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addresses = nullptr;
+  int result = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+  if (result != 0)
+  {
+    error = "cannot resolve " + host + ": " + gai_strerror(result);
+    return -1;
+  }
+  int fd = -1;
+  for (addrinfo *address = addresses; address; address = address->ai_next)
+  {
+    fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0)
+    {
+      continue;
+    }
+    timeval timeout = {UPSTREAM_TIMEOUT_S, 0};  // SO_SNDTIMEO bounds connect() too
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+    {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0)
+  {
+    error = "cannot connect to " + host + ":" + std::to_string(port) + ": " + strerror(errno);
+  }
+  return fd;
+}
+
+std::string tlsError()
+{
+  char text[256];
+  ERR_error_string_n(ERR_get_error(), text, sizeof(text));
+  return text;
+}
+
+// The status line and headers of a raw response, split from its body.
+// False if the body is shorter than its Content-Length.
+bool parseResponse(const std::string &raw, UpstreamResponse &out)
+{
+  size_t headerEnd = raw.find("\r\n\r\n");
+  if (headerEnd == std::string::npos || sscanf(raw.c_str(), "HTTP/%*d.%*d %d", &out.status) != 1)
+  {
+    out.status = 0;
+    out.error = "malformed response";
+    return false;
+  }
+  out.body = raw.substr(headerEnd + 4);
+  std::istringstream lines(raw.substr(0, headerEnd));
+  std::string line;
+  while (std::getline(lines, line))
+  {
+    if (lower(line.substr(0, 15)) == "content-length:" && out.body.size() < strtoull(line.c_str() + 15, nullptr, 10))
+    {
+      out.status = 0;
+      out.error = "response cut off after " + std::to_string(out.body.size()) + " body bytes";
+      return false;
+    }
+  }
+  return true;
+}
+
+// One GET to the API. HTTP/1.0 and a connection per request: a few requests
+// an hour for the whole fleet don't need keep-alive, and 1.0 rules out
+// chunked bodies.
+void fetchUpstream(const std::string &target, UpstreamResponse &out)
+{
+  int fd = connectTcp(upstream.host, upstream.port, out.error);
+  if (fd < 0)
+  {
+    return;
+  }
+  SSL *ssl = nullptr;
+  if (upstream.tls)
+  {
+    ssl = SSL_new(tlsContext);
+    SSL_set_fd(ssl, fd);
+    SSL_set_tlsext_host_name(ssl, upstream.host.c_str());
+    SSL_set1_host(ssl, upstream.host.c_str());
+    if (SSL_connect(ssl) != 1)
+    {
+      out.error = "TLS handshake with " + upstream.host + " failed: " + tlsError();
+      SSL_free(ssl);
+      close(fd);
+      return;
+    }
+  }
+
+  std::string request = "GET " + upstream.pathPrefix + target + " HTTP/1.0\r\nHost: " + upstream.host +
+                        "\r\nAccept: application/json\r\n";
+  if (upstream.tls)
+  {
+    request += "Authorization: Bearer " + options.apiKey + "\r\n";  // Never in cleartext, as on the device
+  }
+  request += "User-Agent: satellite-fleet-proxy\r\nConnection: close\r\n\r\n";
+  size_t sent = 0;
+  while (sent < request.size())
+  {
+    int wrote = ssl ? SSL_write(ssl, request.data() + sent, (int)(request.size() - sent))
+                    : (int)send(fd, request.data() + sent, request.size() - sent, 0);
+    if (wrote <= 0)
+    {
+      out.error = "cannot send the request to " + upstream.host;
+      break;
+    }
+    sent += (size_t)wrote;
+  }
+
+  // Read to the close; a missing close_notify is caught by Content-Length
+  std::string raw;
+  char chunk[4096];
+  while (out.error.empty())
+  {
+    int got = ssl ? SSL_read(ssl, chunk, sizeof(chunk)) : (int)recv(fd, chunk, sizeof(chunk), 0);
+    if (got <= 0)
+    {
+      break;
+    }
+    raw.append(chunk, (size_t)got);
+  }
+  if (ssl)
+  {
+    SSL_free(ssl);
+  }
+  close(fd);
+  if (out.error.empty())
+  {
+    parseResponse(raw, out);
+  }
+}
+
+void fetchOffline(const Endpoint &endpoint, UpstreamResponse &out)
+{
+  std::string path = options.fixturesDir + "/" + endpoint.fixture;
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    out.error = "cannot read " + path;
+    return;
+  }
+  std::ostringstream body;
+  body << in.rdbuf();
+  out.status = 200;
+  out.body = body.str();
+}
+
+// A 200's body trimmed to the filter, in both formats; false if it isn't JSON
+bool trimResponse(const Endpoint &endpoint, const std::string &body, Representation &json, Representation &msgpack)
+{
+  Value document;
+  if (!JsonParser(body).parse(document))
+  {
+    return false;
+  }
+  Value trimmed = applyFilter(document, endpoint.filter);
+  writeJson(trimmed, json.body);
+  json.etag = etagOf(json.body);
+  writeMsgPack(trimmed, msgpack.body);
+  msgpack.etag = etagOf(msgpack.body);
+  return true;
+}
+
+uint32_t secondsUntil(Clock::time_point deadline, Clock::time_point now)
+{
+  return deadline > now ? (uint32_t)std::chrono::duration_cast<std::chrono::seconds>(deadline - now).count() : 0;
+}
+
+Answer answerFrom(const Entry &entry, Clock::time_point now, const char *source)
+{
+  Answer answer;
+  answer.status = entry.status;
+  answer.json = entry.json;
+  answer.msgpack = entry.msgpack;
+  answer.maxAge = secondsUntil(entry.freshUntil, now);
+  answer.source = source;
+  return answer;
+}
+
+// Entries nobody is fetching that are past any use; called with cacheMutex held
+void evictExpired(Clock::time_point now)
+{
+  for (auto it = cache.begin(); it != cache.end();)
+  {
+    const Entry &entry = it->second;
+    if (!entry.fetching && entry.waiters == 0 && now >= entry.freshUntil && now >= entry.usableUntil)
+    {
+      it = cache.erase(it);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+// The answer for `key`: from the cache while it is fresh, else from one
+// upstream request that everyone else asking meanwhile waits for. If that
+// request fails, the last good answer is served for up to --stale and the
+// request is tried again after --error-ttl.
+Answer lookup(Endpoint &endpoint, const std::string &key)
+{
+  std::unique_lock<std::mutex> lock(cacheMutex);
+  Entry &entry = cache[key];  // std::map nodes stay put while others are added or erased
+  bool waited = entry.fetching;
+  entry.waiters++;
+  entry.ready.wait(lock, [&entry] { return !entry.fetching; });
+  entry.waiters--;
+  Clock::time_point now = Clock::now();
+  if (entry.filled && now < entry.freshUntil)
+  {
+    (waited ? endpoint.shared : endpoint.hits)++;
+    return answerFrom(entry, now, waited ? "shared" : "hit");
+  }
+  entry.fetching = true;
+  lock.unlock();
+
+  endpoint.upstream++;
+  auto startTime = Clock::now();
+  UpstreamResponse response;
+  if (options.offline)
+  {
+    fetchOffline(endpoint, response);
+  }
+  else
+  {
+    fetchUpstream(key, response);
+  }
+  Representation json;
+  Representation msgpack;
+  bool ok = response.status == 200 && trimResponse(endpoint, response.body, json, msgpack);
+  if (response.status == 200 && !ok)
+  {
+    response.error = "response is not JSON";
+  }
+  auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime);
+  if (response.status > 0)
+  {
+    printf("[proxy] upstream GET %s -> %d, %zu bytes in %lld ms%s%s\n", key.c_str(), response.status,
+           response.body.size(), (long long)elapsedMs.count(), response.error.empty() ? "" : ", ",
+           response.error.c_str());
+  }
+  else
+  {
+    printf("[proxy] upstream GET %s failed after %lld ms: %s\n", key.c_str(), (long long)elapsedMs.count(),
+           response.error.c_str());
+  }
+  fflush(stdout);
+
+  lock.lock();
+  now = Clock::now();
+  const char *source = "fetched";
+  if (ok)
+  {
+    entry.status = 200;
+    entry.json = std::move(json);
+    entry.msgpack = std::move(msgpack);
+    entry.freshUntil = now + std::chrono::seconds(endpoint.ttl);
+    entry.usableUntil = entry.freshUntil + std::chrono::seconds(options.stale);
+  }
+  else
+  {
+    endpoint.upstreamErrors++;
+    if (entry.filled && entry.status == 200 && now < entry.usableUntil)
+    {
+      endpoint.stale++;
+      source = "stale";
+    }
+    else
+    {
+      // Passed on as the API sent it, so devices see quota errors as before
+      source = "error";
+      entry.status = response.status > 0 ? response.status : 502;
+      entry.json.body.clear();
+      if (response.status > 0 && !response.body.empty())
+      {
+        entry.json.body = response.body;
+      }
+      else
+      {
+        entry.json.body = "{\"Code\":\"BadGateway\",\"Message\":";
+        writeJsonString(response.error, entry.json.body);
+        entry.json.body += "}";
+      }
+      entry.json.etag.clear();
+      entry.msgpack = Representation();
+      entry.usableUntil = now;
+    }
+    entry.freshUntil = now + std::chrono::seconds(options.errorTtl);
+  }
+  entry.filled = true;
+  entry.fetching = false;
+  entry.ready.notify_all();
+  Answer answer = answerFrom(entry, now, source);
+  evictExpired(now);
+  return answer;
+}
+
+// =============================================================================
+// SERVER
+// =============================================================================
+
+void appendMetric(std::string &out, const char *name, const char *type, const char *help,
+                  std::atomic<uint64_t> Endpoint::*counter)
+{
+  char line[192];
+  snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+  out += line;
+  for (const Endpoint &endpoint : endpoints)
+  {
+    snprintf(line, sizeof(line), "%s{endpoint=\"%s\"} %llu\n", name, endpoint.name,
+             (unsigned long long)(endpoint.*counter).load());
+    out += line;
+  }
+}
+
+std::string metricsReport()
+{
+  std::string out;
+  appendMetric(out, "satellite_proxy_requests_total", "counter", "Requests from devices", &Endpoint::requests);
+  appendMetric(out, "satellite_proxy_cache_hits_total", "counter", "Answered from the cache", &Endpoint::hits);
+  appendMetric(out, "satellite_proxy_shared_total", "counter",
+               "Answered by waiting for an upstream request another device started", &Endpoint::shared);
+  appendMetric(out, "satellite_proxy_upstream_requests_total", "counter", "Requests made to the API",
+               &Endpoint::upstream);
+  appendMetric(out, "satellite_proxy_upstream_errors_total", "counter",
+               "API requests that failed, got an error status or no JSON", &Endpoint::upstreamErrors);
+  appendMetric(out, "satellite_proxy_stale_total", "counter",
+               "Expired answers served because the refresh failed", &Endpoint::stale);
+  size_t entries;
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    entries = cache.size();
+  }
+  out += "# HELP satellite_proxy_cache_entries Answers held\n# TYPE satellite_proxy_cache_entries gauge\n"
+         "satellite_proxy_cache_entries " + std::to_string(entries) + "\n";
+  return out;
+}
+
+// Value of a request header, empty if absent. `headers` is the block after
+// the request line; names match case-insensitively.
+std::string headerValue(const std::string &headers, const char *name)
+{
+  std::istringstream lines(headers);
+  std::string line;
+  std::string wanted = lower(name) + ":";
+  while (std::getline(lines, line))
+  {
+    if (lower(line.substr(0, wanted.size())) == wanted)
+    {
+      size_t start = line.find_first_not_of(' ', wanted.size());
+      size_t end = line.find_last_not_of("\r ");
+      return (start == std::string::npos || end < start) ? "" : line.substr(start, end - start + 1);
+    }
+  }
+  return "";
+}
+
+std::string httpDate()
+{
+  char text[40];
+  time_t now = time(nullptr);
+  struct tm utc;
+  gmtime_r(&now, &utc);
+  strftime(text, sizeof(text), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+  return text;
+}
+
+bool sendAll(int fd, const char *data, size_t len)
+{
+  while (len > 0)
+  {
+    ssize_t sent = send(fd, data, len, 0);
+    if (sent <= 0)
+    {
+      return false;
+    }
+    data += sent;
+    len -= (size_t)sent;
+  }
+  return true;
+}
+
+// Read one request's line and headers into `request`. Anything read past
+// them stays in `buffer` for the next request on the connection.
+bool readRequest(int fd, std::string &buffer, std::string &request)
+{
+  size_t end;
+  while ((end = buffer.find("\r\n\r\n")) == std::string::npos)
+  {
+    if (buffer.size() > MAX_REQUEST_HEADER)
+    {
+      return false;
+    }
+    char chunk[1024];
+    ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+    if (got <= 0)
+    {
+      return false;  // Closed, or idle past IDLE_TIMEOUT_S
+    }
+    buffer.append(chunk, (size_t)got);
+  }
+  request = buffer.substr(0, end + 2);
+  buffer.erase(0, end + 4);
+  return true;
+}
+
+const char *reasonPhrase(int status)
+{
+  switch (status)
+  {
+    case 200: return "OK";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    default: return "Error";
+  }
+}
+
+// Answer one request. Returns false once the connection is to be closed.
+bool serveRequest(int fd, const std::string &request)
+{
+  auto startTime = Clock::now();
+  uint32_t number = ++requestCount;
+
+  std::string requestLine = request.substr(0, request.find("\r\n"));
+  std::string headers = request.substr(requestLine.size() + 2);
+  char method[16] = "";
+  char target[2048] = "";
+  char version[16] = "";
+  sscanf(requestLine.c_str(), "%15s %2047s %15s", method, target, version);
+  std::string path = target;
+
+  // Kept alive if the client asks (1.0) or doesn't refuse (1.1)
+  std::string connection = lower(headerValue(headers, "Connection"));
+  bool http11 = strcmp(version, "HTTP/1.1") == 0;
+  bool keepAlive = http11 ? connection != "close" : connection == "keep-alive";
+
+  Endpoint *endpoint = nullptr;
+  for (Endpoint &candidate : endpoints)
+  {
+    if (path.compare(0, strlen(candidate.prefix), candidate.prefix) == 0)
+    {
+      endpoint = &candidate;
+    }
+  }
+
+  int status = 200;
+  std::string contentType = "application/json; charset=utf-8";
+  std::string body;
+  std::string etag;
+  uint32_t maxAge = 0;
+  const char *source = "";
+  if (strcmp(method, "GET") != 0)
+  {
+    status = 405;
+  }
+  else if (path == "/metrics")
+  {
+    contentType = "text/plain; version=0.0.4";
+    body = metricsReport();
+  }
+  else if (!endpoint)
+  {
+    status = 404;
+    body = "{\"Code\":\"ResourceNotFound\",\"Message\":\"Not proxied\",\"Reference\":";
+    writeJsonString(path, body);  // The path is the client's, quotes and all
+    body += '}';
+  }
+  else if (!validTarget(path))
+  {
+    status = 400;
+  }
+  else
+  {
+    endpoint->requests++;
+    Answer answer = lookup(*endpoint, withoutApiKey(path));
+    // No q-value ranking: a client that names MessagePack at all gets it
+    bool msgpack = answer.status == 200 &&
+                   headerValue(headers, "Accept").find("application/msgpack") != std::string::npos;
+    const Representation &representation = msgpack ? answer.msgpack : answer.json;
+    status = answer.status;
+    maxAge = answer.maxAge;
+    source = answer.source;
+    etag = representation.etag;
+    if (msgpack)
+    {
+      contentType = "application/msgpack";
+    }
+    if (!etag.empty() && headerValue(headers, "If-None-Match") == etag)
+    {
+      status = 304;
+    }
+    else
+    {
+      body = representation.body;
+    }
+  }
+
+  std::string response = std::string(http11 ? "HTTP/1.1 " : "HTTP/1.0 ") + std::to_string(status) + " " +
+                         reasonPhrase(status) + "\r\nDate: " + httpDate() + "\r\nContent-Type: " + contentType +
+                         "\r\nContent-Length: " + std::to_string(body.size()) +
+                         "\r\nCache-Control: max-age=" + std::to_string(maxAge);
+  if (!etag.empty())
+  {
+    response += "\r\nETag: " + etag;
+  }
+  if (endpoint)
+  {
+    response += "\r\nVary: Accept";
+  }
+  if (status == 503)
+  {
+    response += "\r\nRetry-After: " + std::to_string(std::max<uint32_t>(maxAge, 1));
+  }
+  response += keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+  bool sent = sendAll(fd, response.data(), response.size()) && sendAll(fd, body.data(), body.size());
+
+  auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - startTime);
+  printf("[proxy] #%u %s %s -> %d, %zu bytes%s%s%s, done in %lld ms%s\n", number, method, path.c_str(), status,
+         body.size(), contentType == "application/msgpack" ? " MessagePack" : "", *source ? ", " : "", source,
+         (long long)elapsedMs.count(), sent ? "" : " (client went away)");
+  fflush(stdout);
+  return sent && keepAlive;
+}
+
+void serveConnection(int fd)
+{
+  timeval timeout = {IDLE_TIMEOUT_S, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  std::string buffer;
+  std::string request;
+  while (readRequest(fd, buffer, request) && serveRequest(fd, request))
+  {
+  }
+  close(fd);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (!parseOptions(argc, argv))
+  {
+    return 2;
+  }
+  if (options.apiKey.empty() && getenv("ACCUWEATHER_API_KEY"))
+  {
+    options.apiKey = getenv("ACCUWEATHER_API_KEY");
+  }
+  if (!options.offline)
+  {
+    if (!parseUpstream(options.upstream, upstream))
+    {
+      fprintf(stderr, "bad --upstream URL %s\n", options.upstream.c_str());
+      return 2;
+    }
+    if (!upstream.tls)
+    {
+      fprintf(stderr, "upstream %s is not https: requests go without the API key\n", options.upstream.c_str());
+    }
+    else if (options.apiKey.empty())
+    {
+      fprintf(stderr, "no API key: pass --api-key or set ACCUWEATHER_API_KEY (or run --offline)\n");
+      return 2;
+    }
+    else
+    {
+      tlsContext = SSL_CTX_new(TLS_client_method());
+      SSL_CTX_set_min_proto_version(tlsContext, TLS1_2_VERSION);
+      SSL_CTX_set_default_verify_paths(tlsContext);
+      SSL_CTX_set_verify(tlsContext, SSL_VERIFY_PEER, nullptr);
+    }
+  }
+  endpoints[0].ttl = options.locationTtl;
+  endpoints[1].ttl = options.forecastTtl;
+  for (Endpoint &endpoint : endpoints)
+  {
+    JsonParser(endpoint.filterText).parse(endpoint.filter);
+  }
+  signal(SIGPIPE, SIG_IGN);  // A client closing mid-body is a failed send, not the end of the server
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(options.port);
+  if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 16) < 0)
+  {
+    perror("fleet proxy");
+    return 1;
+  }
+  std::string source = options.offline ? options.fixturesDir + " (offline)" : options.upstream;
+  printf("[proxy] serving port %u from %s: TTL location %u s, forecast %u s, errors %u s, stale %u s\n",
+         (unsigned)options.port, source.c_str(), options.locationTtl, options.forecastTtl, options.errorTtl, options.stale);
+  fflush(stdout);
+
+  for (;;)
+  {
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0)
+    {
+      continue;
+    }
+    std::thread(serveConnection, fd).detach();
+  }
+}
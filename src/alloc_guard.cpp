@@ -0,0 +1,152 @@
+// =============================================================================
+// ALLOC GUARD - Debug counter for heap allocations made by loop()
+// =============================================================================
+
+#include "alloc_guard.h"
+
+#include <assert.h>
+
+#if defined(HAL_NATIVE)
+#include "sim.h"
+#elif defined(ALLOC_GUARD)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <reent.h>
+#endif
+
+namespace
+{
+
+bool started = false;
+uint32_t countAtCheck = 0;
+uint32_t flagged = 0;
+uint32_t exemptDepth = 0;
+uint32_t countAtExempt = 0;
+
+#if defined(ALLOC_GUARD) && !defined(HAL_NATIVE)
+TaskHandle_t guardedTask = nullptr;
+volatile uint32_t taskAllocations = 0;
+
+void countAllocation()
+{
+  if (guardedTask && xTaskGetCurrentTaskHandle() == guardedTask)
+  {
+    taskAllocations++;
+  }
+}
+#endif
+
+// Allocations the guarded task has made so far
+uint32_t allocationCount()
+{
+#if defined(HAL_NATIVE)
+  return (uint32_t)sim::heapThreadAllocations();  // Always called on the loop task's thread
+#elif defined(ALLOC_GUARD)
+  return taskAllocations;
+#else
+  return 0;
+#endif
+}
+
+} // namespace
+
+#if defined(ALLOC_GUARD) && !defined(HAL_NATIVE)
+// -Wl,--wrap for each of these sends every call here first. The _r variants
+// are what newlib itself calls (printf's dtoa among others).
+extern "C"
+{
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real__malloc_r(struct _reent *r, size_t size);
+void *__real__calloc_r(struct _reent *r, size_t count, size_t size);
+void *__real__realloc_r(struct _reent *r, void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+  countAllocation();
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+  countAllocation();
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  countAllocation();
+  return __real_realloc(ptr, size);
+}
+
+void *__wrap__malloc_r(struct _reent *r, size_t size)
+{
+  countAllocation();
+  return __real__malloc_r(r, size);
+}
+
+void *__wrap__calloc_r(struct _reent *r, size_t count, size_t size)
+{
+  countAllocation();
+  return __real__calloc_r(r, count, size);
+}
+
+void *__wrap__realloc_r(struct _reent *r, void *ptr, size_t size)
+{
+  countAllocation();
+  return __real__realloc_r(r, ptr, size);
+}
+}
+#endif
+
+void allocGuardBegin()
+{
+#if defined(ALLOC_GUARD) && !defined(HAL_NATIVE)
+  guardedTask = xTaskGetCurrentTaskHandle();
+#endif
+  countAtCheck = allocationCount();
+  flagged = 0;
+  started = true;
+}
+
+void allocGuardCheck(const char *where)
+{
+  if (!started)
+  {
+    return;
+  }
+  uint32_t count = allocationCount();
+  uint32_t allocations = count - countAtCheck;
+  countAtCheck = count;
+  if (allocations == 0)
+  {
+    return;
+  }
+  flagged += allocations;
+  Serial.printf("Alloc guard: %s allocated %u times\n", where, (unsigned)allocations);
+#if defined(ALLOC_GUARD) && !defined(HAL_NATIVE)
+  assert(allocations == 0);
+#endif
+}
+
+uint32_t allocGuardFlagged()
+{
+  return flagged;
+}
+
+AllocGuardExempt::AllocGuardExempt()
+{
+  if (exemptDepth++ == 0)
+  {
+    countAtExempt = allocationCount();
+  }
+}
+
+AllocGuardExempt::~AllocGuardExempt()
+{
+  if (--exemptDepth == 0)
+  {
+    countAtCheck += allocationCount() - countAtExempt;  // Skipped by the next check
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+// =============================================================================
+// ALLOC GUARD - Debug counter for heap allocations made by loop()
+// =============================================================================
+// Once booted, a pass of loop() should not touch the heap: it runs every
+// second for months, and small blocks left between the network task's
+// allocations fragment the heap its TLS buffers need. loop() starts the
+// guard once the WiFi link first comes up and checks it after every pass; a
+// pass that allocated is logged, and fails an assert on the device.
+//
+// The one exception is (re)joining the AP: the IDF's WiFi and netif layers
+// allocate inside WiFi.begin() and friends, and only loop() may drive the
+// link. Those calls sit in an AllocGuardExempt scope.
+//
+// Counting needs the allocator wrapped at link time. The simulator's heap
+// tracker always is; on the device, the alloc_guard environment in
+// platformio.ini wraps it and defines ALLOC_GUARD. In other builds the guard
+// does nothing.
+
+#include <Arduino.h>
+
+// Count the calling task's allocations from now on
+void allocGuardBegin();
+
+// Report (and on the device, assert) if the task allocated since the last
+// check. `where` names the code that ran in between.
+void allocGuardCheck(const char *where);
+
+// Allocations reported by allocGuardCheck() since allocGuardBegin()
+uint32_t allocGuardFlagged();
+
+// Allocations the task makes while one of these is alive are not counted
+class AllocGuardExempt
+{
+public:
+  AllocGuardExempt();
+  ~AllocGuardExempt();
+  AllocGuardExempt(const AllocGuardExempt &) = delete;
+  AllocGuardExempt &operator=(const AllocGuardExempt &) = delete;
+};
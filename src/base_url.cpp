@@ -0,0 +1,65 @@
+// =============================================================================
+// BASE URL - Scheme, host, port and path prefix of a configured server
+// =============================================================================
+
+#include "base_url.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool parseBaseUrl(const char *text, BaseUrl &out)
+{
+  bool tls;
+  const char *host;
+  if (strncmp(text, "https://", 8) == 0)
+  {
+    tls = true;
+    host = text + 8;
+  }
+  else if (strncmp(text, "http://", 7) == 0)
+  {
+    tls = false;
+    host = text + 7;
+  }
+  else
+  {
+    return false;
+  }
+  if (strpbrk(text, "?# "))
+  {
+    return false;
+  }
+
+  size_t hostLen = strcspn(host, ":/");
+  if (hostLen == 0)
+  {
+    return false;
+  }
+  const char *rest = host + hostLen;
+
+  uint16_t port = tls ? 443 : 80;
+  if (*rest == ':')
+  {
+    char *end;
+    unsigned long value = strtoul(rest + 1, &end, 10);
+    if (end == rest + 1 || value == 0 || value > 65535 || (*end != '/' && *end != '\0'))
+    {
+      return false;
+    }
+    port = (uint16_t)value;
+    rest = end;
+  }
+
+  // Path prefix as given, less trailing slashes; request paths bring their own
+  size_t len = strlen(text);
+  while (len > (size_t)(rest - text) && text[len - 1] == '/')
+  {
+    len--;
+  }
+
+  out.url = String(text).substring(0, len);
+  out.host = String(host).substring(0, hostLen);
+  out.port = port;
+  out.tls = tls;
+  return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+// =============================================================================
+// BASE URL - Scheme, host, port and path prefix of a configured server
+// =============================================================================
+// The weather API's base URL can be pointed away from AccuWeather (a build
+// flag or NVS, see main.cpp), typically at test/replay_server on the local
+// network. Request paths are appended to `url`; `host` and `port` are what
+// the connection is opened to ahead of the request.
+
+#include <Arduino.h>
+
+struct BaseUrl
+{
+  String url;     // Normalized: scheme://host[:port][/path], no trailing slash
+  String host;
+  uint16_t port = 443;
+  bool tls = true;  // https://; http:// talks plain TCP
+};
+
+// Parse an http:// or https:// URL without query or fragment. Returns false
+// (leaving `out` alone) if it isn't one.
+bool parseBaseUrl(const char *text, BaseUrl &out);
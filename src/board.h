@@ -0,0 +1,32 @@
+#pragma once
+
+// =============================================================================
+// PIN DEFINITIONS
+// =============================================================================
+
+// Display (ST7789 240x280, rotated to 280x240 landscape)
+#define TFT_CS 10
+#define TFT_DC 9
+#define TFT_RST 8
+#define TFT_MOSI 7
+#define TFT_SCLK 6
+
+// I2C (AHT10 sensor)
+#define PIN_I2C_SDA 4
+#define PIN_I2C_SCL 3
+
+// Controls
+#define PIN_TOUCH 2     // TTP223B capacitive touch
+#define PIN_LIGHT_SW 21 // Light switch (LOW = on, HIGH = off)
+
+// Outputs
+#define PIN_BACKLIGHT 20 // Display backlight (PWM)
+#define PIN_LED 0        // Notification LED (PWM)
+
+// =============================================================================
+// DISPLAY CONFIGURATION
+// =============================================================================
+
+#define SCREEN_W 280
+#define SCREEN_H 240
+#define TFT_SPI_HZ 40000000  // ST7789 write clock, shared by GFX and DMA transfers
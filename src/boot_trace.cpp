@@ -0,0 +1,246 @@
+// =============================================================================
+// BOOT TRACE - Where startup time goes
+// =============================================================================
+
+#include "boot_trace.h"
+
+#include <atomic>
+#include <string.h>
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+
+namespace
+{
+
+const uint8_t MAX_SPANS = 24;
+const uint32_t HISTORY_MAGIC = 0xB0071ACE;
+
+struct PhaseInfo
+{
+  const char *name;
+  const char *column;  // History table heading
+};
+
+const PhaseInfo PHASES[PHASE_COUNT] = {
+  {"setup()", "setup"},
+  {"first frame", "frame"},
+  {"wifi associate", "assoc"},
+  {"dhcp", "dhcp"},
+  {"tls handshake", "tls"},
+  {"http first byte", "ttfb"},
+  {"json parse", "json"},
+  {"ntp", "ntp"},
+};
+
+// Spans come from setup(), the network task and WiFi/SNTP callbacks. A writer
+// claims a slot, fills it in and then sets `recorded`, so the report never
+// reads a half-written span.
+struct Span
+{
+  uint8_t phase;
+  const char *what;
+  uint32_t startUs;
+  uint32_t endUs;
+  std::atomic<bool> recorded{false};
+};
+
+Span spans[MAX_SPANS];
+std::atomic<uint32_t> spansClaimed{0};
+std::atomic<bool> finished{false};
+uint32_t readyUs = 0;
+
+struct BootRecord
+{
+  uint32_t bootNumber;            // Since power-on
+  uint32_t readyMs;               // Reset to bootTraceFinish()
+  uint16_t phaseMs[PHASE_COUNT];  // Total per phase, saturating
+  uint8_t resetReason;            // esp_reset_reason_t
+};
+
+struct BootHistory
+{
+  uint32_t magic;
+  uint32_t bootCount;
+  uint8_t count;
+  BootRecord records[BOOT_HISTORY_SIZE];  // Oldest first
+};
+
+// Not zeroed at startup, so it carries over a software reset. After a power
+// cycle it holds garbage, which the magic and the reset reason rule out.
+RTC_NOINIT_ATTR BootHistory history;
+
+esp_reset_reason_t resetReason = ESP_RST_UNKNOWN;
+
+const char *resetReasonName(uint8_t reason)
+{
+  switch (reason)
+  {
+    case ESP_RST_POWERON:
+      return "power-on";
+    case ESP_RST_EXT:
+      return "reset pin";
+    case ESP_RST_SW:
+      return "software";
+    case ESP_RST_PANIC:
+      return "panic";
+    case ESP_RST_INT_WDT:
+    case ESP_RST_TASK_WDT:
+    case ESP_RST_WDT:
+      return "watchdog";
+    case ESP_RST_DEEPSLEEP:
+      return "deep sleep";
+    case ESP_RST_BROWNOUT:
+      return "brownout";
+    default:
+      return "other";
+  }
+}
+
+uint16_t saturatingMs(uint32_t us)
+{
+  uint32_t ms = (us + 500) / 1000;
+  return ms > UINT16_MAX ? UINT16_MAX : (uint16_t)ms;
+}
+
+} // namespace
+
+void bootTraceBegin()
+{
+  resetReason = esp_reset_reason();
+  bool keep = resetReason != ESP_RST_POWERON && resetReason != ESP_RST_BROWNOUT &&
+              history.magic == HISTORY_MAGIC && history.count <= BOOT_HISTORY_SIZE;
+  if (!keep)
+  {
+    memset(&history, 0, sizeof(history));
+    history.magic = HISTORY_MAGIC;
+  }
+  history.bootCount++;
+}
+
+uint32_t bootTraceNow()
+{
+  return (uint32_t)esp_timer_get_time();
+}
+
+void bootTraceSpan(BootPhase phase, uint32_t startUs, uint32_t endUs, const char *what)
+{
+  if (finished.load(std::memory_order_acquire)) return;
+
+  uint32_t slot = spansClaimed.fetch_add(1);
+  if (slot >= MAX_SPANS) return;
+
+  Span &span = spans[slot];
+  span.phase = phase;
+  span.what = what;
+  span.startUs = startUs;
+  span.endUs = endUs;
+  span.recorded.store(true, std::memory_order_release);
+}
+
+void bootTraceSpan(BootPhase phase, uint32_t startUs, const char *what)
+{
+  bootTraceSpan(phase, startUs, bootTraceNow(), what);
+}
+
+void bootTraceFinish()
+{
+  if (finished.exchange(true)) return;
+  readyUs = bootTraceNow();
+
+  BootRecord record = {};
+  record.bootNumber = history.bootCount;
+  record.readyMs = (readyUs + 500) / 1000;
+  record.resetReason = (uint8_t)resetReason;
+
+  uint32_t phaseUs[PHASE_COUNT] = {};
+  for (uint8_t i = 0; i < MAX_SPANS; i++)
+  {
+    if (!spans[i].recorded.load(std::memory_order_acquire)) continue;
+    phaseUs[spans[i].phase] += spans[i].endUs - spans[i].startUs;
+  }
+  for (uint8_t p = 0; p < PHASE_COUNT; p++)
+  {
+    record.phaseMs[p] = saturatingMs(phaseUs[p]);
+  }
+
+  if (history.count == BOOT_HISTORY_SIZE)
+  {
+    memmove(&history.records[0], &history.records[1], sizeof(BootRecord) * (BOOT_HISTORY_SIZE - 1));
+    history.count--;
+  }
+  history.records[history.count++] = record;
+
+  Serial.print(bootTraceReport());
+}
+
+String bootTraceReport()
+{
+  String report;
+  char line[128];
+
+  snprintf(line, sizeof(line), "\n--- Boot Trace: boot %lu since power-on, %s reset ---\n",
+           (unsigned long)history.bootCount, resetReasonName(resetReason));
+  report += line;
+  snprintf(line, sizeof(line), "%-16s %-14s %10s %10s\n", "phase", "step", "start ms", "took ms");
+  report += line;
+
+  // Spans in start order (few enough for a selection sort)
+  bool listed[MAX_SPANS] = {};
+  for (;;)
+  {
+    int next = -1;
+    for (uint8_t i = 0; i < MAX_SPANS; i++)
+    {
+      if (listed[i] || !spans[i].recorded.load(std::memory_order_acquire)) continue;
+      if (next < 0 || spans[i].startUs < spans[next].startUs) next = i;
+    }
+    if (next < 0) break;
+    listed[next] = true;
+
+    const Span &span = spans[next];
+    snprintf(line, sizeof(line), "%-16s %-14s %10.1f %10.1f\n", PHASES[span.phase].name, span.what,
+             span.startUs / 1000.0, (span.endUs - span.startUs) / 1000.0);
+    report += line;
+  }
+
+  if (spansClaimed.load() > MAX_SPANS)
+  {
+    snprintf(line, sizeof(line), "(%lu spans dropped)\n", (unsigned long)(spansClaimed.load() - MAX_SPANS));
+    report += line;
+  }
+  if (finished.load())
+  {
+    snprintf(line, sizeof(line), "Ready after %.1f ms\n", readyUs / 1000.0);
+    report += line;
+  }
+  else
+  {
+    report += "Still booting\n";
+  }
+
+  // One row per boot since power-on, totals per phase
+  snprintf(line, sizeof(line), "\nLast %u boots (ms):\n%5s %-10s %6s", history.count, "boot", "reset", "ready");
+  report += line;
+  for (uint8_t p = 0; p < PHASE_COUNT; p++)
+  {
+    snprintf(line, sizeof(line), " %6s", PHASES[p].column);
+    report += line;
+  }
+  report += "\n";
+  for (uint8_t i = 0; i < history.count; i++)
+  {
+    const BootRecord &record = history.records[i];
+    snprintf(line, sizeof(line), "%5lu %-10s %6lu", (unsigned long)record.bootNumber,
+             resetReasonName(record.resetReason), (unsigned long)record.readyMs);
+    report += line;
+    for (uint8_t p = 0; p < PHASE_COUNT; p++)
+    {
+      snprintf(line, sizeof(line), " %6u", record.phaseMs[p]);
+      report += line;
+    }
+    report += "\n";
+  }
+  report += "--- Boot Trace End ---\n\n";
+  return report;
+}
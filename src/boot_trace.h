@@ -0,0 +1,50 @@
+#pragma once
+
+// =============================================================================
+// BOOT TRACE - Where startup time goes
+// =============================================================================
+// Each stage of startup records a span in microseconds since reset
+// (esp_timer_get_time()). bootTraceFinish() prints them as a table once the
+// device is up. It also keeps a per-phase summary of the boot in RTC memory,
+// which survives software and watchdog resets but not a power cycle, so cold
+// and warm starts can be compared. bootTraceReport() formats the same table
+// for the status server.
+//
+// A phase can occur more than once (one TLS handshake per request); the table
+// lists every span and the history keeps the total per phase.
+
+#include <Arduino.h>
+
+enum BootPhase : uint8_t
+{
+  PHASE_SETUP,            // setup() entry to return
+  PHASE_FIRST_FRAME,      // Reset to the first frame on the panel
+  PHASE_WIFI_ASSOCIATE,   // WiFi.begin() to associated with the AP
+  PHASE_DHCP,             // Associated to IP address
+  PHASE_TLS_HANDSHAKE,    // DNS, TCP connect and TLS handshake
+  PHASE_HTTP_FIRST_BYTE,  // Request sent to response headers received
+  PHASE_JSON_PARSE,       // Streaming parse of the response body
+  PHASE_NTP,              // SNTP started to clock set
+  PHASE_COUNT
+};
+
+// Boots kept in RTC memory, newest last
+const uint8_t BOOT_HISTORY_SIZE = 8;
+
+// Call first thing in setup(): counts the boot and checks the RTC history
+void bootTraceBegin();
+
+// Microseconds since reset; spans are recorded in these units
+uint32_t bootTraceNow();
+
+// Record a span of `phase` from startUs to endUs (or to now). `what` says which
+// request or step it belongs to and must be a string literal. Ignored after
+// bootTraceFinish(), so steady-state refreshes don't show up as boot time.
+void bootTraceSpan(BootPhase phase, uint32_t startUs, uint32_t endUs, const char *what = "");
+void bootTraceSpan(BootPhase phase, uint32_t startUs, const char *what = "");
+
+// Startup is done: store the summary in RTC memory and print the report
+void bootTraceFinish();
+
+// This boot's spans and the RTC history as a plain-text table
+String bootTraceReport();
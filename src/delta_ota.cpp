@@ -0,0 +1,264 @@
+// =============================================================================
+// DELTA OTA - Rebuild an update from the running image and a patch
+// =============================================================================
+
+#include "delta_ota.h"
+
+#include <string.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <mbedtls/sha256.h>
+#include "ota_image.h"
+
+namespace
+{
+
+const uint32_t PATCH_MAGIC = 0x31445357;  // "WSD1", see tools/ota_delta.py
+const size_t HEADER_SIZE = 4 + 4 + SHA256_SIZE + 4 + SHA256_SIZE;
+const size_t BUFFER_SIZE = 1024;          // Source and patch bytes on their way to the writer
+
+uint32_t readLe32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+class DeltaApplier
+{
+public:
+  DeltaApplier(Stream &patch, size_t patchSize) : patch_(patch), remaining_(patchSize) {}
+  ~DeltaApplier() { free(buffer_); }
+
+  bool run(const uint8_t *expectedSha);
+
+private:
+  bool fail(const char *why);
+  bool read(uint8_t *out, size_t length);
+  bool readVarint(uint32_t &value);
+  bool sourceMatches(uint32_t size, const uint8_t *sha);
+  bool emitFromSource(uint32_t offset, uint32_t length);
+  bool emitFromPatch(uint32_t length);
+
+  Stream &patch_;
+  size_t remaining_;  // Patch bytes not read yet
+  const esp_partition_t *source_ = nullptr;
+  uint8_t *buffer_ = nullptr;
+  uint32_t sourceSize_ = 0;
+  uint32_t targetSize_ = 0;
+  uint32_t emitted_ = 0;  // Target bytes rebuilt
+  OtaImageWriter writer_;
+};
+
+bool DeltaApplier::fail(const char *why)
+{
+  Serial.printf("Delta update failed: %s\n", why);
+  return false;
+}
+
+bool DeltaApplier::read(uint8_t *out, size_t length)
+{
+  if (length > remaining_)
+  {
+    return false;
+  }
+  size_t got = patch_.readBytes((char *)out, length);
+  remaining_ -= got;
+  return got == length;
+}
+
+bool DeltaApplier::readVarint(uint32_t &value)
+{
+  value = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7)
+  {
+    uint8_t byte;
+    if (!read(&byte, 1))
+    {
+      return false;
+    }
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+    {
+      return true;
+    }
+  }
+  return false;  // Longer than a uint32_t: corrupt
+}
+
+// Whether the running partition starts with exactly the image the patch was
+// made from
+bool DeltaApplier::sourceMatches(uint32_t size, const uint8_t *sha)
+{
+  if (size > source_->size)
+  {
+    return false;
+  }
+
+  mbedtls_sha256_context sourceSha;
+  mbedtls_sha256_init(&sourceSha);
+  mbedtls_sha256_starts(&sourceSha, 0);
+  bool readOk = true;
+  for (uint32_t offset = 0; readOk && offset < size; offset += BUFFER_SIZE)
+  {
+    uint32_t chunk = min((uint32_t)BUFFER_SIZE, size - offset);
+    readOk = esp_partition_read(source_, offset, buffer_, chunk) == ESP_OK;
+    mbedtls_sha256_update(&sourceSha, buffer_, chunk);
+  }
+  uint8_t digest[SHA256_SIZE];
+  mbedtls_sha256_finish(&sourceSha, digest);
+  mbedtls_sha256_free(&sourceSha);
+  return readOk && memcmp(digest, sha, sizeof(digest)) == 0;
+}
+
+bool DeltaApplier::emitFromSource(uint32_t offset, uint32_t length)
+{
+  while (length > 0)
+  {
+    uint32_t chunk = min((uint32_t)BUFFER_SIZE, length);
+    if (esp_partition_read(source_, offset, buffer_, chunk) != ESP_OK || writer_.write(buffer_, chunk) != chunk)
+    {
+      return false;
+    }
+    offset += chunk;
+    length -= chunk;
+  }
+  return true;
+}
+
+bool DeltaApplier::emitFromPatch(uint32_t length)
+{
+  while (length > 0)
+  {
+    uint32_t chunk = min((uint32_t)BUFFER_SIZE, length);
+    if (!read(buffer_, chunk) || writer_.write(buffer_, chunk) != chunk)
+    {
+      return false;
+    }
+    length -= chunk;
+  }
+  return true;
+}
+
+bool DeltaApplier::run(const uint8_t *expectedSha)
+{
+  source_ = esp_ota_get_running_partition();
+  buffer_ = (uint8_t *)malloc(BUFFER_SIZE);
+  if (!source_ || !buffer_)
+  {
+    return fail("no running partition or out of memory");
+  }
+
+  uint8_t header[HEADER_SIZE];
+  if (!read(header, sizeof(header)) || readLe32(header) != PATCH_MAGIC)
+  {
+    return fail("not a delta patch");
+  }
+  sourceSize_ = readLe32(header + 4);
+  targetSize_ = readLe32(header + 8 + SHA256_SIZE);
+  const uint8_t *targetSha = header + 12 + SHA256_SIZE;
+  if (memcmp(targetSha, expectedSha, SHA256_SIZE) != 0)
+  {
+    return fail("patch builds a different image than the manifest names");
+  }
+  if (!sourceMatches(sourceSize_, header + 8))
+  {
+    return fail("patch is for a different image than the one running");
+  }
+
+  Serial.printf("Delta update: %u byte patch to a %u byte image\n", (unsigned)(remaining_ + sizeof(header)),
+                (unsigned)targetSize_);
+  uint32_t startMs = millis();
+
+  if (!writer_.begin(targetSize_))
+  {
+    return fail(writer_.error());
+  }
+
+  uint32_t sourceEnd = 0;  // Where the previous copy ended
+  const char *error = nullptr;
+  while (!error && emitted_ < targetSize_)
+  {
+    uint32_t command;
+    if (!readVarint(command))
+    {
+      error = "patch ended early";
+      break;
+    }
+    uint32_t length = command >> 1;
+    if (length > targetSize_ - emitted_)
+    {
+      error = "command runs past the image";
+      break;
+    }
+
+    if (!(command & 1))
+    {
+      // Literal bytes
+      if (!emitFromPatch(length))
+      {
+        error = "could not write the image";  // Flash error or the download broke off
+      }
+      emitted_ += length;
+      continue;
+    }
+
+    // Copy from the running image, with edits
+    uint32_t zigzag, editCount;
+    if (!readVarint(zigzag) || !readVarint(editCount))
+    {
+      error = "patch ended early";
+      break;
+    }
+    int64_t offset = (int64_t)sourceEnd + ((zigzag & 1) ? -(int64_t)(zigzag >> 1) - 1 : (int64_t)(zigzag >> 1));
+    if (offset < 0 || offset + length > sourceSize_)
+    {
+      error = "copy outside the running image";
+      break;
+    }
+
+    uint32_t position = 0;
+    for (uint32_t i = 0; !error && i < editCount; i++)
+    {
+      uint32_t skip, count;
+      if (!readVarint(skip) || !readVarint(count))
+      {
+        error = "patch ended early";
+      }
+      else if (skip > length - position || count > length - position - skip)
+      {
+        error = "edit runs past the copy";
+      }
+      else if (!emitFromSource((uint32_t)offset + position, skip) || !emitFromPatch(count))
+      {
+        error = "could not write the image";
+      }
+      position += skip + count;
+    }
+    if (!error && !emitFromSource((uint32_t)offset + position, length - position))
+    {
+      error = "could not write the image";
+    }
+    emitted_ += length;
+    sourceEnd = (uint32_t)offset + length;
+  }
+
+  if (error)
+  {
+    return fail(writer_.error() ? writer_.error() : error);
+  }
+  if (!writer_.finish(expectedSha))
+  {
+    return fail(writer_.error());
+  }
+
+  Serial.printf("Delta update: rebuilt %u bytes in %lu ms\n", (unsigned)targetSize_,
+                (unsigned long)(millis() - startMs));
+  return true;
+}
+
+} // namespace
+
+bool deltaOtaApply(Stream &patch, size_t patchSize, const uint8_t *expectedSha)
+{
+  DeltaApplier applier(patch, patchSize);
+  return applier.run(expectedSha);
+}
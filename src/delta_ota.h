@@ -0,0 +1,24 @@
+#pragma once
+
+// =============================================================================
+// DELTA OTA - Rebuild an update from the running image and a patch
+// =============================================================================
+// A patch made by tools/ota_delta.py lists which stretches of the new image
+// can be copied from the running one (with a few bytes edited) and carries
+// only the rest. The applier streams it straight off the connection: copies
+// are read from the running partition and the rebuilt image is printed into
+// an OtaImageWriter (ota_image.h) as it comes together.
+//
+// The patch names the exact image it applies to and the one it builds, both
+// by SHA-256, so a patch for another build, or for another release than the
+// manifest's, is turned down before anything is erased.
+
+#include <Arduino.h>
+
+// Apply `patchSize` bytes of patch from `patch`, which must build the image
+// with SHA-256 `expectedSha` (from the release manifest). True once the
+// rebuilt image is the boot partition (restart to run it). False, with the
+// reason logged, if the patch is for another image, is corrupt or the
+// download breaks off; the boot partition is then unchanged, so a full image
+// can still be tried.
+bool deltaOtaApply(Stream &patch, size_t patchSize, const uint8_t *expectedSha);
@@ -0,0 +1,277 @@
+// =============================================================================
+// DISPLAY TRANSPORT - Asynchronous DMA pixel writes to the ST7789
+// =============================================================================
+
+#include "display_transport.h"
+
+#include <string.h>
+
+#include "power.h"
+
+#if DISPLAY_TRANSPORT_DMA
+#include <esp_heap_caps.h>
+#include <soc/spi_struct.h>
+#endif
+
+DisplayTransport::DisplayTransport(Adafruit_ST7789 &tft) : tft_(tft)
+{
+}
+
+#if DISPLAY_TRANSPORT_DMA
+
+bool DisplayTransport::begin(int8_t mosiPin, int8_t sclkPin, uint32_t clockHz)
+{
+  // The Arduino SPI driver programs SPI2 directly without claiming it, so the
+  // IDF master driver can attach to the same host (TFT_eSPI does the same).
+  // Snapshot the registers Arduino set up so the CPU path can be restored.
+  tft_.startWrite();
+  savedUser_ = GPSPI2.user.val;
+  savedUser1_ = GPSPI2.user1.val;
+  savedUser2_ = GPSPI2.user2.val;
+  savedCtrl_ = GPSPI2.ctrl.val;
+  savedMisc_ = GPSPI2.misc.val;
+  savedClock_ = GPSPI2.clock.val;
+  savedDmaConf_ = GPSPI2.dma_conf.val;
+  tft_.endWrite();
+
+  spi_bus_config_t bus = {};
+  bus.mosi_io_num = mosiPin;
+  bus.miso_io_num = -1;
+  bus.sclk_io_num = sclkPin;
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = LINE_BUFFER_PIXELS * sizeof(uint16_t);
+  if (spi_bus_initialize(SPI2_HOST, &bus, SPI_DMA_CH_AUTO) != ESP_OK)
+  {
+    Serial.println("Display DMA: bus init failed, using blocking writes");
+    return false;
+  }
+
+  // CS and DC stay with Adafruit_ST7789; DMA only ever sends pixel data
+  spi_device_interface_config_t dev = {};
+  dev.clock_speed_hz = clockHz;
+  dev.mode = 0;
+  dev.spics_io_num = -1;
+  dev.queue_size = 2;
+  dev.flags = SPI_DEVICE_HALFDUPLEX | SPI_DEVICE_NO_DUMMY;
+  if (spi_bus_add_device(SPI2_HOST, &dev, &device_) != ESP_OK)
+  {
+    Serial.println("Display DMA: add device failed, using blocking writes");
+    spi_bus_free(SPI2_HOST);
+    restoreBusRegisters();
+    return false;
+  }
+
+  for (int i = 0; i < 2; i++)
+  {
+    buffers_[i] = (uint16_t *)heap_caps_malloc(LINE_BUFFER_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+    if (!buffers_[i])
+    {
+      Serial.println("Display DMA: no DMA memory, using blocking writes");
+      // Hand the bus back to Arduino as it was, or its blocking writes would
+      // run with the IDF driver's DMA and half-duplex settings
+      heap_caps_free(buffers_[0]);  // NULL if it was the first that failed
+      buffers_[0] = nullptr;
+      spi_bus_remove_device(device_);
+      device_ = nullptr;
+      spi_bus_free(SPI2_HOST);
+      restoreBusRegisters();
+      return false;
+    }
+  }
+  restoreBusRegisters();
+
+  dmaEnabled_ = true;
+  Serial.printf("Display DMA ready: 2 x %u pixel line buffers\n", (unsigned)LINE_BUFFER_PIXELS);
+  return true;
+}
+
+void DisplayTransport::restoreBusRegisters()
+{
+  // The IDF driver leaves DMA enabled and the bus half duplex; Arduino's
+  // CPU-buffer writes would then clock out stale DMA data
+  GPSPI2.user.val = savedUser_;
+  GPSPI2.user1.val = savedUser1_;
+  GPSPI2.user2.val = savedUser2_;
+  GPSPI2.ctrl.val = savedCtrl_;
+  GPSPI2.misc.val = savedMisc_;
+  GPSPI2.clock.val = savedClock_;
+  GPSPI2.dma_conf.val = savedDmaConf_;
+  GPSPI2.cmd.update = 1;
+  while (GPSPI2.cmd.update)
+  {
+  }
+}
+
+void DisplayTransport::waitOne()
+{
+  spi_transaction_t *done;
+  spi_device_get_trans_result(device_, &done, portMAX_DELAY);
+  inFlight_--;
+}
+
+void DisplayTransport::queueFill()
+{
+  if (fillLen_ == 0) return;
+
+  spi_transaction_t &t = trans_[fillIndex_];
+  memset(&t, 0, sizeof(t));
+  t.length = fillLen_ * 16;  // Bits
+  t.tx_buffer = buffers_[fillIndex_];
+  // The task waiting on a transfer lets the idle task run, and light sleep
+  // would stop the DMA clock under it; awake until drain() reaps the last one
+  powerStayAwake(POWER_HOLDER_DISPLAY_DMA, true);
+  spi_device_queue_trans(device_, &t, portMAX_DELAY);
+  inFlight_++;
+
+  // Switch buffers; the other one is free once its (older) transfer is done
+  fillIndex_ ^= 1;
+  fillLen_ = 0;
+  if (inFlight_ == 2) waitOne();
+}
+
+void DisplayTransport::drain()
+{
+  queueFill();
+  bool wasBusy = (inFlight_ > 0);
+  while (inFlight_ > 0) waitOne();
+  if (wasBusy) restoreBusRegisters();
+  powerStayAwake(POWER_HOLDER_DISPLAY_DMA, false);
+}
+
+void DisplayTransport::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  if (dmaEnabled_) drain();
+  if (!windowOpen_)
+  {
+    tft_.startWrite();
+    windowOpen_ = true;
+  }
+  tft_.setAddrWindow(x, y, w, h);
+}
+
+void DisplayTransport::writeColor(uint16_t color, uint32_t len)
+{
+  if (!dmaEnabled_)
+  {
+    tft_.writeColor(color, len);
+    return;
+  }
+
+  uint16_t swapped = (color >> 8) | (color << 8);  // Panel wants MSB first
+  while (len > 0)
+  {
+    uint16_t *dst = buffers_[fillIndex_] + fillLen_;
+    uint32_t n = LINE_BUFFER_PIXELS - fillLen_;
+    if (n > len) n = len;
+    for (uint32_t i = 0; i < n; i++) dst[i] = swapped;
+    fillLen_ += n;
+    len -= n;
+    if (fillLen_ == LINE_BUFFER_PIXELS) queueFill();
+  }
+}
+
+void DisplayTransport::writePixels(const uint16_t *colors, uint32_t len)
+{
+  if (!dmaEnabled_)
+  {
+    tft_.writePixels((uint16_t *)colors, len);
+    return;
+  }
+
+  while (len > 0)
+  {
+    uint16_t *dst = buffers_[fillIndex_] + fillLen_;
+    uint32_t n = LINE_BUFFER_PIXELS - fillLen_;
+    if (n > len) n = len;
+    for (uint32_t i = 0; i < n; i++) dst[i] = (colors[i] >> 8) | (colors[i] << 8);
+    colors += n;
+    fillLen_ += n;
+    len -= n;
+    if (fillLen_ == LINE_BUFFER_PIXELS) queueFill();
+  }
+}
+
+void DisplayTransport::flush()
+{
+  if (dmaEnabled_) queueFill();
+}
+
+void DisplayTransport::fence()
+{
+  if (dmaEnabled_) drain();
+  if (windowOpen_)
+  {
+    tft_.endWrite();
+    windowOpen_ = false;
+  }
+}
+
+#else
+
+// Blocking fallback: straight through to the Adafruit driver
+
+bool DisplayTransport::begin(int8_t mosiPin, int8_t sclkPin, uint32_t clockHz)
+{
+  (void)mosiPin;
+  (void)sclkPin;
+  (void)clockHz;
+  return false;
+}
+
+void DisplayTransport::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  if (!windowOpen_)
+  {
+    tft_.startWrite();
+    windowOpen_ = true;
+  }
+  tft_.setAddrWindow(x, y, w, h);
+}
+
+void DisplayTransport::writeColor(uint16_t color, uint32_t len)
+{
+  tft_.writeColor(color, len);
+}
+
+void DisplayTransport::writePixels(const uint16_t *colors, uint32_t len)
+{
+  tft_.writePixels((uint16_t *)colors, len);
+}
+
+void DisplayTransport::flush()
+{
+}
+
+void DisplayTransport::fence()
+{
+  if (windowOpen_)
+  {
+    tft_.endWrite();
+    windowOpen_ = false;
+  }
+}
+
+#endif
+
+void DisplayTransport::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  // Clip to the panel like Adafruit_SPITFT::writeFillRect
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if (x + w > tft_.width()) w = tft_.width() - x;
+  if (y + h > tft_.height()) h = tft_.height() - y;
+  if (w <= 0 || h <= 0) return;
+
+  setAddrWindow(x, y, w, h);
+  writeColor(color, (uint32_t)w * h);
+  flush();
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+// =============================================================================
+// DISPLAY TRANSPORT - Asynchronous DMA pixel writes to the ST7789
+// =============================================================================
+// Bulk pixel data (fills, pre-rendered frames) goes to the SPI master's DMA
+// through two line buffers: the CPU fills one while the other is on the wire,
+// and calls return as soon as the last block is queued. fence() waits for the
+// queue to drain and releases the bus.
+//
+// The transport shares the SPI peripheral with Adafruit_ST7789. Commands (the
+// address window) still go through the Adafruit driver; only pixel blocks use
+// DMA. While a transfer is open nothing else may touch the panel, so always
+// fence() before drawing through tft again. Queued transfers also hold off
+// light sleep (see power.h) until fence() reaps them.
+//
+// Without DMA (begin() failed, or the native simulator) every call falls back
+// to the blocking Adafruit writes, so callers need no second code path.
+
+#include <Adafruit_ST7789.h>
+
+#include "board.h"
+
+#if defined(ESP_PLATFORM) && !defined(HAL_NATIVE)
+#include <driver/spi_master.h>
+#define DISPLAY_TRANSPORT_DMA 1
+#else
+#define DISPLAY_TRANSPORT_DMA 0
+#endif
+
+class DisplayTransport
+{
+public:
+  explicit DisplayTransport(Adafruit_ST7789 &tft);
+
+  // Attach a DMA device to the bus the panel is on. Call after tft.init().
+  bool begin(int8_t mosiPin, int8_t sclkPin, uint32_t clockHz);
+
+  // Open a window; waits for pending pixels since the command goes via the CPU
+  void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+  // Append pixels to the open window. Returns once they are buffered or queued.
+  void writeColor(uint16_t color, uint32_t len);
+  void writePixels(const uint16_t *colors, uint32_t len);
+
+  // Window + solid color, queued. The caller must fence() before other drawing.
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+  // Queue a partly filled line buffer without waiting for it
+  void flush();
+
+  // Wait for every queued transfer to finish and release the bus
+  void fence();
+
+  bool dmaEnabled() const { return dmaEnabled_; }
+
+private:
+  // 8 panel rows per block; two blocks, 9 KB of DMA-capable RAM in total
+  static const uint32_t LINE_BUFFER_PIXELS = SCREEN_W * 8;
+
+  Adafruit_ST7789 &tft_;
+  bool dmaEnabled_ = false;
+  bool windowOpen_ = false;
+
+#if DISPLAY_TRANSPORT_DMA
+  void queueFill();
+  void waitOne();
+  void drain();
+  void restoreBusRegisters();
+
+  spi_device_handle_t device_ = nullptr;
+  spi_transaction_t trans_[2];
+  uint16_t *buffers_[2] = {nullptr, nullptr};
+  uint8_t fillIndex_ = 0;    // Buffer the CPU is filling
+  uint32_t fillLen_ = 0;     // Pixels in it so far
+  uint8_t inFlight_ = 0;     // Queued transactions not yet reaped
+
+  // Arduino SPI register state, put back before the CPU path uses the bus
+  uint32_t savedUser_ = 0;
+  uint32_t savedUser1_ = 0;
+  uint32_t savedUser2_ = 0;
+  uint32_t savedCtrl_ = 0;
+  uint32_t savedMisc_ = 0;
+  uint32_t savedClock_ = 0;
+  uint32_t savedDmaConf_ = 0;
+#endif
+};
@@ -0,0 +1,47 @@
+// =============================================================================
+// FIXED FORMAT - Decimal formatting of scaled integers, no float printf
+// =============================================================================
+
+#include "fixed_format.h"
+
+#include <stdio.h>
+
+namespace
+{
+
+int32_t powerOf10(uint8_t exponent)
+{
+  int32_t result = 1;
+  while (exponent--)
+  {
+    result *= 10;
+  }
+  return result;
+}
+
+} // namespace
+
+int32_t divRound(int32_t n, int32_t d)
+{
+  return (n >= 0) ? (n + d / 2) / d : -((-n + d / 2) / d);
+}
+
+int formatFixed(char *out, size_t size, int32_t value, uint8_t scaleDecimals, uint8_t decimals, bool showSign)
+{
+  if (decimals > scaleDecimals)
+  {
+    decimals = scaleDecimals;
+  }
+  int32_t rounded = divRound(value, powerOf10(scaleDecimals - decimals));
+
+  // Sign from the rounded value, so -0.04 at one decimal prints as 0.0
+  const char *sign = (rounded < 0) ? "-" : (showSign ? "+" : "");
+  uint32_t magnitude = (rounded < 0) ? (uint32_t)-(int64_t)rounded : (uint32_t)rounded;
+  if (decimals == 0)
+  {
+    return snprintf(out, size, "%s%lu", sign, (unsigned long)magnitude);
+  }
+  uint32_t unit = (uint32_t)powerOf10(decimals);
+  return snprintf(out, size, "%s%lu.%0*lu", sign, (unsigned long)(magnitude / unit), (int)decimals,
+                  (unsigned long)(magnitude % unit));
+}
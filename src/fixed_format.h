@@ -0,0 +1,20 @@
+#pragma once
+
+// =============================================================================
+// FIXED FORMAT - Decimal formatting of scaled integers, no float printf
+// =============================================================================
+// newlib's %f goes through dtoa, which takes its scratch space from the heap,
+// and loop() formats sensor values every second. These print fixed-point
+// values (hundredths of a degree and the like) with integer arithmetic only.
+
+#include <Arduino.h>
+
+// n / d rounded to nearest, halves away from zero; d > 0
+int32_t divRound(int32_t n, int32_t d);
+
+// Write `value`, which has `scaleDecimals` implied decimals, rounded to
+// `decimals` of them (at most scaleDecimals): formatFixed(buf, size, 6925, 2, 1)
+// gives "69.3". `showSign` adds "+" to values that aren't negative, like %+.
+// Returns what snprintf() returns.
+int formatFixed(char *out, size_t size, int32_t value, uint8_t scaleDecimals, uint8_t decimals,
+                bool showSign = false);
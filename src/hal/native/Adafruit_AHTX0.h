@@ -0,0 +1,22 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - AHT10/AHT20 sensor
+// =============================================================================
+// Readings come from sim::setSensor(); begin() fails when the simulator marks
+// the sensor as absent.
+
+#include "Arduino.h"
+
+typedef struct
+{
+  float temperature;       // degrees C
+  float relative_humidity; // percent
+} sensors_event_t;
+
+class Adafruit_AHTX0
+{
+public:
+  bool begin();
+  bool getEvent(sensors_event_t *humidity, sensors_event_t *temp);
+};
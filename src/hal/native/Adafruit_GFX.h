@@ -0,0 +1,94 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - Adafruit GFX core
+// =============================================================================
+// Re-implements the subset of Adafruit_GFX the firmware draws with, following
+// the library's primitive decomposition (drawChar -> writeFillRect per font
+// pixel, drawBitmap -> writePixel per set bit) so subclasses see the same call
+// pattern, and therefore the same bus traffic, as on the device.
+
+#include "Arduino.h"
+
+class Adafruit_GFX : public Print
+{
+public:
+  Adafruit_GFX(int16_t w, int16_t h);
+  virtual ~Adafruit_GFX() = default;
+
+  // Subclasses must provide this; everything else funnels into it by default
+  virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+  virtual void startWrite() {}
+  virtual void endWrite() {}
+  virtual void writePixel(int16_t x, int16_t y, uint16_t color) { drawPixel(x, y, color); }
+  virtual void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { writeFillRect(x, y, 1, h, color); }
+  virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { writeFillRect(x, y, w, 1, color); }
+
+  virtual void setRotation(uint8_t r);
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+  virtual void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+  virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color);
+  void drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color, uint16_t bg);
+  void drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[], int16_t w, int16_t h);
+
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size_x, uint8_t size_y);
+  void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg, uint8_t size)
+  {
+    drawChar(x, y, c, color, bg, size, size);
+  }
+
+  void setCursor(int16_t x, int16_t y) { cursor_x = x; cursor_y = y; }
+  void setTextColor(uint16_t c) { textcolor = textbgcolor = c; }
+  void setTextColor(uint16_t c, uint16_t bg) { textcolor = c; textbgcolor = bg; }
+  void setTextSize(uint8_t s) { setTextSize(s, s); }
+  void setTextSize(uint8_t sx, uint8_t sy) { textsize_x = sx > 0 ? sx : 1; textsize_y = sy > 0 ? sy : 1; }
+  void setTextWrap(bool w) { wrap = w; }
+  void cp437(bool x = true) { _cp437 = x; }
+
+  using Print::write;
+  size_t write(uint8_t c) override;
+
+  int16_t width() const { return _width; }
+  int16_t height() const { return _height; }
+  uint8_t getRotation() const { return rotation; }
+  int16_t getCursorX() const { return cursor_x; }
+  int16_t getCursorY() const { return cursor_y; }
+
+protected:
+  const int16_t WIDTH;
+  const int16_t HEIGHT;
+  int16_t _width;
+  int16_t _height;
+  int16_t cursor_x = 0;
+  int16_t cursor_y = 0;
+  uint16_t textcolor = 0xFFFF;
+  uint16_t textbgcolor = 0xFFFF;
+  uint8_t textsize_x = 1;
+  uint8_t textsize_y = 1;
+  uint8_t rotation = 0;
+  bool wrap = true;
+  bool _cp437 = false;
+};
+
+// 1-bit offscreen canvas, MSB-first rows padded to whole bytes like the library
+class GFXcanvas1 : public Adafruit_GFX
+{
+public:
+  GFXcanvas1(uint16_t w, uint16_t h);
+  ~GFXcanvas1();
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void fillScreen(uint16_t color) override;
+  bool getPixel(int16_t x, int16_t y) const;
+  uint8_t *getBuffer() const { return buffer; }
+
+private:
+  uint8_t *buffer;
+};
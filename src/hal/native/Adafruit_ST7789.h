@@ -0,0 +1,86 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - ST7789 panel
+// =============================================================================
+// In-memory RGB565 framebuffer with the Adafruit_SPITFT drawing interface.
+// Every primitive is charged the bytes the real driver would clock out over
+// SPI (an 11-byte CASET/RASET/RAMWR address window plus 2 bytes per pixel),
+// so render cost can be compared between implementations on the host.
+//
+// Vertical scroll (VSCRDEF/VSCRSADD) is modelled for rotation 3, where panel
+// RAM rows run along x: simPixel() shows what the glass would.
+
+#include <vector>
+
+#include "Adafruit_GFX.h"
+
+#define ST77XX_BLACK 0x0000
+#define ST77XX_WHITE 0xFFFF
+#define ST77XX_RED 0xF800
+#define ST77XX_GREEN 0x07E0
+#define ST77XX_BLUE 0x001F
+#define ST77XX_CYAN 0x07FF
+#define ST77XX_MAGENTA 0xF81F
+#define ST77XX_YELLOW 0xFFE0
+#define ST77XX_ORANGE 0xFC00
+
+class Adafruit_ST7789 : public Adafruit_GFX
+{
+public:
+  Adafruit_ST7789(int8_t cs, int8_t dc, int8_t rst);
+
+  void init(uint16_t width, uint16_t height, uint8_t spiMode = 0);
+  void setRotation(uint8_t m) override;
+
+  // Adafruit_SPITFT bus-level interface
+  void setSPISpeed(uint32_t freq) { (void)freq; }
+  void startWrite() override { inTransaction_ = true; }
+  void endWrite() override { inTransaction_ = false; }
+  virtual void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);  // Pure virtual in Adafruit_SPITFT
+  void writePixels(uint16_t *colors, uint32_t len, bool block = true, bool bigEndian = false);
+  void writeColor(uint16_t color, uint32_t len);
+  void pushColor(uint16_t color) { writeColor(color, 1); }
+  void writeCommand(uint8_t cmd);
+  void sendCommand(uint8_t commandByte, const uint8_t *dataBytes = nullptr, uint8_t numDataBytes = 0);
+
+  // Adafruit_SPITFT overrides of the GFX primitives
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void writePixel(int16_t x, int16_t y, uint16_t color) override;
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+  void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { writeFillRect(x, y, w, 1, color); }
+  void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { writeFillRect(x, y, 1, h, color); }
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override { writeFillRect(x, y, w, h, color); }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override { writeFillRect(x, y, w, 1, color); }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override { writeFillRect(x, y, 1, h, color); }
+
+  // Simulator hooks
+  uint16_t simPixel(int16_t x, int16_t y) const;
+  const std::vector<uint16_t> &simFramebuffer() const { return framebuffer_; }
+  uint64_t simBusBytes() const { return busBytes_; }
+  uint64_t simPixelsWritten() const { return pixelsWritten_; }
+  uint32_t simAddrWindows() const { return addrWindows_; }
+  void simResetCounters();
+  bool simWritePng(const char *path) const;
+
+private:
+  void pushPixel(uint16_t color);
+
+  uint16_t panelW_ = 240;
+  uint16_t panelH_ = 320;
+
+  // Vertical scroll, in RAM rows (the controller has 320)
+  uint16_t scrollTop_ = 0;
+  uint16_t scrollHeight_ = 320;
+  uint16_t scrollStart_ = 0;
+  std::vector<uint16_t> framebuffer_;
+  bool inTransaction_ = false;
+
+  // Current address window and write pointer (in rotated coordinates)
+  int16_t winX0_ = 0, winY0_ = 0, winX1_ = 0, winY1_ = 0;
+  int16_t winX_ = 0, winY_ = 0;
+
+  uint64_t busBytes_ = 0;
+  uint64_t pixelsWritten_ = 0;
+  uint32_t addrWindows_ = 0;
+};
@@ -0,0 +1,132 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - Arduino core subset
+// =============================================================================
+// Host-side stand-in for the parts of the ESP32 Arduino core the firmware uses.
+// Time is virtual (delay() advances it instantly), GPIO levels are driven by
+// the simulator, and Serial goes to stdout. See sim.h for the control surface.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// -----------------------------------------------------------------------------
+// Constants and attributes
+// -----------------------------------------------------------------------------
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const unsigned char *)(addr))
+#define pgm_read_word(addr) (*(const unsigned short *)(addr))
+
+#define IRAM_ATTR
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// -----------------------------------------------------------------------------
+// Timing (virtual clock)
+// -----------------------------------------------------------------------------
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+
+// -----------------------------------------------------------------------------
+// GPIO
+// -----------------------------------------------------------------------------
+
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+void digitalWrite(uint8_t pin, uint8_t val);
+void analogWrite(uint8_t pin, int value);
+
+// Handlers run when the simulator changes the pin (sim::setPin)
+#define digitalPinToInterrupt(p) (p)
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void detachInterrupt(uint8_t pin);
+
+// -----------------------------------------------------------------------------
+// Wall-clock time (esp32-hal-time)
+// -----------------------------------------------------------------------------
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec,
+                const char *server1, const char *server2 = nullptr, const char *server3 = nullptr);
+bool getLocalTime(struct tm *info, uint32_t ms = 5000);
+
+// -----------------------------------------------------------------------------
+// Serial
+// -----------------------------------------------------------------------------
+
+class HardwareSerial : public Stream
+{
+public:
+  void begin(unsigned long baud) { (void)baud; }
+  void end() {}
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *buffer, size_t size) override;
+  using Print::write;
+
+  operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+// -----------------------------------------------------------------------------
+// Chip services (ESP object)
+// -----------------------------------------------------------------------------
+
+class EspClass
+{
+public:
+  [[noreturn]] void restart();
+
+  // Heap figures are derived from the simulator's allocation tracker against
+  // a nominal ESP32-C3 heap size, so deltas are meaningful even on a PC.
+  uint32_t getHeapSize();
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+};
+
+extern EspClass ESP;
+
+using std::min;
+using std::max;
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
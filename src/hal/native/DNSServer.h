@@ -0,0 +1,22 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - DNSServer
+// =============================================================================
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class DNSServer
+{
+public:
+  bool start(uint16_t port, const String &domainName, const IPAddress &resolvedIP)
+  {
+    (void)port;
+    (void)domainName;
+    (void)resolvedIP;
+    return true;
+  }
+  void stop() {}
+  void processNextRequest() {}
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - HTTPClient
+// =============================================================================
+// Requests are answered from the simulator's route table (sim::addHttpRoute)
+// instead of the network. Unmatched URLs fail with a refused connection.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+#include "WiFi.h"
+
+namespace sim
+{
+struct HttpRoute;
+}
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+typedef enum
+{
+  HTTP_CODE_OK = 200,
+  HTTP_CODE_NO_CONTENT = 204,
+  HTTP_CODE_MOVED_PERMANENTLY = 301,
+  HTTP_CODE_FOUND = 302,
+  HTTP_CODE_NOT_MODIFIED = 304,
+  HTTP_CODE_BAD_REQUEST = 400,
+  HTTP_CODE_UNAUTHORIZED = 401,
+  HTTP_CODE_FORBIDDEN = 403,
+  HTTP_CODE_NOT_FOUND = 404,
+  HTTP_CODE_TOO_MANY_REQUESTS = 429,
+  HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+  HTTP_CODE_SERVICE_UNAVAILABLE = 503
+} t_http_codes;
+
+typedef enum
+{
+  HTTPC_DISABLE_FOLLOW_REDIRECTS,
+  HTTPC_STRICT_FOLLOW_REDIRECTS,
+  HTTPC_FORCE_FOLLOW_REDIRECTS
+} followRedirects_t;
+
+class HTTPClient
+{
+public:
+  bool begin(String url);
+  bool begin(WiFiClient &client, String url);
+  void end();
+
+  void setReuse(bool reuse) { reuse_ = reuse; }
+  void setTimeout(uint16_t timeout) { timeout_ = timeout; }
+  void setConnectTimeout(int32_t connectTimeout) { (void)connectTimeout; }
+  void setFollowRedirects(followRedirects_t follow) { (void)follow; }
+  void setUserAgent(const String &userAgent) { (void)userAgent; }
+  // Routes are always served with Content-Length, never chunked, so HTTP/1.0
+  // only matters for keep-alive (the real client turns reuse off)
+  void useHTTP10(bool usehttp10 = true) { if (usehttp10) reuse_ = false; }
+
+  void addHeader(const String &name, const String &value, bool first = false, bool replace = true);
+  void collectHeaders(const char *headerKeys[], const size_t headerKeysCount);
+  String header(const char *name);
+  bool hasHeader(const char *name);
+
+  int GET();
+
+  int getSize() { return size_; }
+  String getString();
+  WiFiClient &getStream() { return *stream_; }
+  WiFiClient *getStreamPtr() { return stream_; }
+
+  static String errorToString(int error);
+
+private:
+  bool requestMatchesValidators(const sim::HttpRoute &route);
+
+  std::string url_;
+  std::vector<std::pair<std::string, std::string>> requestHeaders_;
+  std::vector<std::string> collectKeys_;
+  std::vector<std::pair<std::string, std::string>> responseHeaders_;
+  WiFiClient ownClient_;
+  WiFiClient *stream_ = &ownClient_;
+  int size_ = -1;
+  bool reuse_ = true;
+  uint16_t timeout_ = 5000;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - IPAddress
+// =============================================================================
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "WString.h"
+
+class IPAddress
+{
+public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets_{a, b, c, d} {}
+  explicit IPAddress(uint32_t address)
+      : octets_{(uint8_t)address, (uint8_t)(address >> 8), (uint8_t)(address >> 16), (uint8_t)(address >> 24)} {}
+
+  operator uint32_t() const
+  {
+    return (uint32_t)octets_[0] | ((uint32_t)octets_[1] << 8) | ((uint32_t)octets_[2] << 16) | ((uint32_t)octets_[3] << 24);
+  }
+  uint8_t operator[](int index) const { return octets_[index]; }
+  bool operator==(const IPAddress &rhs) const { return (uint32_t)*this == (uint32_t)rhs; }
+
+  String toString() const
+  {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets_[0], octets_[1], octets_[2], octets_[3]);
+    return String(buf);
+  }
+
+private:
+  uint8_t octets_[4];
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - Preferences (NVS)
+// =============================================================================
+// Namespaces live in a process-wide map that the simulator can seed, save to
+// and load from a file, so "reboots" can be replayed across runs.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include <string>
+
+#include "WString.h"
+
+class Preferences
+{
+public:
+  bool begin(const char *name, bool readOnly = false, const char *partitionLabel = nullptr);
+  void end();
+
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putBool(const char *key, bool value);
+  size_t putInt(const char *key, int32_t value);
+  size_t putUInt(const char *key, uint32_t value);
+  size_t putULong64(const char *key, uint64_t value);
+  size_t putFloat(const char *key, float value);
+  size_t putString(const char *key, const char *value);
+  size_t putString(const char *key, const String &value) { return putString(key, value.c_str()); }
+  size_t putBytes(const char *key, const void *value, size_t len);
+
+  bool getBool(const char *key, bool defaultValue = false);
+  int32_t getInt(const char *key, int32_t defaultValue = 0);
+  uint32_t getUInt(const char *key, uint32_t defaultValue = 0);
+  uint64_t getULong64(const char *key, uint64_t defaultValue = 0);
+  float getFloat(const char *key, float defaultValue = NAN);
+  String getString(const char *key, const String &defaultValue = String());
+  size_t getString(const char *key, char *value, size_t maxLen);
+  size_t getBytesLength(const char *key);
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+
+private:
+  bool put(const char *key, const void *value, size_t len);
+  const std::string *get(const char *key);
+
+  std::string namespace_;
+  bool started_ = false;
+  bool readOnly_ = false;
+};
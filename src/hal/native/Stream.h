@@ -0,0 +1,43 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - Stream
+// =============================================================================
+
+#include "Print.h"
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { timeout_ = timeout; }
+  unsigned long getTimeout() const { return timeout_; }
+
+  // The simulator never blocks on I/O, so a short read means end of data
+  virtual size_t readBytes(char *buffer, size_t length)
+  {
+    size_t count = 0;
+    while (count < length)
+    {
+      int c = read();
+      if (c < 0) break;
+      buffer[count++] = (char)c;
+    }
+    return count;
+  }
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *)buffer, length); }
+
+  String readString()
+  {
+    String result;
+    int c;
+    while ((c = read()) >= 0) result += (char)c;
+    return result;
+  }
+
+protected:
+  unsigned long timeout_ = 1000;
+};
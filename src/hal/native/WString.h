@@ -0,0 +1,96 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - Arduino String
+// =============================================================================
+// API-compatible subset of the Arduino String class, backed by std::string so
+// its allocations show up in the simulator's heap tracker.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class String
+{
+public:
+  String(const char *cstr = "") { if (cstr) buffer_ = cstr; }
+  String(const String &str) = default;
+  String(String &&str) = default;
+  explicit String(char c) : buffer_(1, c) {}
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  explicit String(float value, unsigned int decimalPlaces = 2);
+  explicit String(double value, unsigned int decimalPlaces = 2);
+
+  String &operator=(const String &rhs) = default;
+  String &operator=(String &&rhs) = default;
+  String &operator=(const char *cstr)
+  {
+    if (cstr) buffer_ = cstr;
+    else buffer_.clear();
+    return *this;
+  }
+
+  bool reserve(unsigned int size) { buffer_.reserve(size); return true; }
+  unsigned int length() const { return (unsigned int)buffer_.size(); }
+  bool isEmpty() const { return buffer_.empty(); }
+  const char *c_str() const { return buffer_.c_str(); }
+
+  bool concat(const String &str) { buffer_ += str.buffer_; return true; }
+  bool concat(const char *cstr) { if (cstr) buffer_ += cstr; return true; }
+  bool concat(const char *cstr, unsigned int length) { if (cstr) buffer_.append(cstr, length); return true; }
+  bool concat(char c) { buffer_ += c; return true; }
+  bool concat(int value) { return concat(String(value)); }
+  bool concat(unsigned int value) { return concat(String(value)); }
+  bool concat(long value) { return concat(String(value)); }
+  bool concat(unsigned long value) { return concat(String(value)); }
+  bool concat(float value) { return concat(String(value)); }
+  bool concat(double value) { return concat(String(value)); }
+
+  template <typename T>
+  String &operator+=(const T &rhs) { concat(rhs); return *this; }
+
+  bool equals(const String &s) const { return buffer_ == s.buffer_; }
+  bool equals(const char *cstr) const { return buffer_ == (cstr ? cstr : ""); }
+  bool equalsIgnoreCase(const String &s) const;
+  bool startsWith(const String &prefix) const { return buffer_.compare(0, prefix.buffer_.size(), prefix.buffer_) == 0; }
+  bool endsWith(const String &suffix) const;
+
+  bool operator==(const String &rhs) const { return equals(rhs); }
+  bool operator==(const char *cstr) const { return equals(cstr); }
+  bool operator!=(const String &rhs) const { return !equals(rhs); }
+  bool operator!=(const char *cstr) const { return !equals(cstr); }
+  bool operator<(const String &rhs) const { return buffer_ < rhs.buffer_; }
+
+  char charAt(unsigned int index) const { return index < buffer_.size() ? buffer_[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+  char &operator[](unsigned int index) { return buffer_[index]; }
+
+  int indexOf(char ch, unsigned int fromIndex = 0) const;
+  int indexOf(const String &str, unsigned int fromIndex = 0) const;
+  int lastIndexOf(char ch) const;
+
+  String substring(unsigned int beginIndex) const { return substring(beginIndex, length()); }
+  String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+  void replace(const String &find, const String &replace);
+  void remove(unsigned int index, unsigned int count = (unsigned int)-1);
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+
+  long toInt() const;
+  float toFloat() const;
+  double toDouble() const;
+
+private:
+  std::string buffer_;
+};
+
+String operator+(const String &lhs, const String &rhs);
+String operator+(const String &lhs, const char *rhs);
+String operator+(const char *lhs, const String &rhs);
+String operator+(const String &lhs, char rhs);
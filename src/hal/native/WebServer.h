@@ -0,0 +1,72 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - WebServer
+// =============================================================================
+// Routes are recorded but nothing listens; the simulator can invoke a route
+// directly with sim::serveRequest() to exercise handlers.
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+
+enum HTTPMethod
+{
+  HTTP_ANY,
+  HTTP_GET,
+  HTTP_HEAD,
+  HTTP_POST,
+  HTTP_PUT,
+  HTTP_PATCH,
+  HTTP_DELETE,
+  HTTP_OPTIONS
+};
+
+class WebServer
+{
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit WebServer(int port = 80) : port_(port) {}
+
+  void begin() { running_ = true; }
+  void stop() { running_ = false; }
+  void handleClient() {}
+
+  void on(const String &uri, THandlerFunction handler) { on(uri, HTTP_ANY, handler); }
+  void on(const String &uri, HTTPMethod method, THandlerFunction handler);
+  void onNotFound(THandlerFunction handler) { notFound_ = handler; }
+
+  String arg(const String &name);
+  bool hasArg(const String &name);
+  String uri() { return String(uri_.c_str()); }
+
+  void sendHeader(const String &name, const String &value, bool first = false);
+  void send(int code, const char *contentType = nullptr, const String &content = String());
+  void send(int code, const String &contentType, const String &content) { send(code, contentType.c_str(), content); }
+
+  // Simulator hook: dispatch a request to the registered handler and return
+  // the response body. Query arguments are passed as name/value pairs.
+  String simRequest(const char *uri, const std::vector<std::pair<std::string, std::string>> &args = {});
+  int simLastStatus() const { return lastStatus_; }
+
+private:
+  struct Route
+  {
+    std::string uri;
+    HTTPMethod method;
+    THandlerFunction handler;
+  };
+
+  int port_;
+  bool running_ = false;
+  std::vector<Route> routes_;
+  THandlerFunction notFound_;
+  std::string uri_;
+  std::vector<std::pair<std::string, std::string>> args_;
+  std::string response_;
+  int lastStatus_ = 0;
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - WiFi
+// =============================================================================
+// Station mode "associates" after a simulated delay when the simulator's AP is
+// up (see sim::setNetworkUp): a scan of every channel, the join, then DHCP.
+// begin() with the AP's BSSID and channel skips the scan, a static config()
+// skips DHCP. When the AP goes down the station drops and stays down until
+// begin() or reconnect(); onEvent() handlers hear about every step. WiFiClient is only a byte source
+// for HTTPClient responses; there are no real sockets, but a connection stays
+// open between requests until stop(), a WiFi drop or the server's keep-alive
+// timeout (sim::setKeepAliveTimeout).
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+typedef enum
+{
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum
+{
+  WIFI_OFF = 0,
+  WIFI_STA = 1,
+  WIFI_AP = 2,
+  WIFI_AP_STA = 3
+} wifi_mode_t;
+
+typedef enum
+{
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+  ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+typedef void (*WiFiEventCb)(arduino_event_id_t event);
+typedef size_t wifi_event_id_t;
+
+class WiFiClient : public Stream
+{
+public:
+  virtual ~WiFiClient() = default;
+
+  virtual int connect(const char *host, uint16_t port);
+  virtual void stop() { body_.clear(); pos_ = 0; open_ = false; }
+  virtual uint8_t connected();
+
+  int available() override { return (int)(body_.size() - pos_); }
+  int read() override { return pos_ < body_.size() ? (uint8_t)body_[pos_++] : -1; }
+  int peek() override { return pos_ < body_.size() ? (uint8_t)body_[pos_] : -1; }
+  size_t readBytes(char *buffer, size_t length) override;
+
+  size_t write(uint8_t c) override { (void)c; return 1; }
+  size_t write(const uint8_t *buffer, size_t size) override { (void)buffer; return size; }
+  using Print::write;
+
+  // Simulator hook: load the bytes the next reads will return
+  void simLoad(const std::string &body);
+
+private:
+  std::string body_;
+  size_t pos_ = 0;
+  bool open_ = false;
+  uint64_t lastUseUs_ = 0;  // Connected or last answered; the server's idle timer
+};
+
+class WiFiClass
+{
+public:
+  wl_status_t begin(const char *ssid, const char *passphrase = nullptr, int32_t channel = 0,
+                    const uint8_t *bssid = nullptr, bool connect = true);
+  bool disconnect(bool wifioff = false, bool eraseap = false);
+  bool reconnect();
+  wl_status_t status();
+  bool isConnected() { return status() == WL_CONNECTED; }
+
+  bool mode(wifi_mode_t mode) { mode_ = mode; return true; }
+  wifi_mode_t getMode() const { return mode_; }
+  bool setSleep(bool enabled) { sleep_ = enabled; return true; }
+  bool getSleep() const { return sleep_; }
+  bool setAutoReconnect(bool autoReconnect) { (void)autoReconnect; return true; }  // Never reconnects by itself
+  void persistent(bool persistent) { (void)persistent; }
+
+  // A local_ip of 0.0.0.0 goes back to DHCP
+  bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress());
+
+  // ARDUINO_EVENT_MAX subscribes to every event. Handlers run from the
+  // simulator's timed events, standing in for the Arduino event task.
+  wifi_event_id_t onEvent(WiFiEventCb cbEvent, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+
+  bool softAP(const char *ssid, const char *passphrase = nullptr);
+  IPAddress softAPIP() { return IPAddress(192, 168, 4, 1); }
+
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(uint8_t dns_no = 0);
+  uint8_t *BSSID();
+  int32_t channel();
+  int8_t RSSI();
+  String SSID() { return String(ssid_.c_str()); }
+
+  // Simulator hook: the AP went down or came back
+  void simSetApUp(bool up);
+
+private:
+  wifi_mode_t mode_ = WIFI_OFF;
+  bool sleep_ = true;
+  bool started_ = false;
+  bool lost_ = false;            // Dropped by the AP since the last begin()
+  bool willConnect_ = false;     // This attempt finds the AP
+  uint32_t attempt_ = 0;         // Bumped by every begin(), reconnect() and drop
+  unsigned long beginAt_ = 0;
+  uint32_t connectDelayMs_ = 0;  // begin() to IP address (or to giving up)
+  uint32_t dhcpMs_ = 0;
+  IPAddress staticIp_;
+  IPAddress staticGateway_;
+  IPAddress staticSubnet_;
+  IPAddress staticDns_;
+  std::string ssid_;
+  std::vector<std::pair<WiFiEventCb, arduino_event_id_t>> handlers_;
+
+  void startAttempt(bool direct, bool rightAp);
+  void scheduleEvent(uint32_t afterMs, arduino_event_id_t event);
+  void dispatch(arduino_event_id_t event);
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,21 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - WiFiClientSecure
+// =============================================================================
+
+#include "WiFi.h"
+
+class WiFiClientSecure : public WiFiClient
+{
+public:
+  // A full handshake every time, taking the simulator's TLS handshake time
+  // (sim::setTlsHandshakeDelay); counted in sim::tlsHandshakeCount()
+  int connect(const char *host, uint16_t port) override;
+
+  void setInsecure() { insecure_ = true; }
+  void setCACert(const char *rootCA) { (void)rootCA; insecure_ = false; }
+
+private:
+  bool insecure_ = false;
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - esp_attr
+// =============================================================================
+// Placement attributes are meaningless on the host. RTC_NOINIT_ATTR variables
+// are plain globals, which survive a simulated ESP.restart() just as RTC memory
+// survives a software reset.
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
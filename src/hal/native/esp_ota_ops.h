@@ -0,0 +1,24 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - esp_ota_ops
+// =============================================================================
+// Two app partitions in memory, ota_0 running. The running one holds whatever
+// sim::setRunningImage() put there (blank flash otherwise); an update is
+// written to ota_1 and can be read back with sim::otaWrittenImage().
+
+#include "esp_partition.h"
+
+typedef uint32_t esp_ota_handle_t;
+
+#define OTA_SIZE_UNKNOWN 0xffffffff
+
+inline esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_OK; }
+
+const esp_partition_t *esp_ota_get_running_partition();
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *startFrom);
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t imageSize, esp_ota_handle_t *outHandle);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition);
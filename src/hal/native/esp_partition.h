@@ -0,0 +1,30 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - esp_partition
+// =============================================================================
+// The two app partitions, held in memory (see esp_ota_ops.h)
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+#ifndef ESP_FAIL
+#define ESP_FAIL (-1)
+#endif
+#ifndef ESP_ERR_INVALID_SIZE
+#define ESP_ERR_INVALID_SIZE 0x104
+#endif
+
+typedef struct
+{
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t srcOffset, void *dst, size_t size);
@@ -0,0 +1,13 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - esp_sntp
+// =============================================================================
+// configTime() "syncs" a fixed delay after it is called (see hal_core.cpp) and
+// then runs the notification callback, like the SNTP client does.
+
+#include <sys/time.h>
+
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback);
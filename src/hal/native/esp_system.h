@@ -0,0 +1,23 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - esp_system
+// =============================================================================
+
+typedef enum
+{
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO
+} esp_reset_reason_t;
+
+// Power-on for the first boot of a run, software after ESP.restart()
+esp_reset_reason_t esp_reset_reason();
@@ -0,0 +1,10 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - esp_timer
+// =============================================================================
+
+#include <stdint.h>
+
+// Microseconds since boot on the virtual clock
+int64_t esp_timer_get_time();
@@ -0,0 +1,23 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - FreeRTOS types and constants
+// =============================================================================
+// Just enough of FreeRTOS for the firmware's tasks; see hal_rtos.cpp. The tick
+// is 1 ms, as in the ESP32 Arduino core.
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define portMAX_DELAY ((TickType_t)0xFFFFFFFFu)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
@@ -0,0 +1,26 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - FreeRTOS tasks and direct-to-task notifications
+// =============================================================================
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *);
+typedef struct SimTask *TaskHandle_t;
+
+// Stack depth and priority are accepted but not modelled
+BaseType_t xTaskCreate(TaskFunction_t taskCode, const char *name, uint32_t stackDepth,
+                       void *param, UBaseType_t priority, TaskHandle_t *createdTask);
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+
+// Interrupt handlers run on whichever thread changed the pin; there is nothing
+// to preempt, so the woken flag is never set
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken);
+#define portYIELD_FROM_ISR() ((void)0)
@@ -0,0 +1,609 @@
+// =============================================================================
+// NATIVE HAL - Core: clock, GPIO, Serial, heap tracking, String/Print
+// =============================================================================
+
+#include <stdarg.h>
+#include <atomic>
+#include <new>
+
+#include "Arduino.h"
+#include "Adafruit_AHTX0.h"
+#include "esp_sntp.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "SPI.h"
+#include "Wire.h"
+#include "sim.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+SPIClass SPI;
+TwoWire Wire;
+
+// =============================================================================
+// HEAP TRACKING
+// =============================================================================
+// The native env links with -Wl,--wrap=malloc (and friends), so every C
+// allocation made from firmware code lands here, and operator new/delete are
+// replaced to route through the same path. Each block carries a small header
+// recording its size so frees can be accounted without asking the allocator.
+
+extern "C"
+{
+  void *__real_malloc(size_t size);
+  void *__real_calloc(size_t count, size_t size);
+  void *__real_realloc(void *ptr, size_t size);
+  void __real_free(void *ptr);
+}
+
+namespace
+{
+
+const uint32_t ALLOC_MAGIC = 0x5EA7A110;
+
+struct alignas(16) AllocHeader
+{
+  uint32_t magic;
+  uint32_t tracked;
+  size_t size;
+};
+
+std::atomic<size_t> heapLive{0};
+std::atomic<size_t> heapPeak{0};
+std::atomic<uint64_t> heapAllocations{0};
+thread_local int untrackedDepth = 0;
+thread_local uint64_t threadAllocations = 0;
+
+void *trackBlock(void *raw, size_t size)
+{
+  if (!raw) return nullptr;
+  AllocHeader *header = static_cast<AllocHeader *>(raw);
+  header->magic = ALLOC_MAGIC;
+  header->tracked = (untrackedDepth == 0);
+  header->size = size;
+
+  if (header->tracked)
+  {
+    size_t live = heapLive.fetch_add(size) + size;
+    size_t peak = heapPeak.load();
+    while (live > peak && !heapPeak.compare_exchange_weak(peak, live))
+    {
+    }
+    heapAllocations++;
+    threadAllocations++;
+  }
+  return header + 1;
+}
+
+// Returns the raw block for a user pointer and removes it from the totals
+void *untrackBlock(void *ptr)
+{
+  AllocHeader *header = static_cast<AllocHeader *>(ptr) - 1;
+  if (header->magic != ALLOC_MAGIC) return ptr;  // Not ours (allocated inside libc)
+  header->magic = 0;
+  if (header->tracked) heapLive.fetch_sub(header->size);
+  return header;
+}
+
+} // namespace
+
+extern "C"
+{
+
+void *__wrap_malloc(size_t size)
+{
+  return trackBlock(__real_malloc(sizeof(AllocHeader) + size), size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+  return trackBlock(__real_calloc(1, sizeof(AllocHeader) + count * size), count * size);
+}
+
+void __wrap_free(void *ptr)
+{
+  if (ptr) __real_free(untrackBlock(ptr));
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+  if (!ptr) return __wrap_malloc(size);
+  void *raw = __real_realloc(untrackBlock(ptr), sizeof(AllocHeader) + size);
+  return trackBlock(raw, size);
+}
+
+} // extern "C"
+
+void *operator new(size_t size)
+{
+  void *ptr = malloc(size);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+namespace sim
+{
+
+UntrackedScope::UntrackedScope() { untrackedDepth++; }
+UntrackedScope::~UntrackedScope() { untrackedDepth--; }
+
+HeapStats heapStats()
+{
+  return {heapLive.load(), heapPeak.load(), heapAllocations.load()};
+}
+
+void heapResetPeak()
+{
+  heapPeak.store(heapLive.load());
+}
+
+uint64_t heapThreadAllocations()
+{
+  return threadAllocations;
+}
+
+} // namespace sim
+
+uint32_t EspClass::getHeapSize() { return sim::SIM_HEAP_SIZE; }
+uint32_t EspClass::getFreeHeap() { return sim::SIM_HEAP_SIZE - heapLive.load(); }
+uint32_t EspClass::getMinFreeHeap() { return sim::SIM_HEAP_SIZE - heapPeak.load(); }
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
+
+namespace
+{
+
+esp_reset_reason_t resetReason = ESP_RST_POWERON;
+
+} // namespace
+
+esp_reset_reason_t esp_reset_reason() { return resetReason; }
+
+void EspClass::restart()
+{
+  Serial.println("[sim] ESP.restart()");
+  resetReason = ESP_RST_SW;
+  throw sim::RestartRequested();
+}
+
+// =============================================================================
+// CLOCK
+// =============================================================================
+// millis()/micros() read a virtual counter that only moves when the firmware
+// waits (delay) or the harness calls sim::advance(), which makes runs fast and
+// repeatable. With more than one task, delay() goes through the scheduler in
+// hal_rtos.cpp. time() is wrapped so it reports seconds since boot until NTP is
+// "synced", exactly like the device. SNTP answers SNTP_DELAY_MS after
+// configTime().
+
+namespace
+{
+
+const uint32_t SNTP_DELAY_MS = 180;
+
+std::atomic<uint64_t> virtualUs{0};
+time_t epochAtBoot = 1700000000;  // Overridden by sim::setEpoch()
+std::atomic<bool> timeSynced{false};
+long gmtOffsetSec = 0;
+sntp_sync_time_cb_t syncCallback = nullptr;
+
+time_t utcNow()
+{
+  time_t sinceBoot = (time_t)(virtualUs.load() / 1000000ULL);
+  return timeSynced ? epochAtBoot + sinceBoot : sinceBoot;
+}
+
+} // namespace
+
+extern "C"
+{
+
+time_t __wrap_time(time_t *out)
+{
+  time_t now = utcNow();
+  if (out) *out = now;
+  return now;
+}
+
+} // extern "C"
+
+unsigned long millis() { return (unsigned long)(virtualUs.load() / 1000ULL); }
+unsigned long micros() { return (unsigned long)virtualUs.load(); }
+void delay(uint32_t ms) { sim::sleepUs((uint64_t)ms * 1000ULL); }
+void delayMicroseconds(uint32_t us) { virtualUs += us; }
+void yield() {}
+
+void configTime(long gmtOffset_sec, int daylightOffset_sec,
+                const char *server1, const char *server2, const char *server3)
+{
+  (void)server1;
+  (void)server2;
+  (void)server3;
+  gmtOffsetSec = gmtOffset_sec + daylightOffset_sec;
+  if (timeSynced) return;
+
+  sim::at(virtualUs.load() + SNTP_DELAY_MS * 1000ULL, [] {
+    if (timeSynced.exchange(true)) return;
+    if (syncCallback)
+    {
+      struct timeval tv = {utcNow(), 0};
+      syncCallback(&tv);
+    }
+  });
+}
+
+void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback)
+{
+  syncCallback = callback;
+}
+
+int64_t esp_timer_get_time()
+{
+  return (int64_t)virtualUs.load();
+}
+
+bool getLocalTime(struct tm *info, uint32_t ms)
+{
+  if (!timeSynced)
+  {
+    // The real implementation polls for up to `ms` before giving up
+    delay(ms);
+    return false;
+  }
+  time_t local = utcNow() + gmtOffsetSec;
+  gmtime_r(&local, info);
+  return true;
+}
+
+namespace sim
+{
+
+void setEpoch(time_t utc) { epochAtBoot = utc; }
+void advance(uint32_t ms) { delay(ms); }
+uint64_t nowUs() { return virtualUs.load(); }
+time_t wallClock() { return epochAtBoot + (time_t)(virtualUs.load() / 1000000ULL); }
+
+void setNowUs(uint64_t us)
+{
+  if (us > virtualUs.load()) virtualUs.store(us);
+}
+
+} // namespace sim
+
+// =============================================================================
+// GPIO
+// =============================================================================
+
+namespace
+{
+
+const int PIN_COUNT = 64;
+int pinLevels[PIN_COUNT];
+int pinPwmValues[PIN_COUNT];
+bool pinDriven[PIN_COUNT];
+void (*pinHandlers[PIN_COUNT])(void);
+int pinHandlerModes[PIN_COUNT];
+
+} // namespace
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  if (pin >= PIN_COUNT || pinDriven[pin]) return;
+  pinLevels[pin] = (mode == INPUT_PULLUP) ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) { return pin < PIN_COUNT ? pinLevels[pin] : LOW; }
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+  if (pin < PIN_COUNT) pinLevels[pin] = val ? HIGH : LOW;
+}
+
+void analogWrite(uint8_t pin, int value)
+{
+  if (pin < PIN_COUNT) pinPwmValues[pin] = value;
+}
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode)
+{
+  if (pin >= PIN_COUNT) return;
+  pinHandlers[pin] = handler;
+  pinHandlerModes[pin] = mode;
+}
+
+void detachInterrupt(uint8_t pin)
+{
+  if (pin < PIN_COUNT) pinHandlers[pin] = nullptr;
+}
+
+namespace sim
+{
+
+void setPin(uint8_t pin, int level)
+{
+  if (pin >= PIN_COUNT) return;
+  pinDriven[pin] = true;
+  int old = pinLevels[pin];
+  pinLevels[pin] = level ? HIGH : LOW;
+
+  // Edge interrupt, delivered between loop() passes like a real ISR would be
+  int mode = pinHandlerModes[pin];
+  bool rising = (old == LOW && pinLevels[pin] == HIGH);
+  bool falling = (old == HIGH && pinLevels[pin] == LOW);
+  if (pinHandlers[pin] && ((rising && (mode & RISING)) || (falling && (mode & FALLING))))
+  {
+    pinHandlers[pin]();
+  }
+}
+
+int pinLevel(uint8_t pin) { return pin < PIN_COUNT ? pinLevels[pin] : LOW; }
+int pinPwm(uint8_t pin) { return pin < PIN_COUNT ? pinPwmValues[pin] : 0; }
+
+} // namespace sim
+
+// =============================================================================
+// SENSOR
+// =============================================================================
+
+namespace
+{
+
+bool sensorPresent = true;
+float sensorTemperatureC = 24.0f;
+float sensorHumidity = 42.0f;
+
+} // namespace
+
+bool Adafruit_AHTX0::begin() { return sensorPresent; }
+
+bool Adafruit_AHTX0::getEvent(sensors_event_t *humidity, sensors_event_t *temp)
+{
+  if (!sensorPresent) return false;
+  if (temp) temp->temperature = sensorTemperatureC;
+  if (humidity) humidity->relative_humidity = sensorHumidity;
+  return true;
+}
+
+namespace sim
+{
+
+void setSensorPresent(bool present) { sensorPresent = present; }
+
+void setSensor(float temperatureC, float humidityPercent)
+{
+  sensorTemperatureC = temperatureC;
+  sensorHumidity = humidityPercent;
+}
+
+} // namespace sim
+
+// =============================================================================
+// SERIAL / PRINT
+// =============================================================================
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  if (c == '\r') return 1;  // Host terminals only want \n
+  fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++) write(buffer[i]);
+  return size;
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+  while (size--) n += write(*buffer++);
+  return n;
+}
+
+// Same strategy as the ESP32 core: a 64-byte stack buffer, heap beyond that
+size_t Print::printf(const char *format, ...)
+{
+  char loc_buf[64];
+  char *temp = loc_buf;
+  va_list arg;
+  va_list copy;
+  va_start(arg, format);
+  va_copy(copy, arg);
+  int len = vsnprintf(temp, sizeof(loc_buf), format, copy);
+  va_end(copy);
+  if (len < 0)
+  {
+    va_end(arg);
+    return 0;
+  }
+  if (len >= (int)sizeof(loc_buf))
+  {
+    temp = (char *)malloc(len + 1);
+    if (temp == nullptr)
+    {
+      va_end(arg);
+      return 0;
+    }
+    len = vsnprintf(temp, len + 1, format, arg);
+  }
+  va_end(arg);
+  len = write((const uint8_t *)temp, len);
+  if (temp != loc_buf) free(temp);
+  return len;
+}
+
+size_t Print::print(long value, int base)
+{
+  if (base == DEC) return printf("%ld", value);
+  return print((unsigned long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+  return printf(base == HEX ? "%lX" : "%lu", value);
+}
+
+size_t Print::print(double value, int digits)
+{
+  return printf("%.*f", digits, value);
+}
+
+// =============================================================================
+// STRING
+// =============================================================================
+
+namespace
+{
+
+std::string formatInteger(unsigned long value, bool negative, unsigned char base)
+{
+  char buf[8 * sizeof(long) + 2];
+  char *p = buf + sizeof(buf) - 1;
+  *p = '\0';
+  if (base < 2) base = 10;
+  do
+  {
+    int digit = value % base;
+    *--p = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+    value /= base;
+  } while (value);
+  if (negative) *--p = '-';
+  return std::string(p);
+}
+
+std::string formatDouble(double value, unsigned int decimalPlaces)
+{
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, value);
+  return std::string(buf);
+}
+
+} // namespace
+
+String::String(unsigned char value, unsigned char base) : buffer_(formatInteger(value, false, base)) {}
+String::String(int value, unsigned char base)
+    : buffer_(base == 10 && value < 0 ? formatInteger(-(long)value, true, base) : formatInteger((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base) : buffer_(formatInteger(value, false, base)) {}
+String::String(long value, unsigned char base)
+    : buffer_(base == 10 && value < 0 ? formatInteger(-(unsigned long)value, true, base) : formatInteger((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base) : buffer_(formatInteger(value, false, base)) {}
+String::String(float value, unsigned int decimalPlaces) : buffer_(formatDouble(value, decimalPlaces)) {}
+String::String(double value, unsigned int decimalPlaces) : buffer_(formatDouble(value, decimalPlaces)) {}
+
+bool String::equalsIgnoreCase(const String &s) const
+{
+  if (buffer_.size() != s.buffer_.size()) return false;
+  for (size_t i = 0; i < buffer_.size(); i++)
+  {
+    if (tolower((unsigned char)buffer_[i]) != tolower((unsigned char)s.buffer_[i])) return false;
+  }
+  return true;
+}
+
+bool String::endsWith(const String &suffix) const
+{
+  if (suffix.buffer_.size() > buffer_.size()) return false;
+  return buffer_.compare(buffer_.size() - suffix.buffer_.size(), suffix.buffer_.size(), suffix.buffer_) == 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const
+{
+  size_t pos = buffer_.find(ch, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int fromIndex) const
+{
+  size_t pos = buffer_.find(str.buffer_, fromIndex);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+  size_t pos = buffer_.rfind(ch);
+  return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const
+{
+  if (beginIndex > endIndex) std::swap(beginIndex, endIndex);
+  if (beginIndex >= buffer_.size()) return String();
+  if (endIndex > buffer_.size()) endIndex = (unsigned int)buffer_.size();
+  String out;
+  out.buffer_ = buffer_.substr(beginIndex, endIndex - beginIndex);
+  return out;
+}
+
+void String::replace(const String &find, const String &replace)
+{
+  if (find.buffer_.empty()) return;
+  size_t pos = 0;
+  while ((pos = buffer_.find(find.buffer_, pos)) != std::string::npos)
+  {
+    buffer_.replace(pos, find.buffer_.size(), replace.buffer_);
+    pos += replace.buffer_.size();
+  }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+  if (index >= buffer_.size()) return;
+  buffer_.erase(index, count);
+}
+
+void String::toLowerCase()
+{
+  for (char &c : buffer_) c = (char)tolower((unsigned char)c);
+}
+
+void String::toUpperCase()
+{
+  for (char &c : buffer_) c = (char)toupper((unsigned char)c);
+}
+
+void String::trim()
+{
+  size_t begin = 0;
+  while (begin < buffer_.size() && isspace((unsigned char)buffer_[begin])) begin++;
+  size_t end = buffer_.size();
+  while (end > begin && isspace((unsigned char)buffer_[end - 1])) end--;
+  buffer_ = buffer_.substr(begin, end - begin);
+}
+
+long String::toInt() const { return atol(buffer_.c_str()); }
+float String::toFloat() const { return (float)atof(buffer_.c_str()); }
+double String::toDouble() const { return atof(buffer_.c_str()); }
+
+String operator+(const String &lhs, const String &rhs)
+{
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const String &lhs, const char *rhs)
+{
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const char *lhs, const String &rhs)
+{
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
+
+String operator+(const String &lhs, char rhs)
+{
+  String out(lhs);
+  out.concat(rhs);
+  return out;
+}
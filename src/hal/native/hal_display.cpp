@@ -0,0 +1,554 @@
+// =============================================================================
+// NATIVE HAL - Display: GFX primitives, ST7789 framebuffer, PNG dump
+// =============================================================================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_ST7789.h"
+#include "glcdfont.h"
+#include "sim.h"
+
+// =============================================================================
+// ADAFRUIT GFX
+// =============================================================================
+
+Adafruit_GFX::Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h)
+{
+}
+
+void Adafruit_GFX::setRotation(uint8_t r)
+{
+  rotation = r & 3;
+  _width = (rotation & 1) ? HEIGHT : WIDTH;
+  _height = (rotation & 1) ? WIDTH : HEIGHT;
+}
+
+void Adafruit_GFX::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  for (int16_t j = y; j < y + h; j++)
+  {
+    for (int16_t i = x; i < x + w; i++) writePixel(i, j, color);
+  }
+}
+
+void Adafruit_GFX::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+  startWrite();
+  writeFastVLine(x, y, h, color);
+  endWrite();
+}
+
+void Adafruit_GFX::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+  startWrite();
+  writeFastHLine(x, y, w, color);
+  endWrite();
+}
+
+void Adafruit_GFX::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  startWrite();
+  writeFillRect(x, y, w, h, color);
+  endWrite();
+}
+
+void Adafruit_GFX::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color)
+{
+  if (x0 == x1)
+  {
+    if (y0 > y1) std::swap(y0, y1);
+    drawFastVLine(x0, y0, y1 - y0 + 1, color);
+    return;
+  }
+  if (y0 == y1)
+  {
+    if (x0 > x1) std::swap(x0, x1);
+    drawFastHLine(x0, y0, x1 - x0 + 1, color);
+    return;
+  }
+
+  // Bresenham, as in Adafruit_GFX::writeLine
+  bool steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep)
+  {
+    std::swap(x0, y0);
+    std::swap(x1, y1);
+  }
+  if (x0 > x1)
+  {
+    std::swap(x0, x1);
+    std::swap(y0, y1);
+  }
+  int16_t dx = x1 - x0;
+  int16_t dy = abs(y1 - y0);
+  int16_t err = dx / 2;
+  int16_t ystep = (y0 < y1) ? 1 : -1;
+
+  startWrite();
+  for (; x0 <= x1; x0++)
+  {
+    if (steep) writePixel(y0, x0, color);
+    else writePixel(x0, y0, color);
+    err -= dy;
+    if (err < 0)
+    {
+      y0 += ystep;
+      err += dx;
+    }
+  }
+  endWrite();
+}
+
+void Adafruit_GFX::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  startWrite();
+  writeFastHLine(x, y, w, color);
+  writeFastHLine(x, y + h - 1, w, color);
+  writeFastVLine(x, y, h, color);
+  writeFastVLine(x + w - 1, y, h, color);
+  endWrite();
+}
+
+void Adafruit_GFX::drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color)
+{
+  int16_t byteWidth = (w + 7) / 8;
+  uint8_t b = 0;
+
+  startWrite();
+  for (int16_t j = 0; j < h; j++, y++)
+  {
+    for (int16_t i = 0; i < w; i++)
+    {
+      if (i & 7) b <<= 1;
+      else b = pgm_read_byte(&bitmap[j * byteWidth + i / 8]);
+      if (b & 0x80) writePixel(x + i, y, color);
+    }
+  }
+  endWrite();
+}
+
+void Adafruit_GFX::drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[], int16_t w, int16_t h, uint16_t color, uint16_t bg)
+{
+  int16_t byteWidth = (w + 7) / 8;
+  uint8_t b = 0;
+
+  startWrite();
+  for (int16_t j = 0; j < h; j++, y++)
+  {
+    for (int16_t i = 0; i < w; i++)
+    {
+      if (i & 7) b <<= 1;
+      else b = pgm_read_byte(&bitmap[j * byteWidth + i / 8]);
+      writePixel(x + i, y, (b & 0x80) ? color : bg);
+    }
+  }
+  endWrite();
+}
+
+void Adafruit_GFX::drawRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[], int16_t w, int16_t h)
+{
+  startWrite();
+  for (int16_t j = 0; j < h; j++, y++)
+  {
+    for (int16_t i = 0; i < w; i++) writePixel(x + i, y, bitmap[j * w + i]);
+  }
+  endWrite();
+}
+
+void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color, uint16_t bg,
+                            uint8_t size_x, uint8_t size_y)
+{
+  if ((x >= _width) || (y >= _height) || ((x + 6 * size_x - 1) < 0) || ((y + 8 * size_y - 1) < 0))
+  {
+    return;
+  }
+
+  if (!_cp437 && (c >= 176)) c++;  // Handle 'classic' charset behavior
+
+  startWrite();
+  for (int8_t i = 0; i < 5; i++)
+  {
+    uint8_t line = glcdfont[c * 5 + i];
+    for (int8_t j = 0; j < 8; j++, line >>= 1)
+    {
+      if (line & 1)
+      {
+        if (size_x == 1 && size_y == 1) writePixel(x + i, y + j, color);
+        else writeFillRect(x + i * size_x, y + j * size_y, size_x, size_y, color);
+      }
+      else if (bg != color)
+      {
+        if (size_x == 1 && size_y == 1) writePixel(x + i, y + j, bg);
+        else writeFillRect(x + i * size_x, y + j * size_y, size_x, size_y, bg);
+      }
+    }
+  }
+  if (bg != color)
+  {
+    // Opaque text also paints the gap column
+    if (size_x == 1 && size_y == 1) writeFastVLine(x + 5, y, 8, bg);
+    else writeFillRect(x + 5 * size_x, y, size_x, 8 * size_y, bg);
+  }
+  endWrite();
+}
+
+size_t Adafruit_GFX::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursor_x = 0;
+    cursor_y += textsize_y * 8;
+  }
+  else if (c != '\r')
+  {
+    if (wrap && ((cursor_x + textsize_x * 6) > _width))
+    {
+      cursor_x = 0;
+      cursor_y += textsize_y * 8;
+    }
+    drawChar(cursor_x, cursor_y, c, textcolor, textbgcolor, textsize_x, textsize_y);
+    cursor_x += textsize_x * 6;
+  }
+  return 1;
+}
+
+// =============================================================================
+// GFX CANVAS
+// =============================================================================
+
+GFXcanvas1::GFXcanvas1(uint16_t w, uint16_t h) : Adafruit_GFX(w, h)
+{
+  buffer = (uint8_t *)calloc(((w + 7) / 8) * h, 1);
+}
+
+GFXcanvas1::~GFXcanvas1()
+{
+  free(buffer);
+}
+
+void GFXcanvas1::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+  if (!buffer || x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) return;
+  uint8_t *ptr = &buffer[(x / 8) + y * ((WIDTH + 7) / 8)];
+  if (color) *ptr |= 0x80 >> (x & 7);
+  else *ptr &= ~(0x80 >> (x & 7));
+}
+
+void GFXcanvas1::fillScreen(uint16_t color)
+{
+  if (buffer) memset(buffer, color ? 0xFF : 0x00, ((WIDTH + 7) / 8) * HEIGHT);
+}
+
+bool GFXcanvas1::getPixel(int16_t x, int16_t y) const
+{
+  if (!buffer || x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) return false;
+  return (buffer[(x / 8) + y * ((WIDTH + 7) / 8)] & (0x80 >> (x & 7))) != 0;
+}
+
+// =============================================================================
+// ST7789
+// =============================================================================
+
+namespace
+{
+
+// Bytes on the wire for CASET + 4 data, RASET + 4 data, RAMWR
+const uint32_t ADDR_WINDOW_BYTES = 11;
+
+const uint16_t PANEL_RAM_ROWS = 320;  // Controller RAM; the panel shows the middle rows
+const uint8_t ST7789_VSCRDEF = 0x33;
+const uint8_t ST7789_VSCRSADD = 0x37;
+
+} // namespace
+
+Adafruit_ST7789::Adafruit_ST7789(int8_t cs, int8_t dc, int8_t rst) : Adafruit_GFX(240, 320)
+{
+  (void)cs;
+  (void)dc;
+  (void)rst;
+}
+
+void Adafruit_ST7789::init(uint16_t width, uint16_t height, uint8_t spiMode)
+{
+  (void)spiMode;
+  panelW_ = width;
+  panelH_ = height;
+  {
+    sim::UntrackedScope untracked;  // Panel RAM, not MCU heap
+    framebuffer_.assign((size_t)width * height, 0x0000);
+  }
+  scrollTop_ = 0;
+  scrollHeight_ = PANEL_RAM_ROWS;
+  scrollStart_ = 0;
+  setRotation(0);
+}
+
+void Adafruit_ST7789::setRotation(uint8_t m)
+{
+  rotation = m & 3;
+  _width = (rotation & 1) ? panelH_ : panelW_;
+  _height = (rotation & 1) ? panelW_ : panelH_;
+  busBytes_ += 2;  // MADCTL + 1 data byte
+}
+
+void Adafruit_ST7789::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h)
+{
+  winX0_ = x;
+  winY0_ = y;
+  winX1_ = x + w - 1;
+  winY1_ = y + h - 1;
+  winX_ = winX0_;
+  winY_ = winY0_;
+  busBytes_ += ADDR_WINDOW_BYTES;
+  addrWindows_++;
+}
+
+void Adafruit_ST7789::pushPixel(uint16_t color)
+{
+  if (winX_ >= 0 && winX_ < _width && winY_ >= 0 && winY_ < _height && !framebuffer_.empty())
+  {
+    framebuffer_[(size_t)winY_ * _width + winX_] = color;
+  }
+  busBytes_ += 2;
+  pixelsWritten_++;
+
+  if (++winX_ > winX1_)
+  {
+    winX_ = winX0_;
+    if (++winY_ > winY1_) winY_ = winY0_;
+  }
+}
+
+void Adafruit_ST7789::writePixels(uint16_t *colors, uint32_t len, bool block, bool bigEndian)
+{
+  (void)block;
+  while (len--)
+  {
+    uint16_t color = *colors++;
+    if (bigEndian) color = (uint16_t)((color << 8) | (color >> 8));
+    pushPixel(color);
+  }
+}
+
+void Adafruit_ST7789::writeColor(uint16_t color, uint32_t len)
+{
+  while (len--) pushPixel(color);
+}
+
+void Adafruit_ST7789::writeCommand(uint8_t cmd)
+{
+  (void)cmd;
+  busBytes_ += 1;
+}
+
+void Adafruit_ST7789::sendCommand(uint8_t commandByte, const uint8_t *dataBytes, uint8_t numDataBytes)
+{
+  if (commandByte == ST7789_VSCRDEF && numDataBytes == 6)
+  {
+    scrollTop_ = (uint16_t)((dataBytes[0] << 8) | dataBytes[1]);
+    scrollHeight_ = (uint16_t)((dataBytes[2] << 8) | dataBytes[3]);
+  }
+  else if (commandByte == ST7789_VSCRSADD && numDataBytes == 2)
+  {
+    scrollStart_ = (uint16_t)((dataBytes[0] << 8) | dataBytes[1]);
+  }
+  busBytes_ += 1 + numDataBytes;
+}
+
+void Adafruit_ST7789::drawPixel(int16_t x, int16_t y, uint16_t color)
+{
+  startWrite();
+  writePixel(x, y, color);
+  endWrite();
+}
+
+void Adafruit_ST7789::writePixel(int16_t x, int16_t y, uint16_t color)
+{
+  if ((x >= 0) && (x < _width) && (y >= 0) && (y < _height))
+  {
+    setAddrWindow(x, y, 1, 1);
+    pushPixel(color);
+  }
+}
+
+void Adafruit_ST7789::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  // Clip exactly like Adafruit_SPITFT::writeFillRect
+  if (w < 0)
+  {
+    x += w + 1;
+    w = -w;
+  }
+  if (x < 0)
+  {
+    w += x;
+    x = 0;
+  }
+  if (x + w > _width) w = _width - x;
+  if (h < 0)
+  {
+    y += h + 1;
+    h = -h;
+  }
+  if (y < 0)
+  {
+    h += y;
+    y = 0;
+  }
+  if (y + h > _height) h = _height - y;
+  if (w <= 0 || h <= 0) return;
+
+  setAddrWindow(x, y, w, h);
+  writeColor(color, (uint32_t)w * h);
+}
+
+uint16_t Adafruit_ST7789::simPixel(int16_t x, int16_t y) const
+{
+  if (x < 0 || x >= _width || y < 0 || y >= _height || framebuffer_.empty()) return 0;
+
+  // Lines in the scroll area show RAM from scrollStart_ on, wrapping within it
+  int16_t rowOffset = (int16_t)((PANEL_RAM_ROWS - _width) / 2);
+  int16_t row = x + rowOffset;
+  if (rotation == 3 && scrollHeight_ > 0 && row >= scrollTop_ && row < scrollTop_ + scrollHeight_)
+  {
+    int32_t shown = scrollTop_ + ((row - scrollTop_) + (scrollStart_ - scrollTop_) + scrollHeight_) % scrollHeight_;
+    x = (int16_t)(shown - rowOffset);
+    if (x < 0 || x >= _width) return 0;
+  }
+  return framebuffer_[(size_t)y * _width + x];
+}
+
+void Adafruit_ST7789::simResetCounters()
+{
+  busBytes_ = 0;
+  pixelsWritten_ = 0;
+  addrWindows_ = 0;
+}
+
+// =============================================================================
+// PNG OUTPUT
+// =============================================================================
+// Minimal encoder: 8-bit RGB, one IDAT of uncompressed ("stored") deflate
+// blocks. Files are ~200 KB but need no zlib.
+
+namespace
+{
+
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t len)
+{
+  static uint32_t table[256];
+  static bool tableReady = false;
+  if (!tableReady)
+  {
+    for (uint32_t n = 0; n < 256; n++)
+    {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+    tableReady = true;
+  }
+  for (size_t i = 0; i < len; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc;
+}
+
+void putU32(std::vector<uint8_t> &out, uint32_t v)
+{
+  out.push_back((uint8_t)(v >> 24));
+  out.push_back((uint8_t)(v >> 16));
+  out.push_back((uint8_t)(v >> 8));
+  out.push_back((uint8_t)v);
+}
+
+void writeChunk(FILE *f, const char *type, const std::vector<uint8_t> &data)
+{
+  std::vector<uint8_t> header;
+  putU32(header, (uint32_t)data.size());
+  fwrite(header.data(), 1, 4, f);
+
+  uint32_t crc = crc32Update(0xFFFFFFFFu, (const uint8_t *)type, 4);
+  crc = crc32Update(crc, data.data(), data.size());
+  fwrite(type, 1, 4, f);
+  if (!data.empty()) fwrite(data.data(), 1, data.size(), f);
+
+  std::vector<uint8_t> trailer;
+  putU32(trailer, crc ^ 0xFFFFFFFFu);
+  fwrite(trailer.data(), 1, 4, f);
+}
+
+} // namespace
+
+bool Adafruit_ST7789::simWritePng(const char *path) const
+{
+  sim::UntrackedScope untracked;
+
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+
+  static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+  fwrite(signature, 1, sizeof(signature), f);
+
+  std::vector<uint8_t> ihdr;
+  putU32(ihdr, (uint32_t)_width);
+  putU32(ihdr, (uint32_t)_height);
+  ihdr.push_back(8);  // Bit depth
+  ihdr.push_back(2);  // Truecolor
+  ihdr.push_back(0);  // Deflate
+  ihdr.push_back(0);  // Adaptive filtering
+  ihdr.push_back(0);  // No interlace
+  writeChunk(f, "IHDR", ihdr);
+
+  // Raw scanlines: filter byte 0 followed by RGB888 expanded from RGB565
+  std::vector<uint8_t> raw;
+  raw.reserve((size_t)_height * (1 + _width * 3));
+  for (int16_t y = 0; y < _height; y++)
+  {
+    raw.push_back(0);
+    for (int16_t x = 0; x < _width; x++)
+    {
+      uint16_t c = simPixel(x, y);
+      uint8_t r = (c >> 11) & 0x1F;
+      uint8_t g = (c >> 5) & 0x3F;
+      uint8_t b = c & 0x1F;
+      raw.push_back((uint8_t)((r << 3) | (r >> 2)));
+      raw.push_back((uint8_t)((g << 2) | (g >> 4)));
+      raw.push_back((uint8_t)((b << 3) | (b >> 2)));
+    }
+  }
+
+  std::vector<uint8_t> zlib;
+  zlib.push_back(0x78);
+  zlib.push_back(0x01);
+  size_t offset = 0;
+  do
+  {
+    size_t blockLen = raw.size() - offset;
+    if (blockLen > 65535) blockLen = 65535;
+    bool final = (offset + blockLen == raw.size());
+    zlib.push_back(final ? 1 : 0);
+    zlib.push_back((uint8_t)blockLen);
+    zlib.push_back((uint8_t)(blockLen >> 8));
+    zlib.push_back((uint8_t)~blockLen);
+    zlib.push_back((uint8_t)(~blockLen >> 8));
+    zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockLen);
+    offset += blockLen;
+  } while (offset < raw.size());
+
+  uint32_t a = 1, b = 0;
+  for (uint8_t byte : raw)
+  {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  putU32(zlib, (b << 16) | a);
+  writeChunk(f, "IDAT", zlib);
+  writeChunk(f, "IEND", std::vector<uint8_t>());
+
+  bool ok = (ferror(f) == 0);
+  fclose(f);
+  return ok;
+}
@@ -0,0 +1,560 @@
+// =============================================================================
+// NATIVE HAL - Network: WiFi, HTTP route table, web server
+// =============================================================================
+
+#include <string.h>
+#include <strings.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "HTTPClient.h"
+#include "WebServer.h"
+#include "WiFi.h"
+#include "WiFiClientSecure.h"
+#include "sim.h"
+
+WiFiClass WiFi;
+
+namespace
+{
+
+bool networkUp = true;
+uint32_t associateDelayMs = 1500;
+const uint32_t SCAN_DELAY_MS = 1000;  // All-channel scan, the start of associateDelayMs
+const uint32_t DHCP_DELAY_MS = 240;   // The end of associateDelayMs
+const uint32_t PROBE_FAIL_MS = 300;   // Giving up on a BSSID that doesn't answer on its channel
+const uint8_t AP_BSSID[6] = {0x24, 0xA4, 0x3C, 0x5E, 0x10, 0x2B};
+const int32_t AP_CHANNEL = 6;
+const IPAddress LEASE_IP(192, 168, 1, 77);
+const IPAddress LEASE_GATEWAY(192, 168, 1, 1);
+const IPAddress LEASE_SUBNET(255, 255, 255, 0);
+sim::WiFiStats wifiStats = {};
+unsigned long firstBeginAt = 0;
+bool begunOnce = false;
+uint32_t tlsHandshakeMs = 380;
+uint32_t keepAliveTimeoutMs = 60000;
+std::vector<sim::HttpRoute> httpRoutes;
+uint32_t httpRequests = 0;
+uint32_t tlsHandshakes = 0;
+uint64_t httpBytes = 0;
+
+} // namespace
+
+// =============================================================================
+// WIFI
+// =============================================================================
+
+wl_status_t WiFiClass::begin(const char *ssid, const char *passphrase, int32_t channel,
+                             const uint8_t *bssid, bool connect)
+{
+  (void)passphrase;
+  ssid_ = ssid ? ssid : "";
+  if (mode_ == WIFI_OFF) mode_ = WIFI_STA;
+  started_ = connect;
+  if (!started_) return status();
+  if (!begunOnce)
+  {
+    begunOnce = true;
+    firstBeginAt = millis();
+  }
+
+  // With a BSSID the driver only probes that AP on the given channel
+  bool direct = (bssid != nullptr);
+  bool rightAp = !direct || (channel == AP_CHANNEL && memcmp(bssid, AP_BSSID, sizeof(AP_BSSID)) == 0);
+  startAttempt(direct, rightAp);
+  return status();
+}
+
+void WiFiClass::startAttempt(bool direct, bool rightAp)
+{
+  attempt_++;
+  lost_ = false;
+  beginAt_ = millis();
+  wifiStats.attempts++;
+  if (!direct) wifiStats.scans++;
+
+  bool staticIp = ((uint32_t)staticIp_ != 0);
+  dhcpMs_ = staticIp ? 0 : std::min(DHCP_DELAY_MS, associateDelayMs);
+  uint32_t scanMs = (associateDelayMs > SCAN_DELAY_MS + DHCP_DELAY_MS) ? SCAN_DELAY_MS : 0;
+  willConnect_ = networkUp && rightAp;
+  if (!willConnect_)
+  {
+    connectDelayMs_ = direct ? PROBE_FAIL_MS : SCAN_DELAY_MS;
+    scheduleEvent(connectDelayMs_, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+    return;
+  }
+
+  // Associated, then an address once DHCP is done, on the same timeline as status()
+  connectDelayMs_ = associateDelayMs - (direct ? scanMs : 0) - (staticIp ? std::min(DHCP_DELAY_MS, associateDelayMs) : 0);
+  scheduleEvent(connectDelayMs_ - dhcpMs_, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+  scheduleEvent(connectDelayMs_, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventCb cbEvent, arduino_event_id_t event)
+{
+  handlers_.emplace_back(cbEvent, event);
+  return handlers_.size();
+}
+
+void WiFiClass::scheduleEvent(uint32_t afterMs, arduino_event_id_t event)
+{
+  uint32_t attempt = attempt_;
+  sim::at(sim::nowUs() + afterMs * 1000ULL, [this, event, attempt] {
+    if (!started_ || attempt_ != attempt) return;  // Disconnected, dropped or restarted since
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+    {
+      wifiStats.connects++;
+      if (wifiStats.connects == 1) wifiStats.firstIpMs = millis() - firstBeginAt;
+    }
+    dispatch(event);
+  });
+}
+
+void WiFiClass::dispatch(arduino_event_id_t event)
+{
+  for (const auto &handler : handlers_)
+  {
+    if (handler.second == event || handler.second == ARDUINO_EVENT_MAX) handler.first(event);
+  }
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap)
+{
+  (void)eraseap;
+  started_ = false;
+  attempt_++;
+  if (wifioff) mode_ = WIFI_OFF;
+  return true;
+}
+
+bool WiFiClass::reconnect()
+{
+  started_ = true;
+  startAttempt(false, true);
+  return true;
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1)
+{
+  staticIp_ = local_ip;
+  staticGateway_ = gateway;
+  staticSubnet_ = subnet;
+  staticDns_ = dns1;
+  return true;
+}
+
+wl_status_t WiFiClass::status()
+{
+  if (!started_) return WL_DISCONNECTED;
+  if (lost_) return WL_CONNECTION_LOST;
+  if (millis() - beginAt_ < connectDelayMs_) return WL_DISCONNECTED;
+  return willConnect_ ? WL_CONNECTED : WL_NO_SSID_AVAIL;
+}
+
+// The AP going down drops the station at once; it comes back up on its own,
+// but the station only finds it again on the next begin()
+void WiFiClass::simSetApUp(bool up)
+{
+  networkUp = up;
+  if (up || !started_ || lost_) return;
+  attempt_++;  // Whatever this attempt still had scheduled won't happen
+  lost_ = true;
+  dispatch(ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+}
+
+bool WiFiClass::softAP(const char *ssid, const char *passphrase)
+{
+  (void)passphrase;
+  ssid_ = ssid ? ssid : "";
+  return true;
+}
+
+IPAddress WiFiClass::localIP()
+{
+  if (status() != WL_CONNECTED) return IPAddress();
+  return (uint32_t)staticIp_ != 0 ? staticIp_ : LEASE_IP;
+}
+
+IPAddress WiFiClass::gatewayIP()
+{
+  if (status() != WL_CONNECTED) return IPAddress();
+  return (uint32_t)staticIp_ != 0 ? staticGateway_ : LEASE_GATEWAY;
+}
+
+IPAddress WiFiClass::subnetMask()
+{
+  if (status() != WL_CONNECTED) return IPAddress();
+  return (uint32_t)staticIp_ != 0 ? staticSubnet_ : LEASE_SUBNET;
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t dns_no)
+{
+  if (status() != WL_CONNECTED || dns_no > 0) return IPAddress();
+  return (uint32_t)staticIp_ != 0 ? staticDns_ : LEASE_GATEWAY;
+}
+
+uint8_t *WiFiClass::BSSID()
+{
+  static uint8_t bssid[6];
+  if (status() != WL_CONNECTED) return nullptr;
+  memcpy(bssid, AP_BSSID, sizeof(bssid));
+  return bssid;
+}
+
+int32_t WiFiClass::channel()
+{
+  return status() == WL_CONNECTED ? AP_CHANNEL : 0;
+}
+
+int8_t WiFiClass::RSSI()
+{
+  return status() == WL_CONNECTED ? -58 : 0;
+}
+
+int WiFiClient::connect(const char *host, uint16_t port)
+{
+  (void)host;
+  (void)port;
+  if (WiFi.status() != WL_CONNECTED) return 0;
+  open_ = true;
+  lastUseUs_ = sim::nowUs();
+  return 1;
+}
+
+uint8_t WiFiClient::connected()
+{
+  if (pos_ < body_.size()) return 1;  // Unread bytes count, like on the device
+  if (open_ && (WiFi.status() != WL_CONNECTED || sim::nowUs() - lastUseUs_ >= keepAliveTimeoutMs * 1000ULL))
+  {
+    open_ = false;  // Dropped with the link, or closed by the server
+  }
+  return open_;
+}
+
+void WiFiClient::simLoad(const std::string &body)
+{
+  body_ = body;
+  pos_ = 0;
+  lastUseUs_ = sim::nowUs();
+}
+
+int WiFiClientSecure::connect(const char *host, uint16_t port)
+{
+  if (WiFi.status() != WL_CONNECTED) return 0;
+  delay(tlsHandshakeMs);
+  tlsHandshakes++;
+  return WiFiClient::connect(host, port);
+}
+
+size_t WiFiClient::readBytes(char *buffer, size_t length)
+{
+  size_t count = body_.size() - pos_;
+  if (count > length) count = length;
+  memcpy(buffer, body_.data() + pos_, count);
+  pos_ += count;
+  return count;
+}
+
+// =============================================================================
+// HTTP CLIENT
+// =============================================================================
+
+bool HTTPClient::begin(String url)
+{
+  url_ = url.c_str();
+  stream_ = &ownClient_;
+  requestHeaders_.clear();
+  responseHeaders_.clear();
+  size_ = -1;
+  return true;
+}
+
+bool HTTPClient::begin(WiFiClient &client, String url)
+{
+  bool ok = begin(url);
+  stream_ = &client;
+  return ok;
+}
+
+void HTTPClient::end()
+{
+  if (!reuse_) stream_->stop();
+}
+
+void HTTPClient::addHeader(const String &name, const String &value, bool first, bool replace)
+{
+  (void)first;
+  if (replace)
+  {
+    for (auto &header : requestHeaders_)
+    {
+      if (strcasecmp(header.first.c_str(), name.c_str()) == 0)
+      {
+        header.second = value.c_str();
+        return;
+      }
+    }
+  }
+  requestHeaders_.emplace_back(name.c_str(), value.c_str());
+}
+
+void HTTPClient::collectHeaders(const char *headerKeys[], const size_t headerKeysCount)
+{
+  collectKeys_.assign(headerKeys, headerKeys + headerKeysCount);
+}
+
+String HTTPClient::header(const char *name)
+{
+  for (const auto &header : responseHeaders_)
+  {
+    if (strcasecmp(header.first.c_str(), name) == 0) return String(header.second.c_str());
+  }
+  return String();
+}
+
+bool HTTPClient::hasHeader(const char *name)
+{
+  for (const auto &header : responseHeaders_)
+  {
+    if (strcasecmp(header.first.c_str(), name) == 0) return true;
+  }
+  return false;
+}
+
+int HTTPClient::GET()
+{
+  if (WiFi.status() != WL_CONNECTED) return HTTPC_ERROR_NOT_CONNECTED;
+
+  std::string accept;
+  {
+    sim::UntrackedScope untracked;
+    for (const auto &header : requestHeaders_)
+    {
+      if (strcasecmp(header.first.c_str(), "Accept") == 0) accept = header.second;
+    }
+  }
+  const sim::HttpRoute *route = sim::findHttpRoute(url_, accept);
+  if (!route) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+  // Like the real client: a connected stream is reused, anything else is
+  // (re)connected to the URL's host first
+  if (!stream_->connected())
+  {
+    size_t hostAt = url_.find("://");
+    hostAt = (hostAt == std::string::npos) ? 0 : hostAt + 3;
+    std::string host;
+    {
+      sim::UntrackedScope untracked;
+      host = url_.substr(hostAt, url_.find('/', hostAt) - hostAt);
+    }
+    if (!stream_->connect(host.c_str(), url_.compare(0, 8, "https://") == 0 ? 443 : 80))
+    {
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+  }
+
+  delay(route->latencyMs);
+  httpRequests++;
+
+  sim::UntrackedScope untracked;
+  std::vector<std::pair<std::string, std::string>> headers = route->headers;
+  char date[40];
+  time_t now = sim::wallClock();
+  strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", gmtime(&now));
+  headers.emplace_back("Date", date);
+
+  responseHeaders_.clear();
+  for (const auto &header : headers)
+  {
+    for (const auto &key : collectKeys_)
+    {
+      if (strcasecmp(key.c_str(), header.first.c_str()) == 0) responseHeaders_.push_back(header);
+    }
+  }
+
+  bool notModified = route->status == HTTP_CODE_OK && requestMatchesValidators(*route);
+  const std::string &body = notModified ? std::string() : route->body;
+  httpBytes += body.size();
+  stream_->simLoad(body);
+  size_ = (int)body.size();
+  return notModified ? HTTP_CODE_NOT_MODIFIED : route->status;
+}
+
+// Like a server: If-None-Match wins over If-Modified-Since. Dates are only
+// compared for equality, which is all a client echoing them back needs.
+bool HTTPClient::requestMatchesValidators(const sim::HttpRoute &route)
+{
+  auto find = [](const std::vector<std::pair<std::string, std::string>> &headers, const char *name) -> const std::string * {
+    for (const auto &header : headers)
+    {
+      if (strcasecmp(header.first.c_str(), name) == 0) return &header.second;
+    }
+    return nullptr;
+  };
+
+  const std::string *etag = find(route.headers, "ETag");
+  const std::string *ifNoneMatch = find(requestHeaders_, "If-None-Match");
+  if (ifNoneMatch) return etag && *etag == *ifNoneMatch;
+
+  const std::string *lastModified = find(route.headers, "Last-Modified");
+  const std::string *ifModifiedSince = find(requestHeaders_, "If-Modified-Since");
+  return ifModifiedSince && lastModified && *lastModified == *ifModifiedSince;
+}
+
+String HTTPClient::getString()
+{
+  String payload;
+  payload.reserve(size_ > 0 ? size_ : 0);
+  char buf[256];
+  size_t n;
+  while ((n = stream_->readBytes(buf, sizeof(buf))) > 0) payload.concat(buf, (unsigned int)n);
+  return payload;
+}
+
+String HTTPClient::errorToString(int error)
+{
+  switch (error)
+  {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+      return String("connection refused");
+    case HTTPC_ERROR_SEND_HEADER_FAILED:
+      return String("send header failed");
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+      return String("send payload failed");
+    case HTTPC_ERROR_NOT_CONNECTED:
+      return String("not connected");
+    case HTTPC_ERROR_CONNECTION_LOST:
+      return String("connection lost");
+    case HTTPC_ERROR_NO_STREAM:
+      return String("no stream");
+    case HTTPC_ERROR_NO_HTTP_SERVER:
+      return String("no HTTP server");
+    case HTTPC_ERROR_TOO_LESS_RAM:
+      return String("too less ram");
+    case HTTPC_ERROR_ENCODING:
+      return String("Transfer-Encoding not supported");
+    case HTTPC_ERROR_STREAM_WRITE:
+      return String("Stream write error");
+    case HTTPC_ERROR_READ_TIMEOUT:
+      return String("read Timeout");
+    default:
+      return String();
+  }
+}
+
+// =============================================================================
+// WEB SERVER
+// =============================================================================
+
+void WebServer::on(const String &uri, HTTPMethod method, THandlerFunction handler)
+{
+  sim::UntrackedScope untracked;
+  routes_.push_back({uri.c_str(), method, handler});
+}
+
+String WebServer::arg(const String &name)
+{
+  for (const auto &a : args_)
+  {
+    if (a.first == name.c_str()) return String(a.second.c_str());
+  }
+  return String();
+}
+
+bool WebServer::hasArg(const String &name)
+{
+  for (const auto &a : args_)
+  {
+    if (a.first == name.c_str()) return true;
+  }
+  return false;
+}
+
+void WebServer::sendHeader(const String &name, const String &value, bool first)
+{
+  (void)name;
+  (void)value;
+  (void)first;
+}
+
+void WebServer::send(int code, const char *contentType, const String &content)
+{
+  (void)contentType;
+  lastStatus_ = code;
+  sim::UntrackedScope untracked;
+  response_ = content.c_str();
+}
+
+String WebServer::simRequest(const char *uri, const std::vector<std::pair<std::string, std::string>> &args)
+{
+  {
+    sim::UntrackedScope untracked;
+    uri_ = uri;
+    args_ = args;
+    response_.clear();
+  }
+  lastStatus_ = 0;
+
+  for (const auto &route : routes_)
+  {
+    if (route.uri == uri)
+    {
+      route.handler();
+      return String(response_.c_str());
+    }
+  }
+  if (notFound_) notFound_();
+  return String(response_.c_str());
+}
+
+// =============================================================================
+// SIMULATOR CONTROL
+// =============================================================================
+
+namespace sim
+{
+
+void setNetworkUp(bool up) { WiFi.simSetApUp(up); }
+void setAssociateDelay(uint32_t ms) { associateDelayMs = ms; }
+void setTlsHandshakeDelay(uint32_t ms) { tlsHandshakeMs = ms; }
+void setKeepAliveTimeout(uint32_t ms) { keepAliveTimeoutMs = ms; }
+
+void addHttpRoute(const HttpRoute &route)
+{
+  UntrackedScope untracked;
+  httpRoutes.push_back(route);
+}
+
+void clearHttpRoutes()
+{
+  httpRoutes.clear();
+}
+
+const HttpRoute *findHttpRoute(const std::string &url, const std::string &accept)
+{
+  for (const auto &route : httpRoutes)
+  {
+    if (url.find(route.match) == std::string::npos) continue;
+    if (route.accept.empty() || accept.find(route.accept) != std::string::npos) return &route;
+  }
+  return nullptr;
+}
+
+uint32_t httpRequestCount() { return httpRequests; }
+uint32_t tlsHandshakeCount() { return tlsHandshakes; }
+WiFiStats wifiStats() { return ::wifiStats; }
+uint64_t httpBytesServed() { return httpBytes; }
+
+bool readFile(const char *path, std::string &out)
+{
+  UntrackedScope untracked;
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  std::ostringstream contents;
+  contents << in.rdbuf();
+  out = contents.str();
+  return true;
+}
+
+} // namespace sim
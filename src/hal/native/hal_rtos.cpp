@@ -0,0 +1,260 @@
+// =============================================================================
+// NATIVE HAL - FreeRTOS tasks on the virtual clock
+// =============================================================================
+// Every task the firmware creates gets a host thread, but only one thread runs
+// at a time. The running task hands over only where it blocks (delay(),
+// vTaskDelay(), ulTaskNotifyTake()), to whichever task is due first on the
+// virtual clock, and the clock jumps to that point. Runs stay deterministic,
+// yet a slow HTTP response on one task really does leave the others running.
+//
+// sim::at() events fire on the way: when the clock would jump past one, it
+// stops there and runs it on the current thread, like an interrupt.
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Arduino.h"
+#include "sim.h"
+
+struct SimTask
+{
+  std::string name;
+  std::thread thread;
+  uint64_t wakeUs = 0;        // Virtual time the task next wants to run
+  bool waitingNotify = false;
+  uint32_t notifyCount = 0;
+  bool finished = false;
+  bool killed = false;
+};
+
+namespace
+{
+
+const uint64_t NEVER = UINT64_MAX;
+
+// Unwinds a task's thread when the harness ends the run
+struct TaskKilled
+{
+};
+
+std::mutex schedMutex;
+std::condition_variable schedCv;
+SimTask loopTask;              // The harness thread, running setup()/loop()
+std::vector<SimTask *> tasks;  // Created by the firmware
+SimTask *running = &loopTask;
+std::exception_ptr taskException;  // Escaped a task; rethrown on the loop task
+
+struct TimedEvent
+{
+  uint64_t atUs;
+  std::function<void()> fn;
+};
+std::vector<TimedEvent> timedEvents;  // Sorted by time, then by when they were added
+
+// The task due first. On a tie the others go before `self`, so a zero delay
+// yields like it does on the device.
+SimTask *nextTask(SimTask *self)
+{
+  SimTask *best = nullptr;
+  auto consider = [&](SimTask *task) {
+    if (task == self || task->finished) return;
+    if (!best || task->wakeUs < best->wakeUs) best = task;
+  };
+  consider(&loopTask);
+  for (SimTask *task : tasks) consider(task);
+
+  if (!best || (!self->finished && self->wakeUs < best->wakeUs)) return self;
+  return best;
+}
+
+// Hand over to the next task and wait for our turn again. Called by the
+// running task with schedMutex held.
+void switchFrom(std::unique_lock<std::mutex> &lock, SimTask *self)
+{
+  SimTask *next = nextTask(self);
+  while (!timedEvents.empty() && timedEvents.front().atUs <= next->wakeUs)
+  {
+    TimedEvent event = std::move(timedEvents.front());
+    timedEvents.erase(timedEvents.begin());
+    sim::setNowUs(event.atUs);
+
+    // The event may notify a task, which changes who runs next
+    lock.unlock();
+    event.fn();
+    lock.lock();
+    next = nextTask(self);
+  }
+
+  if (next->wakeUs != NEVER) sim::setNowUs(next->wakeUs);
+  if (next != self)
+  {
+    running = next;
+    schedCv.notify_all();
+    if (self->finished) return;
+    schedCv.wait(lock, [self] { return running == self; });
+  }
+
+  if (self->killed) throw TaskKilled();
+  if (self == &loopTask && taskException)
+  {
+    std::exception_ptr e = taskException;
+    taskException = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+void taskEntry(SimTask *task, TaskFunction_t taskCode, void *param)
+{
+  {
+    std::unique_lock<std::mutex> lock(schedMutex);
+    schedCv.wait(lock, [task] { return running == task; });
+  }
+
+  try
+  {
+    if (!task->killed) taskCode(param);
+    Serial.printf("[sim] task %s returned\n", task->name.c_str());
+  }
+  catch (const TaskKilled &)
+  {
+  }
+  catch (...)
+  {
+    // e.g. ESP.restart() from the task: the harness sees it on its own thread
+    taskException = std::current_exception();
+  }
+
+  std::unique_lock<std::mutex> lock(schedMutex);
+  task->finished = true;
+  if (task->killed || taskException)
+  {
+    running = &loopTask;
+    schedCv.notify_all();
+  }
+  else
+  {
+    switchFrom(lock, task);
+  }
+}
+
+} // namespace
+
+namespace sim
+{
+
+void sleepUs(uint64_t us)
+{
+  std::unique_lock<std::mutex> lock(schedMutex);
+  SimTask *self = running;
+  self->wakeUs = nowUs() + us;
+  switchFrom(lock, self);
+}
+
+void stopTasks()
+{
+  for (SimTask *task : tasks)
+  {
+    {
+      std::unique_lock<std::mutex> lock(schedMutex);
+      if (!task->finished)
+      {
+        task->killed = true;
+        running = task;
+        schedCv.notify_all();
+        schedCv.wait(lock, [] { return running == &loopTask; });
+      }
+    }
+    task->thread.join();
+    UntrackedScope untracked;
+    delete task;
+  }
+  tasks.clear();
+  taskException = nullptr;
+  timedEvents.clear();
+}
+
+void at(uint64_t us, std::function<void()> fn)
+{
+  UntrackedScope untracked;
+  std::lock_guard<std::mutex> lock(schedMutex);
+  auto pos = std::upper_bound(timedEvents.begin(), timedEvents.end(), us,
+                              [](uint64_t t, const TimedEvent &e) { return t < e.atUs; });
+  timedEvents.insert(pos, TimedEvent{us, std::move(fn)});
+}
+
+} // namespace sim
+
+BaseType_t xTaskCreate(TaskFunction_t taskCode, const char *name, uint32_t stackDepth,
+                       void *param, UBaseType_t priority, TaskHandle_t *createdTask)
+{
+  (void)stackDepth;
+  (void)priority;
+
+  sim::UntrackedScope untracked;  // Simulator bookkeeping, not firmware heap
+  SimTask *task = new SimTask();
+  task->name = name;
+  task->wakeUs = sim::nowUs();  // Starts the next time the creator blocks
+  {
+    std::lock_guard<std::mutex> lock(schedMutex);
+    tasks.push_back(task);
+  }
+  task->thread = std::thread(taskEntry, task, taskCode, param);
+
+  if (createdTask) *createdTask = task;
+  return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  std::lock_guard<std::mutex> lock(schedMutex);
+  return running;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  sim::sleepUs((uint64_t)ticks * 1000000ULL / configTICK_RATE_HZ);
+}
+
+TickType_t xTaskGetTickCount()
+{
+  return (TickType_t)(sim::nowUs() * configTICK_RATE_HZ / 1000000ULL);
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait)
+{
+  std::unique_lock<std::mutex> lock(schedMutex);
+  SimTask *self = running;
+  if (self->notifyCount == 0 && ticksToWait > 0)
+  {
+    self->waitingNotify = true;
+    self->wakeUs = (ticksToWait == portMAX_DELAY)
+                       ? NEVER
+                       : sim::nowUs() + (uint64_t)ticksToWait * 1000000ULL / configTICK_RATE_HZ;
+    switchFrom(lock, self);
+    self->waitingNotify = false;
+  }
+
+  uint32_t count = self->notifyCount;
+  if (count > 0) self->notifyCount = clearCountOnExit ? 0 : count - 1;
+  return count;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  std::lock_guard<std::mutex> lock(schedMutex);
+  task->notifyCount++;
+  if (task->waitingNotify) task->wakeUs = sim::nowUs();  // Runs when the giver next blocks
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken)
+{
+  xTaskNotifyGive(task);
+  if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+}
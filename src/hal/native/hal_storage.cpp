@@ -0,0 +1,339 @@
+// =============================================================================
+// NATIVE HAL - Storage: Preferences backed by an in-memory NVS image, app
+// partitions for OTA
+// =============================================================================
+
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <string>
+
+#include "Preferences.h"
+#include "esp_ota_ops.h"
+#include "sim.h"
+
+namespace
+{
+
+// namespace -> key -> raw value bytes
+typedef std::map<std::string, std::map<std::string, std::string>> NvsImage;
+
+NvsImage &nvs()
+{
+  static NvsImage image;
+  return image;
+}
+
+} // namespace
+
+bool Preferences::begin(const char *name, bool readOnly, const char *partitionLabel)
+{
+  (void)partitionLabel;
+  if (started_) return false;
+  namespace_ = name;
+  readOnly_ = readOnly;
+  started_ = true;
+  return true;
+}
+
+void Preferences::end()
+{
+  started_ = false;
+}
+
+bool Preferences::clear()
+{
+  if (!started_ || readOnly_) return false;
+  nvs().erase(namespace_);
+  return true;
+}
+
+bool Preferences::remove(const char *key)
+{
+  if (!started_ || readOnly_) return false;
+  auto ns = nvs().find(namespace_);
+  if (ns == nvs().end()) return false;
+  return ns->second.erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key)
+{
+  return get(key) != nullptr;
+}
+
+bool Preferences::put(const char *key, const void *value, size_t len)
+{
+  if (!started_ || readOnly_ || !key) return false;
+  nvs()[namespace_][key].assign(static_cast<const char *>(value), len);
+  return true;
+}
+
+const std::string *Preferences::get(const char *key)
+{
+  if (!started_ || !key) return nullptr;
+  auto ns = nvs().find(namespace_);
+  if (ns == nvs().end()) return nullptr;
+  auto entry = ns->second.find(key);
+  return entry == ns->second.end() ? nullptr : &entry->second;
+}
+
+size_t Preferences::putBool(const char *key, bool value)
+{
+  uint8_t v = value ? 1 : 0;
+  return put(key, &v, 1) ? 1 : 0;
+}
+
+size_t Preferences::putInt(const char *key, int32_t value) { return put(key, &value, 4) ? 4 : 0; }
+size_t Preferences::putUInt(const char *key, uint32_t value) { return put(key, &value, 4) ? 4 : 0; }
+size_t Preferences::putULong64(const char *key, uint64_t value) { return put(key, &value, 8) ? 8 : 0; }
+size_t Preferences::putFloat(const char *key, float value) { return put(key, &value, 4) ? 4 : 0; }
+
+size_t Preferences::putString(const char *key, const char *value)
+{
+  size_t len = value ? strlen(value) : 0;
+  return put(key, value ? value : "", len) ? len : 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len)
+{
+  return put(key, value, len) ? len : 0;
+}
+
+bool Preferences::getBool(const char *key, bool defaultValue)
+{
+  const std::string *v = get(key);
+  return (v && v->size() == 1) ? (*v)[0] != 0 : defaultValue;
+}
+
+int32_t Preferences::getInt(const char *key, int32_t defaultValue)
+{
+  const std::string *v = get(key);
+  int32_t out = defaultValue;
+  if (v && v->size() == sizeof(out)) memcpy(&out, v->data(), sizeof(out));
+  return out;
+}
+
+uint32_t Preferences::getUInt(const char *key, uint32_t defaultValue)
+{
+  const std::string *v = get(key);
+  uint32_t out = defaultValue;
+  if (v && v->size() == sizeof(out)) memcpy(&out, v->data(), sizeof(out));
+  return out;
+}
+
+uint64_t Preferences::getULong64(const char *key, uint64_t defaultValue)
+{
+  const std::string *v = get(key);
+  uint64_t out = defaultValue;
+  if (v && v->size() == sizeof(out)) memcpy(&out, v->data(), sizeof(out));
+  return out;
+}
+
+float Preferences::getFloat(const char *key, float defaultValue)
+{
+  const std::string *v = get(key);
+  float out = defaultValue;
+  if (v && v->size() == sizeof(out)) memcpy(&out, v->data(), sizeof(out));
+  return out;
+}
+
+String Preferences::getString(const char *key, const String &defaultValue)
+{
+  const std::string *v = get(key);
+  return v ? String(v->c_str()) : defaultValue;
+}
+
+size_t Preferences::getString(const char *key, char *value, size_t maxLen)
+{
+  const std::string *v = get(key);
+  if (!v || !value || v->size() + 1 > maxLen) return 0;
+  memcpy(value, v->c_str(), v->size() + 1);
+  return v->size() + 1;
+}
+
+size_t Preferences::getBytesLength(const char *key)
+{
+  const std::string *v = get(key);
+  return v ? v->size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen)
+{
+  const std::string *v = get(key);
+  if (!v || !buf || v->size() > maxLen) return 0;
+  memcpy(buf, v->data(), v->size());
+  return v->size();
+}
+
+// =============================================================================
+// OTA PARTITIONS
+// =============================================================================
+// Laid out like min_spiffs.csv. Flash past the end of an image reads as erased.
+
+namespace
+{
+
+const esp_partition_t APP_PARTITIONS[2] = {
+  {0x10000, 0x1E0000, "app0"},
+  {0x1F0000, 0x1E0000, "app1"},
+};
+const esp_partition_t *const RUNNING = &APP_PARTITIONS[0];
+const esp_partition_t *const NEXT = &APP_PARTITIONS[1];
+const esp_ota_handle_t OTA_HANDLE = 1;
+
+std::string runningImage;
+std::string writtenImage;
+bool otaWriting = false;
+bool bootSwitched = false;
+
+} // namespace
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t srcOffset, void *dst, size_t size)
+{
+  if (srcOffset + size > partition->size) return ESP_ERR_INVALID_SIZE;
+  const std::string &image = (partition == RUNNING) ? runningImage : writtenImage;
+  memset(dst, 0xFF, size);
+  if (srcOffset < image.size())
+  {
+    size_t stored = image.size() - srcOffset;
+    memcpy(dst, image.data() + srcOffset, stored < size ? stored : size);
+  }
+  return ESP_OK;
+}
+
+const esp_partition_t *esp_ota_get_running_partition()
+{
+  return RUNNING;
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *startFrom)
+{
+  (void)startFrom;
+  return NEXT;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t imageSize, esp_ota_handle_t *outHandle)
+{
+  if (partition != NEXT) return ESP_FAIL;
+  if (imageSize != OTA_SIZE_UNKNOWN && imageSize > partition->size) return ESP_ERR_INVALID_SIZE;
+  sim::UntrackedScope untracked;
+  writtenImage.clear();
+  otaWriting = true;
+  *outHandle = OTA_HANDLE;
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+  if (handle != OTA_HANDLE || !otaWriting) return ESP_FAIL;
+  if (writtenImage.size() + size > NEXT->size) return ESP_ERR_INVALID_SIZE;
+  sim::UntrackedScope untracked;
+  writtenImage.append((const char *)data, size);
+  return ESP_OK;
+}
+
+// No image validation on the host: any non-empty image passes
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+  if (handle != OTA_HANDLE || !otaWriting) return ESP_FAIL;
+  otaWriting = false;
+  return writtenImage.empty() ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+  if (handle != OTA_HANDLE || !otaWriting) return ESP_FAIL;
+  otaWriting = false;
+  writtenImage.clear();
+  return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *partition)
+{
+  if (partition != NEXT || otaWriting || writtenImage.empty()) return ESP_FAIL;
+  bootSwitched = true;
+  return ESP_OK;
+}
+
+// =============================================================================
+// SIMULATOR CONTROL
+// =============================================================================
+// File format: repeated [ns\0][key\0][u32 length][bytes]
+
+namespace sim
+{
+
+void nvsSet(const char *ns, const char *key, const std::string &bytes)
+{
+  UntrackedScope untracked;
+  nvs()[ns][key] = bytes;
+}
+
+void nvsSetString(const char *ns, const char *key, const char *value)
+{
+  nvsSet(ns, key, std::string(value));
+}
+
+void nvsSetBool(const char *ns, const char *key, bool value)
+{
+  nvsSet(ns, key, std::string(1, value ? '\1' : '\0'));
+}
+
+void nvsClear()
+{
+  nvs().clear();
+}
+
+void setRunningImage(const std::string &image)
+{
+  UntrackedScope untracked;
+  runningImage = image;
+}
+
+const std::string &otaWrittenImage() { return writtenImage; }
+bool otaBootSwitched() { return bootSwitched; }
+
+bool nvsSave(const char *path)
+{
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  for (const auto &ns : nvs())
+  {
+    for (const auto &entry : ns.second)
+    {
+      uint32_t len = (uint32_t)entry.second.size();
+      fwrite(ns.first.c_str(), 1, ns.first.size() + 1, f);
+      fwrite(entry.first.c_str(), 1, entry.first.size() + 1, f);
+      fwrite(&len, sizeof(len), 1, f);
+      fwrite(entry.second.data(), 1, len, f);
+    }
+  }
+  bool ok = (ferror(f) == 0);
+  fclose(f);
+  return ok;
+}
+
+bool nvsLoad(const char *path)
+{
+  std::string image;
+  if (!readFile(path, image)) return false;
+
+  UntrackedScope untracked;
+  size_t pos = 0;
+  while (pos < image.size())
+  {
+    size_t nsEnd = image.find('\0', pos);
+    if (nsEnd == std::string::npos) return false;
+    size_t keyEnd = image.find('\0', nsEnd + 1);
+    if (keyEnd == std::string::npos || keyEnd + 5 > image.size()) return false;
+    uint32_t len;
+    memcpy(&len, image.data() + keyEnd + 1, sizeof(len));
+    size_t valueAt = keyEnd + 1 + sizeof(len);
+    if (valueAt + len > image.size()) return false;
+    nvs()[image.substr(pos, nsEnd - pos)][image.substr(nsEnd + 1, keyEnd - nsEnd - 1)] = image.substr(valueAt, len);
+    pos = valueAt + len;
+  }
+  return true;
+}
+
+} // namespace sim
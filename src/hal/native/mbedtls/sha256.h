@@ -0,0 +1,23 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - mbedtls/sha256
+// =============================================================================
+// The streaming SHA-256 calls the firmware uses, in plain C++
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+  uint32_t state[8];
+  uint64_t length;  // Bytes hashed so far
+  uint8_t block[64];
+  size_t used;      // Bytes waiting in block
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context *ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context *ctx);
+int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *input, size_t length);
+int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char output[32]);
@@ -0,0 +1,146 @@
+#pragma once
+
+// =============================================================================
+// NATIVE HAL - Simulator control surface
+// =============================================================================
+// The firmware only sees the Arduino-compatible headers in this directory.
+// This header is for the host harness (sim_main.cpp): it drives the fakes
+// behind those headers and reads back what the firmware did.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sim
+{
+
+// Thrown by ESP.restart() so the harness can re-run setup() like a reboot
+struct RestartRequested
+{
+};
+
+// --- Clock -------------------------------------------------------------------
+
+// Wall-clock time (UTC) that NTP "returns" at millis() == 0
+void setEpoch(time_t utc);
+void advance(uint32_t ms);
+uint64_t nowUs();
+time_t wallClock();  // UTC now, whether or not the firmware has synced NTP
+void setNowUs(uint64_t us);  // Only ever forwards; for the task scheduler
+
+// --- Tasks -------------------------------------------------------------------
+
+// FreeRTOS tasks run on host threads, one at a time, handing over only where
+// the running task blocks. The harness thread is the Arduino loop task.
+
+// Block the calling task for `us` of virtual time; others due sooner run first
+void sleepUs(uint64_t us);
+// Run `fn` when the virtual clock reaches `us`, whatever the firmware is doing
+// at that moment - for pin changes that should arrive as interrupts
+void at(uint64_t us, std::function<void()> fn);
+// End every task the firmware created and drop pending at() events (call from
+// the harness at the end of a run)
+void stopTasks();
+
+// --- GPIO --------------------------------------------------------------------
+
+void setPin(uint8_t pin, int level);
+int pinLevel(uint8_t pin);
+int pinPwm(uint8_t pin);
+
+// --- Sensor ------------------------------------------------------------------
+
+void setSensorPresent(bool present);
+void setSensor(float temperatureC, float humidityPercent);
+
+// --- Network -----------------------------------------------------------------
+
+void setNetworkUp(bool up);           // The AP; taking it down drops the station
+void setAssociateDelay(uint32_t ms);  // WiFi.begin() to IP address, scan and DHCP included
+void setTlsHandshakeDelay(uint32_t ms);
+void setKeepAliveTimeout(uint32_t ms);  // The server closes a connection idle this long
+
+struct HttpRoute
+{
+  std::string match;  // Substring of the request URL
+  int status;
+  std::string body;
+  std::vector<std::pair<std::string, std::string>> headers;  // An ETag or Last-Modified here makes
+  uint32_t latencyMs;                                        // conditional requests get a 304
+  std::string accept;  // Only for requests whose Accept header names this type; empty for any
+};
+
+void addHttpRoute(const HttpRoute &route);
+void clearHttpRoutes();
+const HttpRoute *findHttpRoute(const std::string &url, const std::string &accept);
+uint32_t httpRequestCount();
+uint32_t tlsHandshakeCount();
+
+struct WiFiStats
+{
+  uint32_t attempts;  // begin() and reconnect() calls
+  uint32_t scans;     // Attempts without a BSSID to go straight to
+  uint32_t connects;  // Attempts that got an IP address
+  uint32_t firstIpMs; // First begin() to the first IP address
+};
+
+WiFiStats wifiStats();
+uint64_t httpBytesServed();
+
+bool readFile(const char *path, std::string &out);
+
+// --- NVS ---------------------------------------------------------------------
+
+void nvsSet(const char *ns, const char *key, const std::string &bytes);
+void nvsSetString(const char *ns, const char *key, const char *value);
+void nvsSetBool(const char *ns, const char *key, bool value);
+bool nvsLoad(const char *path);
+bool nvsSave(const char *path);
+void nvsClear();
+
+// --- OTA ---------------------------------------------------------------------
+
+// What the running app partition holds (what a delta patch applies to)
+void setRunningImage(const std::string &image);
+// The image the last update wrote to the other app partition, and whether it
+// was made the boot partition
+const std::string &otaWrittenImage();
+bool otaBootSwitched();
+
+// --- Heap --------------------------------------------------------------------
+
+// Nominal free heap of an ESP32-C3 with WiFi up, used as the baseline for the
+// ESP.getFreeHeap() family
+constexpr size_t SIM_HEAP_SIZE = 240 * 1024;
+
+struct HeapStats
+{
+  size_t liveBytes;
+  size_t peakBytes;
+  uint64_t allocations;
+};
+
+HeapStats heapStats();
+void heapResetPeak();
+
+// Tracked allocations made so far by the calling thread (task)
+uint64_t heapThreadAllocations();
+
+// Allocations made while one of these is alive (simulator bookkeeping, the
+// framebuffer, fixture bodies) are left out of the firmware's heap figures.
+// Only for host-side work: a HAL call that allocates on the device too
+// (Preferences, WiFi, HTTPClient) stays tracked.
+class UntrackedScope
+{
+public:
+  UntrackedScope();
+  ~UntrackedScope();
+  UntrackedScope(const UntrackedScope &) = delete;
+  UntrackedScope &operator=(const UntrackedScope &) = delete;
+};
+
+} // namespace sim
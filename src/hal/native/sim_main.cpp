@@ -0,0 +1,551 @@
+// =============================================================================
+// NATIVE SIMULATOR HARNESS
+// =============================================================================
+// Boots the real firmware (setup()/loop() from main.cpp) against the native HAL,
+// drives a scripted session, dumps the panel to PNG at interesting moments and
+// prints render cost and heap figures.
+//
+//   pio run -e native -t exec
+//   .pio/build/native/program --seconds 180 --out .pio/sim
+//
+// Options:
+//   --seconds N     Simulated run time after setup (default 150)
+//   --out DIR       Where PNG frames are written (default .pio)
+//   --fixtures DIR  Recorded AccuWeather responses (default test/fixtures)
+//   --nvs FILE      Load NVS from FILE before boot and save it back afterwards
+//   --epoch UTC     Wall-clock time NTP reports at boot (default 1705330770)
+//   --ota DIR       Offer an update from DIR, laid out like a release: version.txt,
+//                   firmware.sha256, delta-<version>.bin, firmware.bin(.gz), plus
+//                   running.bin, the image the running partition holds
+//   --ap-outage AT,SECONDS
+//                   Take the WiFi AP down AT seconds into the run for SECONDS,
+//                   like a router restart
+//   --weather-url URL
+//                   Weather server to store in NVS, as the setup portal would
+//   --msgpack       Answer forecast requests that accept MessagePack with
+//                   forecast_5day.msgpack, like a compatible proxy
+//   --bench-icons   Compare drawBitmap() with the run-length icon blitters, then exit
+//   --bench-forecast
+//                   Compare parsing the forecast as JSON and as MessagePack, then exit
+
+#include <sys/stat.h>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "Adafruit_ST7789.h"
+#include "ArduinoJson.h"
+#include "WebServer.h"
+#include "WiFi.h"
+#include "sim.h"
+#include "../../alloc_guard.h"
+#include "../../board.h"
+#include "../../display_transport.h"
+#include "../../icon_blit.h"
+#include "../../metered_display.h"
+#include "icons_rle.h"
+
+void setup();
+void loop();
+DeserializationError parseForecast(JsonDocument &doc, Stream &body, bool msgpack);
+
+extern MeteredST7789 tft;
+extern WebServer server;
+extern const unsigned char* weather_allArray[8];
+extern const char* FIRMWARE_VERSION;
+
+namespace
+{
+
+// SPI clock the device runs the panel at, used to turn bytes into bus time
+const double PANEL_SPI_HZ = 40e6;
+
+struct Options
+{
+  uint32_t seconds = 150;
+  std::string outDir = ".pio";
+  std::string fixturesDir = "test/fixtures";
+  std::string nvsPath;
+  std::string otaDir;
+  std::string weatherUrl;  // Stored as the portal would; the fixtures answer any host
+  uint32_t outageAtS = 0;
+  uint32_t outageSeconds = 0;  // No AP outage if 0
+  time_t epoch = 1705330770;  // 2024-01-15 14:59:30 UTC, a minute boundary is near
+  bool msgpack = false;
+  bool benchIcons = false;
+  bool benchForecast = false;
+};
+
+struct Sample
+{
+  double realUs;
+  uint64_t busBytes;
+};
+
+struct Stats
+{
+  uint64_t count = 0;
+  double realUsTotal = 0;
+  double realUsMax = 0;
+  uint64_t busBytesTotal = 0;
+  uint64_t busBytesMax = 0;
+
+  void add(const Sample &s)
+  {
+    count++;
+    realUsTotal += s.realUs;
+    if (s.realUs > realUsMax) realUsMax = s.realUs;
+    busBytesTotal += s.busBytes;
+    if (s.busBytes > busBytesMax) busBytesMax = s.busBytes;
+  }
+};
+
+double busMs(uint64_t bytes) { return bytes * 8.0 / PANEL_SPI_HZ * 1000.0; }
+
+template <typename Fn>
+Sample measure(Fn fn)
+{
+  uint64_t busBefore = tft.simBusBytes();
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  auto end = std::chrono::steady_clock::now();
+  return {std::chrono::duration<double, std::micro>(end - start).count(), tft.simBusBytes() - busBefore};
+}
+
+void dumpFrame(const Options &options, const char *name)
+{
+  sim::UntrackedScope untracked;  // Harness work, often from inside loop()
+  std::string path = options.outDir + "/" + name;
+  if (tft.simWritePng(path.c_str())) printf("[sim] wrote %s\n", path.c_str());
+  else printf("[sim] failed to write %s\n", path.c_str());
+}
+
+bool parseOptions(int argc, char **argv, Options &options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--bench-icons")
+    {
+      options.benchIcons = true;
+      continue;
+    }
+    if (arg == "--bench-forecast")
+    {
+      options.benchForecast = true;
+      continue;
+    }
+    if (arg == "--msgpack")
+    {
+      options.msgpack = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      fprintf(stderr, "missing value for %s\n", arg.c_str());
+      return false;
+    }
+    if (arg == "--seconds") options.seconds = (uint32_t)atoi(argv[++i]);
+    else if (arg == "--out") options.outDir = argv[++i];
+    else if (arg == "--fixtures") options.fixturesDir = argv[++i];
+    else if (arg == "--nvs") options.nvsPath = argv[++i];
+    else if (arg == "--epoch") options.epoch = (time_t)atoll(argv[++i]);
+    else if (arg == "--ota") options.otaDir = argv[++i];
+    else if (arg == "--weather-url") options.weatherUrl = argv[++i];
+    else if (arg == "--ap-outage")
+    {
+      if (sscanf(argv[++i], "%u,%u", &options.outageAtS, &options.outageSeconds) != 2)
+      {
+        fprintf(stderr, "--ap-outage wants AT,SECONDS\n");
+        return false;
+      }
+    }
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", arg.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Served with an ETag of the body and the given lifetime, so conditional
+// requests get a 304 like they would from AccuWeather's CDN. A `contentType`
+// other than JSON is only served to requests that accept it.
+void addFixtureRoute(const Options &options, const char *match, const char *file, uint32_t latencyMs,
+                     uint32_t maxAgeSeconds, const char *contentType = "application/json")
+{
+  sim::UntrackedScope untracked;
+  sim::HttpRoute route;
+  route.match = match;
+  route.status = 200;
+  route.latencyMs = latencyMs;
+  if (strcmp(contentType, "application/json") != 0) route.accept = contentType;
+  std::string path = options.fixturesDir + "/" + file;
+  if (!sim::readFile(path.c_str(), route.body))
+  {
+    printf("[sim] missing fixture %s, route %s will 404\n", path.c_str(), match);
+    route.status = 404;
+  }
+
+  char etag[24];
+  snprintf(etag, sizeof(etag), "\"%016zx\"", std::hash<std::string>()(route.body));
+  route.headers = {
+    {"Content-Type", route.accept.empty() ? "application/json; charset=utf-8" : contentType},
+    {"Cache-Control", "public, max-age=" + std::to_string(maxAgeSeconds)},
+    {"ETag", etag},
+  };
+  sim::addHttpRoute(route);
+}
+
+// A GitHub release, from the files in --ota DIR (missing ones 404)
+void addReleaseRoutes(const Options &options)
+{
+  sim::UntrackedScope untracked;
+  std::string running;
+  if (sim::readFile((options.otaDir + "/running.bin").c_str(), running)) sim::setRunningImage(running);
+
+  const std::pair<const char *, std::string> files[] = {
+    {"/download/version.txt", "version.txt"},
+    {"/download/firmware.sha256", "firmware.sha256"},
+    {"/download/delta-", std::string("delta-") + FIRMWARE_VERSION + ".bin"},
+    {"/download/firmware.bin.gz", "firmware.bin.gz"},
+    {"/download/firmware.bin", "firmware.bin"},
+  };
+  for (const auto &file : files)
+  {
+    sim::HttpRoute route;
+    route.match = file.first;
+    route.status = 200;
+    route.latencyMs = 300;
+    route.headers = {{"Content-Type", "application/octet-stream"}};
+    if (!sim::readFile((options.otaDir + "/" + file.second).c_str(), route.body)) route.status = 404;
+    sim::addHttpRoute(route);
+  }
+}
+
+void seedConfiguration()
+{
+  sim::nvsSetString("weather", "wifiSsid", "SimNet");
+  sim::nvsSetString("weather", "wifiPass", "simulated");
+  sim::nvsSetString("weather", "postalCode", "10001");
+  sim::nvsSetString("weather", "countryCode", "US");
+  sim::nvsSetBool("weather", "useCelsius", false);
+  sim::nvsSetBool("weather", "use24Hour", false);
+}
+
+void printStats(const char *label, const Stats &stats)
+{
+  if (stats.count == 0) return;
+  printf("[sim] %-22s %8llu %10.1f %10.1f %12.1f %10.2f\n", label,
+         (unsigned long long)stats.count,
+         stats.realUsTotal / stats.count, stats.realUsMax,
+         (double)stats.busBytesTotal / stats.count, busMs(stats.busBytesMax));
+}
+
+// drawBitmap() against blitIcon() (one window, bulk runs) and drawIcon() (spans)
+// for every icon, on a black panel. Bus figures are exact; CPU time is host-side.
+int benchIcons()
+{
+  const int REPEATS = 200;
+  tft.init(240, 280);
+  tft.setRotation(3);
+  DisplayTransport transport(tft);
+
+  printf("[bench] %-8s %5s | %9s %7s %8s | %9s %7s %8s | %9s %7s %8s\n", "icon", "size",
+         "bitmap B", "windows", "host us", "blit B", "windows", "host us", "spans B", "windows", "host us");
+
+  bool identical = true;
+  for (int i = 0; i < 8; i++)
+  {
+    const IconRle &icon = weather_allArray_rle[i];
+    const unsigned char *bitmap = weather_allArray[i];
+    int16_t x = (SCREEN_W - icon.width) / 2;
+    int16_t y = (SCREEN_H - icon.height) / 2;
+
+    struct Result
+    {
+      uint64_t bytes;
+      uint32_t windows;
+      double us;
+      std::vector<uint16_t> frame;
+    } results[3];
+
+    for (int method = 0; method < 3; method++)
+    {
+      tft.fillScreen(ST77XX_BLACK);
+      tft.simResetCounters();
+      auto start = std::chrono::steady_clock::now();
+      for (int r = 0; r < REPEATS; r++)
+      {
+        if (method == 0) tft.drawBitmap(x, y, bitmap, icon.width, icon.height, ST77XX_WHITE);
+        else if (method == 1) blitIcon(transport, x, y, icon, ST77XX_WHITE, ST77XX_BLACK);
+        else drawIcon(tft, x, y, icon, ST77XX_WHITE);
+        transport.fence();
+      }
+      auto end = std::chrono::steady_clock::now();
+      results[method].bytes = tft.simBusBytes() / REPEATS;
+      results[method].windows = tft.simAddrWindows() / REPEATS;
+      results[method].us = std::chrono::duration<double, std::micro>(end - start).count() / REPEATS;
+      results[method].frame = tft.simFramebuffer();
+    }
+    identical = identical && results[1].frame == results[0].frame && results[2].frame == results[0].frame;
+
+    printf("[bench] icon %-3d %2dx%-2d | %9llu %7u %8.2f | %9llu %7u %8.2f | %9llu %7u %8.2f\n", i,
+           icon.width, icon.height,
+           (unsigned long long)results[0].bytes, results[0].windows, results[0].us,
+           (unsigned long long)results[1].bytes, results[1].windows, results[1].us,
+           (unsigned long long)results[2].bytes, results[2].windows, results[2].us);
+  }
+  printf("[bench] bus time per byte at %.0f MHz: %.3f us; output %s drawBitmap\n", PANEL_SPI_HZ / 1e6,
+         busMs(1) * 1000.0, identical ? "identical to" : "DIFFERS from");
+  return identical ? 0 : 1;
+}
+
+// JSON as AccuWeather sends it: no whitespace outside strings
+std::string compactJson(const std::string &json)
+{
+  std::string out;
+  bool inString = false;
+  for (size_t i = 0; i < json.size(); i++)
+  {
+    char c = json[i];
+    if (inString)
+    {
+      if (c == '\\') out += json[i++];
+      else if (c == '"') inString = false;
+    }
+    else if (c == '"') inString = true;
+    else if (isspace((unsigned char)c)) continue;
+    out += c;
+  }
+  return out;
+}
+
+// parseForecast() on the recorded forecast as recorded (pretty-printed JSON),
+// as compact JSON and as MessagePack. Sizes are exact; parse time is host-side
+// and only as good as the ArduinoJson build it runs against.
+int benchForecast(const Options &options)
+{
+  const int REPEATS = 500;
+  std::string recorded;
+  std::string msgpack;
+  if (!sim::readFile((options.fixturesDir + "/forecast_5day.json").c_str(), recorded) ||
+      !sim::readFile((options.fixturesDir + "/forecast_5day.msgpack").c_str(), msgpack))
+  {
+    printf("[bench] missing forecast_5day.json or forecast_5day.msgpack in %s\n", options.fixturesDir.c_str());
+    return 1;
+  }
+  struct Format
+  {
+    const char *name;
+    std::string body;
+    bool msgpack;
+  } formats[] = {
+    {"JSON as recorded", recorded, false},
+    {"JSON compact", compactJson(recorded), false},
+    {"MessagePack", msgpack, true},
+  };
+
+  printf("[bench] %-18s %8s %10s %6s\n", "forecast", "bytes", "host us", "days");
+  std::string firstDays;
+  bool identical = true;
+  for (const Format &format : formats)
+  {
+    WiFiClient stream;
+    JsonDocument doc;
+    DeserializationError error;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < REPEATS; r++)
+    {
+      stream.simLoad(format.body);
+      doc.clear();
+      error = parseForecast(doc, stream, format.msgpack);
+    }
+    auto end = std::chrono::steady_clock::now();
+    if (error)
+    {
+      printf("[bench] %-18s failed: %s\n", format.name, error.c_str());
+      return 1;
+    }
+
+    // What fetchForecast() takes from the document must not depend on the format
+    std::string days;
+    JsonArray daily = doc["DailyForecasts"];
+    for (size_t i = 0; i < daily.size(); i++)
+    {
+      char line[80];
+      snprintf(line, sizeof(line), "%s %d %.1f %.1f;", (const char *)(daily[i]["Date"] | ""),
+               daily[i]["Day"]["Icon"].as<int>(), daily[i]["Temperature"]["Minimum"]["Value"].as<float>(),
+               daily[i]["Temperature"]["Maximum"]["Value"].as<float>());
+      days += line;
+    }
+    if (firstDays.empty()) firstDays = days;
+    identical = identical && days == firstDays;
+
+    printf("[bench] %-18s %8zu %10.2f %6zu\n", format.name, format.body.size(),
+           std::chrono::duration<double, std::micro>(end - start).count() / REPEATS, daily.size());
+  }
+  printf("[bench] parsed forecast %s across formats\n", identical ? "identical" : "DIFFERS");
+  return identical ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options)) return 2;
+  if (options.benchIcons) return benchIcons();
+  if (options.benchForecast) return benchForecast(options);
+
+  mkdir(options.outDir.c_str(), 0755);  // Fine if it already exists
+  sim::setEpoch(options.epoch);
+  sim::setPin(PIN_LIGHT_SW, LOW);  // Backlight switch on
+  if (options.nvsPath.empty() || !sim::nvsLoad(options.nvsPath.c_str())) seedConfiguration();
+  if (!options.weatherUrl.empty()) sim::nvsSetString("weather", "weatherUrl", options.weatherUrl.c_str());
+  addFixtureRoute(options, "/locations/v1/postalcodes/search", "location.json", 420, 86400);
+  if (options.msgpack)
+  {
+    addFixtureRoute(options, "/forecasts/v1/daily/5day/", "forecast_5day.msgpack", 650, 1800, "application/msgpack");
+  }
+  addFixtureRoute(options, "/forecasts/v1/daily/5day/", "forecast_5day.json", 650, 1800);
+  if (!options.otaDir.empty()) addReleaseRoutes(options);
+
+  // Touch three times: into the forecast screen, the indoor history, then back
+  // to the clock
+  const uint32_t touchAtMs[] = {options.seconds * 1000 / 2, options.seconds * 1000 * 3 / 4,
+                                options.seconds * 1000 * 7 / 8};
+  const char *touchFrames[] = {"sim_screen_one.png", "sim_screen_two.png", "sim_screen_three.png"};
+  const uint32_t TOUCH_HOLD_MS = 150;
+
+  Sample bootSample = {0, 0};
+  unsigned long bootVirtualMs = 0;
+  Stats idleStats;
+  Stats tickStats;
+  Stats touchStats;
+  size_t bootHeapPeak = 0;
+  size_t loopHeapPeak = 0;
+  uint64_t maxTouchResponseUs = 0;  // Press to the start of the loop() pass handling it
+  String bootReport;
+  String metricsText;
+  int bootStatus = 0;
+  int metricsStatus = 0;
+
+  try
+  {
+    bootSample = measure([] { setup(); });
+    bootVirtualMs = millis();
+    bootHeapPeak = sim::heapStats().peakBytes;
+    dumpFrame(options, "sim_boot.png");
+
+    sim::heapResetPeak();
+    unsigned long runStart = millis();
+    uint64_t runStartUs = sim::nowUs();
+
+    // Presses arrive as interrupts at their own time, even while loop() sleeps.
+    // The loop() pass after a press is the one that handles it.
+    bool touchPending = false;
+    uint64_t touchPressedUs = 0;
+    {
+      sim::UntrackedScope untracked;  // Scheduling the script is harness work
+      for (int i = 0; i < 3; i++)
+      {
+        uint64_t pressUs = runStartUs + touchAtMs[i] * 1000ULL;
+        const char *frame = touchFrames[i];
+        sim::at(pressUs, [&options, &touchPending, &touchPressedUs, frame] {
+          dumpFrame(options, frame);
+          sim::setPin(PIN_TOUCH, HIGH);
+          touchPending = true;
+          touchPressedUs = sim::nowUs();
+        });
+        sim::at(pressUs + TOUCH_HOLD_MS * 1000ULL, [] { sim::setPin(PIN_TOUCH, LOW); });
+      }
+
+      if (options.outageSeconds > 0)
+      {
+        uint64_t downUs = runStartUs + options.outageAtS * 1000000ULL;
+        sim::at(downUs, [] {
+          printf("[sim] AP down\n");
+          sim::setNetworkUp(false);
+        });
+        sim::at(downUs + options.outageSeconds * 1000000ULL, [] {
+          printf("[sim] AP up\n");
+          sim::setNetworkUp(true);
+        });
+      }
+    }
+
+    while (millis() - runStart < options.seconds * 1000UL)
+    {
+      bool touchEdge = touchPending;
+      touchPending = false;
+
+      if (touchEdge && sim::nowUs() - touchPressedUs > maxTouchResponseUs)
+      {
+        maxTouchResponseUs = sim::nowUs() - touchPressedUs;
+      }
+
+      Sample sample = measure([] { loop(); });
+      if (touchEdge) touchStats.add(sample);
+      else if (sample.busBytes > 0) tickStats.add(sample);
+      else idleStats.add(sample);
+    }
+    loopHeapPeak = sim::heapStats().peakBytes;
+    dumpFrame(options, "sim_final.png");
+    sim::UntrackedScope untracked;  // Kept for the report, not firmware heap
+    bootReport = server.simRequest("/boot");
+    bootStatus = server.simLastStatus();
+    metricsText = server.simRequest("/metrics");
+    metricsStatus = server.simLastStatus();
+  }
+  catch (const sim::RestartRequested &)
+  {
+    printf("[sim] firmware requested a restart, stopping run\n");
+  }
+  sim::stopTasks();
+
+  if (!options.nvsPath.empty()) sim::nvsSave(options.nvsPath.c_str());
+
+  sim::HeapStats heap = sim::heapStats();
+  printf("\n[sim] ================= SIMULATION REPORT =================\n");
+  printf("[sim] boot: %lu ms simulated, %.1f ms host CPU, %llu SPI bytes (%.1f ms bus)\n",
+         bootVirtualMs, bootSample.realUs / 1000.0,
+         (unsigned long long)bootSample.busBytes, busMs(bootSample.busBytes));
+  printf("[sim] %-22s %8s %10s %10s %12s %10s\n", "loop() iterations", "count", "avg us", "max us", "avg SPI B", "max bus ms");
+  printStats("idle", idleStats);
+  printStats("redraw tick", tickStats);
+  printStats("touch (screen toggle)", touchStats);
+  printf("[sim] touch response: %.1f ms simulated, press to handling loop() pass (worst)\n", maxTouchResponseUs / 1000.0);
+  uint64_t loopCalls = idleStats.count + tickStats.count + touchStats.count;
+  printf("[sim] loop() wakeups: %.1f per minute\n", options.seconds > 0 ? loopCalls * 60.0 / options.seconds : 0.0);
+  printf("[sim] heap: live %zu B, peak %zu B during boot, %zu B during loop, %llu allocations\n",
+         heap.liveBytes, bootHeapPeak, loopHeapPeak, (unsigned long long)heap.allocations);
+  printf("[sim] loop() heap allocations after boot: %u (alloc guard)\n", (unsigned)allocGuardFlagged());
+  printf("[sim] http: %u requests, %llu bytes, %u TLS handshakes\n", sim::httpRequestCount(),
+         (unsigned long long)sim::httpBytesServed(), sim::tlsHandshakeCount());
+  sim::WiFiStats wifi = sim::wifiStats();
+  printf("[sim] wifi: %u attempts (%u with a scan), %u connections, first IP %u ms after WiFi.begin()\n",
+         wifi.attempts, wifi.scans, wifi.connects, wifi.firstIpMs);
+  printf("[sim] status server: GET /boot -> %d, %u bytes\n", bootStatus, bootReport.length());
+  printf("[sim] status server: GET /metrics -> %d, %u bytes; %llu of %llu SPI bytes metered\n", metricsStatus,
+         metricsText.length(), (unsigned long long)tft.bytesSent(), (unsigned long long)tft.simBusBytes());
+  std::string metricsPath = options.outDir + "/sim_metrics.txt";
+  if (FILE *file = fopen(metricsPath.c_str(), "w"))
+  {
+    fwrite(metricsText.c_str(), 1, metricsText.length(), file);
+    fclose(file);
+    printf("[sim] wrote %s\n", metricsPath.c_str());
+  }
+  if (!options.otaDir.empty())
+  {
+    std::string expected;
+    bool matches = sim::readFile((options.otaDir + "/firmware.bin").c_str(), expected) &&
+                   sim::otaWrittenImage() == expected;
+    printf("[sim] ota: %zu bytes written, %s firmware.bin, boot partition %s\n", sim::otaWrittenImage().size(),
+           matches ? "same as" : "NOT the same as", sim::otaBootSwitched() ? "switched" : "unchanged");
+  }
+  return 0;
+}
@@ -0,0 +1,227 @@
+// =============================================================================
+// HISTORY GRAPH - 24 h of temperature and humidity, scrolled by the panel
+// =============================================================================
+
+#include "history_graph.h"
+
+namespace
+{
+
+// ST7789 RAM has 320 rows; the 280 the panel shows are centred in it, which
+// in rotation 3 puts screen x at RAM row x + 20
+const uint16_t PANEL_RAM_ROWS = 320;
+const uint16_t RAM_ROW_OFFSET = (PANEL_RAM_ROWS - SCREEN_W) / 2;
+const uint16_t SCROLL_TOP = RAM_ROW_OFFSET + HistoryGraph::LABEL_W;
+const uint16_t SCROLL_BOTTOM = PANEL_RAM_ROWS - SCROLL_TOP - HistoryGraph::COLUMNS;
+
+const uint8_t ST7789_VSCRDEF = 0x33;   // Vertical scroll area
+const uint8_t ST7789_VSCRSADD = 0x37;  // Vertical scroll start address
+
+// Bands, in screen rows
+const int16_t TEMP_TOP = 8;
+const int16_t TEMP_BOTTOM = 115;
+const int16_t HUM_TOP = 128;
+const int16_t HUM_BOTTOM = 231;
+const int16_t HOUR_TICK_H = 3;
+
+const int32_t BUCKETS_PER_HOUR = 3600 / HistoryGraph::BUCKET_S;
+const uint16_t GRID_COLOR = 0x2104;  // Dark grey
+const uint16_t TICK_COLOR = 0x4208;  // Grey
+
+int32_t positiveMod(int32_t value, int32_t modulus)
+{
+  return ((value % modulus) + modulus) % modulus;
+}
+
+} // namespace
+
+HistoryGraph::HistoryGraph(Adafruit_ST7789 &tft, DisplayTransport &transport, int16_t tempLo, int16_t tempHi,
+                           int16_t humLo, int16_t humHi)
+    : tft_(tft), transport_(transport), tempLo_(tempLo), tempHi_(tempHi), humLo_(humLo), humHi_(humHi)
+{
+}
+
+void HistoryGraph::draw(const SensorHistory &history)
+{
+  int32_t newest = history.empty() ? 0 : bucketOf(history.latest());
+
+  // One pass over the history, oldest first, a column per bucket
+  uint16_t i = 0;
+  for (int32_t bucket = newest - COLUMNS + 1; bucket <= newest; bucket++)
+  {
+    Range temp = {};
+    Range hum = {};
+    bool any = false;
+    for (; i < history.size() && bucketOf(history.sample(i)) <= bucket; i++)
+    {
+      const SensorSample &s = history.sample(i);
+      if (bucketOf(s) < bucket)
+      {
+        continue;  // Older than the graph
+      }
+      if (!any)
+      {
+        temp = {s.value.centiC, s.value.centiC};
+        hum = {s.value.centiRh, s.value.centiRh};
+        any = true;
+      }
+      temp = {min(temp.lo, s.value.centiC), max(temp.hi, s.value.centiC)};
+      hum = {min(hum.lo, s.value.centiRh), max(hum.hi, s.value.centiRh)};
+    }
+    drawColumn(bucket, any ? &temp : nullptr, any ? &hum : nullptr);
+  }
+
+  sendScrollArea(SCROLL_TOP, COLUMNS, SCROLL_BOTTOM);
+  scrollTo(newest);
+  active_ = true;
+  redraw_ = false;
+}
+
+void HistoryGraph::update(const SensorHistory &history)
+{
+  if (!active_ || history.empty())
+  {
+    return;
+  }
+  int32_t newest = bucketOf(history.latest());
+  if (redraw_ || newest - newestBucket_ >= COLUMNS)
+  {
+    draw(history);  // Away for more than the whole graph, or the clock changed
+    return;
+  }
+
+  // The column at the right edge may have gained samples; any after it are new
+  for (int32_t bucket = newestBucket_; bucket <= newest; bucket++)
+  {
+    Range temp = {};
+    Range hum = {};
+    bool any = false;
+    for (uint16_t i = history.size(); i > 0; i--)
+    {
+      const SensorSample &s = history.sample(i - 1);
+      int32_t sampleBucket = bucketOf(s);
+      if (sampleBucket < bucket)
+      {
+        break;
+      }
+      if (sampleBucket > bucket)
+      {
+        continue;
+      }
+      if (!any)
+      {
+        temp = {s.value.centiC, s.value.centiC};
+        hum = {s.value.centiRh, s.value.centiRh};
+        any = true;
+      }
+      temp = {min(temp.lo, s.value.centiC), max(temp.hi, s.value.centiC)};
+      hum = {min(hum.lo, s.value.centiRh), max(hum.hi, s.value.centiRh)};
+    }
+    drawColumn(bucket, any ? &temp : nullptr, any ? &hum : nullptr);
+  }
+  if (newest != newestBucket_)
+  {
+    scrollTo(newest);
+  }
+}
+
+void HistoryGraph::end()
+{
+  if (!active_)
+  {
+    return;
+  }
+  // The whole RAM as one scroll area, starting at row 0: no scrolling
+  sendScrollArea(0, PANEL_RAM_ROWS, 0);
+  sendScrollStart(0);
+  active_ = false;
+}
+
+void HistoryGraph::setUtcOffset(int32_t seconds)
+{
+  // Nearest bucket; whole and half hours are exact (BUCKET_S divides 30 min)
+  int32_t half = (seconds >= 0) ? (int32_t)BUCKET_S / 2 : -(int32_t)BUCKET_S / 2;
+  int32_t buckets = (seconds + half) / (int32_t)BUCKET_S;
+  if (buckets != offsetBuckets_)
+  {
+    offsetBuckets_ = buckets;
+    redraw_ = active_;
+  }
+}
+
+int16_t HistoryGraph::bandY(int16_t value, int16_t lo, int16_t hi, int16_t top, int16_t bottom) const
+{
+  value = constrain(value, lo, hi);
+  return bottom - (int16_t)((int32_t)(value - lo) * (bottom - top) / (hi - lo));
+}
+
+void HistoryGraph::drawColumn(int32_t bucket, const Range *temp, const Range *hum)
+{
+  // Background: a faint line every 6 hours, dotted gridlines at the quarters
+  // of each band and a tick under each hour
+  int32_t local = bucket + offsetBuckets_;
+  bool sixHours = positiveMod(local, 6 * BUCKETS_PER_HOUR) == 0;
+  bool hour = positiveMod(local, BUCKETS_PER_HOUR) == 0;
+  bool gridDot = positiveMod(local, 4) == 0;
+
+  uint16_t background = sixHours ? GRID_COLOR : ST77XX_BLACK;
+  for (int16_t y = 0; y < SCREEN_H; y++)
+  {
+    column_[y] = background;
+  }
+  for (int16_t q = 0; q <= 4 && gridDot; q++)
+  {
+    column_[TEMP_TOP + q * (TEMP_BOTTOM - TEMP_TOP) / 4] = GRID_COLOR;
+    column_[HUM_TOP + q * (HUM_BOTTOM - HUM_TOP) / 4] = GRID_COLOR;
+  }
+  for (int16_t y = 1; y <= HOUR_TICK_H && hour; y++)
+  {
+    column_[TEMP_BOTTOM + y] = TICK_COLOR;
+    column_[HUM_BOTTOM + y] = TICK_COLOR;
+  }
+
+  // Lowest to highest reading in the bucket
+  if (temp)
+  {
+    for (int16_t y = bandY(temp->hi, tempLo_, tempHi_, TEMP_TOP, TEMP_BOTTOM);
+         y <= bandY(temp->lo, tempLo_, tempHi_, TEMP_TOP, TEMP_BOTTOM); y++)
+    {
+      column_[y] = ST77XX_ORANGE;
+    }
+  }
+  if (hum)
+  {
+    for (int16_t y = bandY(hum->hi, humLo_, humHi_, HUM_TOP, HUM_BOTTOM);
+         y <= bandY(hum->lo, humLo_, humHi_, HUM_TOP, HUM_BOTTOM); y++)
+    {
+      column_[y] = ST77XX_CYAN;
+    }
+  }
+
+  // The bucket's slot in the ring; where that is on screen depends on the scroll
+  int16_t x = LABEL_W + (int16_t)positiveMod(bucket, COLUMNS);
+  transport_.setAddrWindow(x, 0, 1, SCREEN_H);
+  transport_.writePixels(column_, SCREEN_H);
+  transport_.fence();
+}
+
+// Put `newestBucket`'s column at the right edge: the scroll area starts
+// showing RAM from the slot after it, the oldest column
+void HistoryGraph::scrollTo(int32_t newestBucket)
+{
+  newestBucket_ = newestBucket;
+  sendScrollStart(SCROLL_TOP + (uint16_t)positiveMod(newestBucket + 1, COLUMNS));
+}
+
+void HistoryGraph::sendScrollArea(uint16_t top, uint16_t height, uint16_t bottom)
+{
+  uint8_t data[6] = {(uint8_t)(top >> 8), (uint8_t)top, (uint8_t)(height >> 8), (uint8_t)height,
+                     (uint8_t)(bottom >> 8), (uint8_t)bottom};
+  tft_.sendCommand(ST7789_VSCRDEF, data, sizeof(data));
+}
+
+void HistoryGraph::sendScrollStart(uint16_t row)
+{
+  uint8_t data[2] = {(uint8_t)(row >> 8), (uint8_t)row};
+  tft_.sendCommand(ST7789_VSCRSADD, data, sizeof(data));
+}
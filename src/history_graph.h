@@ -0,0 +1,83 @@
+#pragma once
+
+// =============================================================================
+// HISTORY GRAPH - 24 h of temperature and humidity, scrolled by the panel
+// =============================================================================
+// The graph is one pixel column per BUCKET_S of sensor history: a bar from the
+// lowest to the highest reading in that bucket, temperature in the top band
+// and humidity in the bottom one. COLUMNS of them span a day. Buckets count
+// on the history's clock, so once that is UTC the hour ticks and 6-hour lines
+// fall on local clock hours (see setUtcOffset()).
+//
+// Shifting the plot left costs no pixels: the ST7789's vertical scroll
+// (VSCRDEF/VSCRSADD) rotates a band of panel RAM rows, and in the landscape
+// rotation the firmware uses (3) RAM rows run along x. The graph's columns sit
+// in that band as a ring, so a new bucket is one column written and the
+// scroll start moved on. A sample within the current bucket rewrites only
+// that column. The LABEL_W columns on the left are outside the band and stay
+// put, for the caller's labels.
+//
+// While the graph is showing, anything drawn inside the band lands at the
+// scrolled position, so call end() before another screen draws.
+
+#include <Adafruit_ST7789.h>
+
+#include "board.h"
+#include "display_transport.h"
+#include "sensor_history.h"
+
+class HistoryGraph
+{
+public:
+  static const int16_t LABEL_W = 40;                // Fixed strip on the left
+  static const int16_t COLUMNS = SCREEN_W - LABEL_W;
+  static const uint32_t BUCKET_S = 24 * 3600 / COLUMNS;  // 6 min, 12 samples
+
+  // Band ranges in sensor units (uncalibrated centi-degrees C, centi-percent);
+  // readings outside are drawn at the edge
+  HistoryGraph(Adafruit_ST7789 &tft, DisplayTransport &transport, int16_t tempLo, int16_t tempHi,
+               int16_t humLo, int16_t humHi);
+
+  // Draw every column from `history` and start scrolling. The screen must be
+  // black (the label strip is left alone).
+  void draw(const SensorHistory &history);
+
+  // After samples were added: redraw the newest bucket's column, and scroll
+  // on by one column per bucket started since the last draw or update
+  void update(const SensorHistory &history);
+
+  // Stop scrolling, so the panel shows RAM as written again
+  void end();
+
+  // Local time minus the samples' time, for placing the hour marks; 0 while
+  // the samples are stamped with uptime. A change redraws the whole graph on
+  // the next update().
+  void setUtcOffset(int32_t seconds);
+
+  bool active() const { return active_; }
+
+private:
+  struct Range
+  {
+    int16_t lo;
+    int16_t hi;
+  };
+
+  void drawColumn(int32_t bucket, const Range *temp, const Range *hum);
+  void scrollTo(int32_t newestBucket);
+  void sendScrollArea(uint16_t top, uint16_t height, uint16_t bottom);
+  void sendScrollStart(uint16_t row);
+  int16_t bandY(int16_t value, int16_t lo, int16_t hi, int16_t top, int16_t bottom) const;
+  static int32_t bucketOf(const SensorSample &sample) { return (int32_t)(sample.atS / BUCKET_S); }
+
+  Adafruit_ST7789 &tft_;
+  DisplayTransport &transport_;
+  int16_t tempLo_, tempHi_;
+  int16_t humLo_, humHi_;
+
+  bool active_ = false;
+  bool redraw_ = false;        // Hour marks moved; update() draws everything
+  int32_t offsetBuckets_ = 0;  // setUtcOffset(), in buckets
+  int32_t newestBucket_ = 0;   // At the right edge
+  uint16_t column_[SCREEN_H];  // Pixels of the column being drawn
+};
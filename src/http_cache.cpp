@@ -0,0 +1,147 @@
+// =============================================================================
+// HTTP CACHE - Validators and freshness for AccuWeather responses
+// =============================================================================
+
+#include "http_cache.h"
+
+#include <string.h>
+
+namespace
+{
+
+// Content-Type isn't the cache's, but HTTPClient keeps one list of headers to
+// collect and the forecast fetch reads it to pick a parser
+const char *CACHE_HEADERS[] = {"Date", "Expires", "Cache-Control", "ETag", "Last-Modified", "Content-Type"};
+
+// "Sun, 06 Nov 1994 08:49:37 GMT" (IMF-fixdate) as UTC; 0 if it isn't one.
+// Expires: 0 and the like are invalid dates, which RFC 9111 reads as stale.
+uint32_t parseHttpDate(const String &date)
+{
+  static const char MONTHS[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char monthName[4] = {0};
+  int year, month, day, hour, minute, second;
+  if (sscanf(date.c_str(), "%*3s, %2d %3s %4d %2d:%2d:%2d", &day, monthName, &year, &hour, &minute, &second) != 6)
+  {
+    return 0;
+  }
+  const char *found = strstr(MONTHS, monthName);
+  if (strlen(monthName) != 3 || !found || (found - MONTHS) % 3 != 0)
+  {
+    return 0;
+  }
+  month = (found - MONTHS) / 3 + 1;
+
+  // Days since 1970-01-01 in the proleptic Gregorian calendar
+  if (month <= 2) year--;
+  long era = year / 400;
+  long yearOfEra = year - era * 400;
+  long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long days = era * 146097 + dayOfEra - 719468;
+
+  return (uint32_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+// Lifetime from Cache-Control and Expires, as an absolute UTC time
+uint32_t expiryOf(HTTPClient &http, uint32_t now)
+{
+  String cacheControl = http.header("Cache-Control");
+  cacheControl.toLowerCase();
+  if (cacheControl.indexOf("no-store") >= 0 || cacheControl.indexOf("no-cache") >= 0)
+  {
+    return 0;
+  }
+
+  uint32_t date = parseHttpDate(http.header("Date"));
+  uint32_t base = date ? date : now;
+
+  int maxAgeAt = cacheControl.indexOf("max-age=");
+  if (maxAgeAt >= 0)
+  {
+    long maxAge = cacheControl.substring(maxAgeAt + 8).toInt();
+    return (base && maxAge > 0) ? base + (uint32_t)maxAge : 0;
+  }
+
+  return parseHttpDate(http.header("Expires"));
+}
+
+void copyHeader(char *out, size_t size, const String &value)
+{
+  if (value.length() < size)
+  {
+    strcpy(out, value.c_str());
+  }
+  else
+  {
+    out[0] = '\0';  // A truncated validator would never match
+  }
+}
+
+} // namespace
+
+void httpCacheCollectHeaders(HTTPClient &http)
+{
+  http.collectHeaders(CACHE_HEADERS, sizeof(CACHE_HEADERS) / sizeof(CACHE_HEADERS[0]));
+}
+
+void httpCacheAddValidators(HTTPClient &http, const HttpCacheEntry &entry)
+{
+  if (entry.etag[0])
+  {
+    http.addHeader("If-None-Match", entry.etag);
+  }
+  if (entry.lastModified[0])
+  {
+    http.addHeader("If-Modified-Since", entry.lastModified);
+  }
+}
+
+void httpCacheUpdate(HttpCacheEntry &entry, HTTPClient &http, int httpCode, uint32_t now)
+{
+  if (httpCode == HTTP_CODE_OK)
+  {
+    httpCacheClear(entry);
+  }
+  else if (httpCode != HTTP_CODE_NOT_MODIFIED)
+  {
+    return;
+  }
+
+  entry.expiresAt = expiryOf(http, now);
+  if (http.hasHeader("ETag"))
+  {
+    copyHeader(entry.etag, sizeof(entry.etag), http.header("ETag"));
+  }
+  if (http.hasHeader("Last-Modified"))
+  {
+    copyHeader(entry.lastModified, sizeof(entry.lastModified), http.header("Last-Modified"));
+  }
+}
+
+bool httpCacheFresh(const HttpCacheEntry &entry, uint32_t now)
+{
+  return now != 0 && now < entry.expiresAt;
+}
+
+void httpCacheClear(HttpCacheEntry &entry)
+{
+  memset(&entry, 0, sizeof(entry));
+}
+
+bool httpCacheLoad(Preferences &prefs, const char *key, HttpCacheEntry &entry)
+{
+  if (prefs.getBytes(key, &entry, sizeof(entry)) != sizeof(entry))
+  {
+    httpCacheClear(entry);
+    return false;
+  }
+  // Stored strings are terminated, but don't trust flash blindly
+  entry.etag[sizeof(entry.etag) - 1] = '\0';
+  entry.lastModified[sizeof(entry.lastModified) - 1] = '\0';
+  return true;
+}
+
+void httpCacheSave(Preferences &prefs, const char *key, const HttpCacheEntry &entry)
+{
+  prefs.putBytes(key, &entry, sizeof(entry));
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// =============================================================================
+// HTTP CACHE - Validators and freshness for AccuWeather responses
+// =============================================================================
+// Each cached resource keeps the validators (ETag, Last-Modified) and the
+// lifetime (Cache-Control max-age, else Expires) of its last response. A
+// refresh sends the validators back as If-None-Match / If-Modified-Since, and
+// a 304 means the copy we already hold (the location or forecast in NVS) is
+// still current, so there is no body to download or parse.
+//
+// Lifetimes are anchored on the response's Date header when it has one, so an
+// entry can be filled in before NTP has set the local clock.
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+
+struct HttpCacheEntry
+{
+  uint32_t expiresAt;     // UTC the response goes stale; 0 if unknown or not to be reused
+  char etag[64];          // Empty if none (or too long to keep)
+  char lastModified[32];  // HTTP-date, sent back verbatim
+};
+
+// Ask HTTPClient to keep the response headers the cache reads, and
+// Content-Type. Call after begin() and before GET().
+void httpCacheCollectHeaders(HTTPClient &http);
+
+// Make the request conditional if the entry has validators. Only call when
+// the data the entry describes is still at hand.
+void httpCacheAddValidators(HTTPClient &http, const HttpCacheEntry &entry);
+
+// Take validators and lifetime from a 200 (replaces the entry) or a 304
+// (refreshes the lifetime and any validators sent along). `now` is the UTC
+// time or 0 if the clock isn't set yet.
+void httpCacheUpdate(HttpCacheEntry &entry, HTTPClient &http, int httpCode, uint32_t now);
+
+// Whether the entry is fresh by its response's own lifetime. False without a
+// lifetime or without the clock (now == 0).
+bool httpCacheFresh(const HttpCacheEntry &entry, uint32_t now);
+
+void httpCacheClear(HttpCacheEntry &entry);
+
+// Keep an entry next to the data it describes, in an open Preferences namespace
+bool httpCacheLoad(Preferences &prefs, const char *key, HttpCacheEntry &entry);
+void httpCacheSave(Preferences &prefs, const char *key, const HttpCacheEntry &entry);
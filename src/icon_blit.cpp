@@ -0,0 +1,54 @@
+// =============================================================================
+// ICON BLIT - Run-length icon streams and their blitters
+// =============================================================================
+
+#include "icon_blit.h"
+
+void blitIcon(DisplayTransport &display, int16_t x, int16_t y, const IconRle &icon,
+              uint16_t color, uint16_t bgColor)
+{
+  display.setAddrWindow(x, y, icon.width, icon.height);
+  bool foreground = false;
+  for (uint16_t i = 0; i < icon.length; i++)
+  {
+    uint8_t run = pgm_read_byte(&icon.runs[i]);
+    if (run > 0)
+    {
+      display.writeColor(foreground ? color : bgColor, run);
+    }
+    foreground = !foreground;
+  }
+  display.flush();
+}
+
+void drawIcon(Adafruit_GFX &gfx, int16_t x, int16_t y, const IconRle &icon, uint16_t color)
+{
+  int16_t col = 0;
+  int16_t row = 0;
+  bool foreground = false;
+
+  gfx.startWrite();
+  for (uint16_t i = 0; i < icon.length; i++)
+  {
+    int16_t run = pgm_read_byte(&icon.runs[i]);
+    while (run > 0)
+    {
+      // Split the run at the icon's right edge
+      int16_t span = icon.width - col;
+      if (span > run) span = run;
+      if (foreground)
+      {
+        gfx.writeFastHLine(x + col, y + row, span, color);
+      }
+      col += span;
+      run -= span;
+      if (col == icon.width)
+      {
+        col = 0;
+        row++;
+      }
+    }
+    foreground = !foreground;
+  }
+  gfx.endWrite();
+}
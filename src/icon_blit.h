@@ -0,0 +1,30 @@
+#pragma once
+
+// =============================================================================
+// ICON BLIT - Run-length icon streams and their blitters
+// =============================================================================
+// tools/icon_rle.py expands every bitmap in icons.h at build time into
+// alternating background/foreground run lengths (icons_rle.h). Drawing an icon
+// is then one address window and a bulk write per run, instead of
+// drawBitmap()'s address window for every set pixel.
+
+#include <Adafruit_GFX.h>
+
+#include "display_transport.h"
+
+struct IconRle
+{
+  uint8_t width;
+  uint8_t height;
+  uint16_t length;      // Bytes in runs
+  const uint8_t *runs;  // Run lengths, background first, alternating (PROGMEM)
+};
+
+// Opaque: paints the whole icon box in one window. Must be fully on screen.
+// Returns with the last pixels queued; fence() the transport before GFX drawing.
+void blitIcon(DisplayTransport &display, int16_t x, int16_t y, const IconRle &icon,
+              uint16_t color, uint16_t bgColor);
+
+// Transparent, like drawBitmap(): foreground runs become horizontal spans.
+// For offscreen targets such as the screen cache's band canvas.
+void drawIcon(Adafruit_GFX &gfx, int16_t x, int16_t y, const IconRle &icon, uint16_t color);
@@ -0,0 +1,505 @@
+// =============================================================================
+// INFLATE - Streaming gzip decompression
+// =============================================================================
+
+#include "inflate.h"
+
+#include <string.h>
+
+namespace
+{
+
+const uint32_t WINDOW_SIZE = 32768;  // Deflate's longest back-reference
+const size_t IN_BUFFER_SIZE = 512;
+const int MAX_BITS = 15;             // Longest Huffman code
+const int MAX_LCODES = 286;
+const int MAX_DCODES = 30;
+const int FIX_LCODES = 288;
+
+// Length and distance codes: base value and extra bits
+const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385,
+                                513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7,
+                                8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order the code length code lengths are sent in
+const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// gzip header flags
+const uint8_t FHCRC = 0x02;
+const uint8_t FEXTRA = 0x04;
+const uint8_t FNAME = 0x08;
+const uint8_t FCOMMENT = 0x10;
+
+// CRC-32 (IEEE), a nibble at a time
+uint32_t crc32Update(uint32_t crc, const uint8_t *data, size_t length)
+{
+  static const uint32_t TABLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+  };
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    crc = (crc >> 4) ^ TABLE[crc & 0x0F];
+    crc = (crc >> 4) ^ TABLE[crc & 0x0F];
+  }
+  return ~crc;
+}
+
+} // namespace
+
+GzipInflater::GzipInflater(Stream &in, size_t inSize) : in_(in), inRemaining_(inSize)
+{
+}
+
+GzipInflater::~GzipInflater()
+{
+  free(inBuffer_);
+  free(tables_);
+  free(window_);
+}
+
+bool GzipInflater::fail(const char *why)
+{
+  if (!error_)
+  {
+    error_ = why;
+  }
+  return false;
+}
+
+int GzipInflater::nextByte()
+{
+  if (inPos_ == inLength_)
+  {
+    size_t want = inRemaining_ < IN_BUFFER_SIZE ? inRemaining_ : IN_BUFFER_SIZE;
+    size_t got = want ? in_.readBytes((char *)inBuffer_, want) : 0;
+    if (got == 0)
+    {
+      fail("stream ended early");
+      return -1;
+    }
+    inRemaining_ -= got;
+    inLength_ = got;
+    inPos_ = 0;
+  }
+  return inBuffer_[inPos_++];
+}
+
+// The next `need` bits (up to 16), least significant first. 0 once the
+// stream has failed; callers check error_ where it matters.
+int GzipInflater::bits(int need)
+{
+  uint32_t value = bitBuffer_;
+  while (bitCount_ < need)
+  {
+    int byte = nextByte();
+    if (byte < 0)
+    {
+      return 0;
+    }
+    value |= (uint32_t)byte << bitCount_;
+    bitCount_ += 8;
+  }
+  bitBuffer_ = value >> need;
+  bitCount_ -= need;
+  return (int)(value & ((1UL << need) - 1));
+}
+
+bool GzipInflater::put(uint8_t byte)
+{
+  window_[windowPos_++] = byte;
+  outTotal_++;
+  return windowPos_ < WINDOW_SIZE || flushWindow();
+}
+
+// Hand on what the window holds since the last flush
+bool GzipInflater::flushWindow()
+{
+  if (windowPos_ > 0)
+  {
+    crc_ = crc32Update(crc_, window_, windowPos_);
+    if (out_->write(window_, windowPos_) != windowPos_)
+    {
+      return fail("could not write the output");
+    }
+  }
+  windowPos_ = 0;
+  return true;
+}
+
+bool GzipInflater::skipGzipHeader()
+{
+  uint8_t header[10];
+  for (uint8_t i = 0; i < sizeof(header); i++)
+  {
+    int byte = nextByte();
+    if (byte < 0)
+    {
+      return false;
+    }
+    header[i] = (uint8_t)byte;
+  }
+  if (header[0] != 0x1F || header[1] != 0x8B || header[2] != 8)
+  {
+    return fail("not gzip");
+  }
+
+  uint8_t flags = header[3];
+  if (flags & FEXTRA)
+  {
+    int length = nextByte();
+    length |= nextByte() << 8;
+    while (length-- > 0 && !error_)
+    {
+      nextByte();
+    }
+  }
+  if (flags & FNAME)
+  {
+    while (nextByte() > 0)
+    {
+    }
+  }
+  if (flags & FCOMMENT)
+  {
+    while (nextByte() > 0)
+    {
+    }
+  }
+  if (flags & FHCRC)
+  {
+    nextByte();
+    nextByte();
+  }
+  return !error_;
+}
+
+// Decode one symbol. Codes are canonical, so within each length they are
+// consecutive and the first code of each length follows from the counts.
+int GzipInflater::decode(const Huffman &h)
+{
+  int code = 0;   // Bits read so far, first bit most significant
+  int first = 0;  // First code of this length
+  int index = 0;  // Index of that code's symbol
+  for (int length = 1; length <= MAX_BITS; length++)
+  {
+    code |= bits(1);
+    int count = h.count[length];
+    if (code - count < first)
+    {
+      return h.symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return -1;  // Ran out of codes
+}
+
+// Canonical code from code lengths. Returns 0 for a complete code, more for
+// an incomplete one and less for an over-subscribed one.
+int GzipInflater::build(Huffman &h, const uint16_t *length, int n)
+{
+  memset(h.count, 0, sizeof(h.count));
+  for (int symbol = 0; symbol < n; symbol++)
+  {
+    h.count[length[symbol]]++;
+  }
+  if (h.count[0] == n)
+  {
+    return 0;  // No codes: complete, but decoding will fail
+  }
+
+  int left = 1;  // Codes of the current length still unused
+  for (int len = 1; len <= MAX_BITS; len++)
+  {
+    left <<= 1;
+    left -= h.count[len];
+    if (left < 0)
+    {
+      return left;
+    }
+  }
+
+  uint16_t offsets[MAX_BITS + 1];
+  offsets[1] = 0;
+  for (int len = 1; len < MAX_BITS; len++)
+  {
+    offsets[len + 1] = offsets[len] + h.count[len];
+  }
+  for (int symbol = 0; symbol < n; symbol++)
+  {
+    if (length[symbol] != 0)
+    {
+      h.symbol[offsets[length[symbol]]++] = symbol;
+    }
+  }
+  return left;
+}
+
+bool GzipInflater::stored()
+{
+  // Stored blocks start on a byte boundary
+  bitBuffer_ = 0;
+  bitCount_ = 0;
+
+  int length = nextByte();
+  length |= nextByte() << 8;
+  int complement = nextByte();
+  complement |= nextByte() << 8;
+  if (error_)
+  {
+    return false;
+  }
+  if (length != (~complement & 0xFFFF))
+  {
+    return fail("bad stored block length");
+  }
+
+  while (length-- > 0)
+  {
+    int byte = nextByte();
+    if (byte < 0 || !put((uint8_t)byte))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool GzipInflater::codes()
+{
+  const Huffman &lencode = tables_->lencode;
+  const Huffman &distcode = tables_->distcode;
+  for (;;)
+  {
+    int symbol = decode(lencode);
+    if (error_)
+    {
+      return false;
+    }
+    if (symbol < 0)
+    {
+      return fail("bad literal/length code");
+    }
+
+    if (symbol < 256)
+    {
+      if (!put((uint8_t)symbol))
+      {
+        return false;
+      }
+      continue;
+    }
+    if (symbol == 256)
+    {
+      return true;  // End of block
+    }
+
+    // Back-reference: length, then distance
+    symbol -= 257;
+    if (symbol >= 29)
+    {
+      return fail("bad length code");
+    }
+    int length = LENGTH_BASE[symbol] + bits(LENGTH_EXTRA[symbol]);
+
+    symbol = decode(distcode);
+    if (symbol < 0 || symbol >= MAX_DCODES)
+    {
+      return fail("bad distance code");
+    }
+    uint32_t distance = DIST_BASE[symbol] + bits(DIST_EXTRA[symbol]);
+    if (error_)
+    {
+      return false;
+    }
+    if (distance > outTotal_)
+    {
+      return fail("distance too far back");
+    }
+
+    while (length-- > 0)
+    {
+      if (!put(window_[(windowPos_ - distance) & (WINDOW_SIZE - 1)]))
+      {
+        return false;
+      }
+    }
+  }
+}
+
+bool GzipInflater::fixed()
+{
+  uint16_t *lengths = tables_->lengths;
+  int symbol = 0;
+  for (; symbol < 144; symbol++) lengths[symbol] = 8;
+  for (; symbol < 256; symbol++) lengths[symbol] = 9;
+  for (; symbol < 280; symbol++) lengths[symbol] = 7;
+  for (; symbol < FIX_LCODES; symbol++) lengths[symbol] = 8;
+  build(tables_->lencode, lengths, FIX_LCODES);
+
+  for (symbol = 0; symbol < MAX_DCODES; symbol++) lengths[symbol] = 5;
+  build(tables_->distcode, lengths, MAX_DCODES);
+
+  return codes();
+}
+
+bool GzipInflater::dynamic()
+{
+  uint16_t *lengths = tables_->lengths;
+  int nlen = bits(5) + 257;
+  int ndist = bits(5) + 1;
+  int ncode = bits(4) + 4;
+  if (error_)
+  {
+    return false;
+  }
+  if (nlen > MAX_LCODES || ndist > MAX_DCODES)
+  {
+    return fail("bad code counts");
+  }
+
+  // Code lengths for the code length alphabet, then the code lengths
+  int index;
+  for (index = 0; index < ncode; index++) lengths[CODE_LENGTH_ORDER[index]] = bits(3);
+  for (; index < 19; index++) lengths[CODE_LENGTH_ORDER[index]] = 0;
+  if (error_)
+  {
+    return false;
+  }
+  if (build(tables_->lencode, lengths, 19) != 0)
+  {
+    return fail("incomplete code length code");
+  }
+
+  index = 0;
+  while (index < nlen + ndist)
+  {
+    int symbol = decode(tables_->lencode);
+    if (error_)
+    {
+      return false;
+    }
+    if (symbol < 0)
+    {
+      return fail("bad code length code");
+    }
+    if (symbol < 16)
+    {
+      lengths[index++] = symbol;
+      continue;
+    }
+
+    uint16_t repeated = 0;
+    int times;
+    if (symbol == 16)
+    {
+      if (index == 0)
+      {
+        return fail("repeat with no first length");
+      }
+      repeated = lengths[index - 1];
+      times = 3 + bits(2);
+    }
+    else if (symbol == 17)
+    {
+      times = 3 + bits(3);
+    }
+    else
+    {
+      times = 11 + bits(7);
+    }
+    if (index + times > nlen + ndist)
+    {
+      return fail("too many lengths");
+    }
+    while (times-- > 0)
+    {
+      lengths[index++] = repeated;
+    }
+  }
+
+  if (lengths[256] == 0)
+  {
+    return fail("no end-of-block code");
+  }
+  // Incomplete codes are only allowed with a single code
+  int left = build(tables_->lencode, lengths, nlen);
+  if (left < 0 || (left > 0 && nlen - tables_->lencode.count[0] != 1))
+  {
+    return fail("bad literal/length lengths");
+  }
+  left = build(tables_->distcode, lengths + nlen, ndist);
+  if (left < 0 || (left > 0 && ndist - tables_->distcode.count[0] != 1))
+  {
+    return fail("bad distance lengths");
+  }
+
+  return codes();
+}
+
+bool GzipInflater::inflateTo(Print &out)
+{
+  out_ = &out;
+  inBuffer_ = (uint8_t *)malloc(IN_BUFFER_SIZE);
+  tables_ = (Tables *)malloc(sizeof(Tables));
+  window_ = (uint8_t *)malloc(WINDOW_SIZE);
+  if (!inBuffer_ || !tables_ || !window_)
+  {
+    return fail("out of memory");
+  }
+
+  if (!skipGzipHeader())
+  {
+    return false;
+  }
+
+  int last;
+  do
+  {
+    last = bits(1);
+    int type = bits(2);
+    if (error_)
+    {
+      return false;
+    }
+    bool ok = (type == 0) ? stored() : (type == 1) ? fixed() : (type == 2) ? dynamic() : fail("bad block type");
+    if (!ok)
+    {
+      return false;
+    }
+  } while (!last);
+
+  if (!flushWindow())
+  {
+    return false;
+  }
+
+  // Trailer, on a byte boundary: CRC-32 and length of the output
+  bitBuffer_ = 0;
+  bitCount_ = 0;
+  uint32_t trailer[2] = {0, 0};
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    int byte = nextByte();
+    if (byte < 0)
+    {
+      return false;
+    }
+    trailer[i / 4] |= (uint32_t)byte << (8 * (i % 4));
+  }
+  if (trailer[0] != crc_ || trailer[1] != outTotal_)
+  {
+    return fail("CRC or length does not match");
+  }
+  return true;
+}
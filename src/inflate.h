@@ -0,0 +1,74 @@
+#pragma once
+
+// =============================================================================
+// INFLATE - Streaming gzip decompression
+// =============================================================================
+// Decompresses a gzip stream (RFC 1952 around RFC 1951 deflate) as it arrives,
+// handing the output on to a Print in pieces of up to 32 KB. Memory is the
+// 32 KB deflate window plus a small input buffer, whatever the size of the
+// data, so a compressed firmware image can go straight into flash.
+//
+// Decoding follows zlib's reference decoder "puff": canonical Huffman codes
+// decoded a bit at a time. That is far from the fastest inflate, but still
+// quicker than the download feeding it. The trailer's CRC-32 and length are
+// checked.
+
+#include <Arduino.h>
+
+class GzipInflater
+{
+public:
+  GzipInflater(Stream &in, size_t inSize);
+  ~GzipInflater();
+
+  // Decompress everything into `out`. False on a malformed stream, a short
+  // read, a failed write or no memory; error() says which.
+  bool inflateTo(Print &out);
+
+  const char *error() const { return error_; }
+  uint32_t outSize() const { return outTotal_; }
+
+private:
+  struct Huffman
+  {
+    uint16_t count[16];    // Codes of each length in bits, 0..15
+    uint16_t symbol[288];  // Symbols in canonical order
+  };
+  struct Tables
+  {
+    Huffman lencode;
+    Huffman distcode;
+    uint16_t lengths[286 + 30];
+  };
+
+  bool fail(const char *why);
+  int nextByte();
+  int bits(int need);
+  bool skipGzipHeader();
+  bool stored();
+  bool codes();
+  bool fixed();
+  bool dynamic();
+  int decode(const Huffman &h);
+  int build(Huffman &h, const uint16_t *length, int n);
+  bool put(uint8_t byte);
+  bool flushWindow();
+
+  Stream &in_;
+  size_t inRemaining_;
+  uint8_t *inBuffer_ = nullptr;
+  size_t inPos_ = 0;
+  size_t inLength_ = 0;
+
+  uint32_t bitBuffer_ = 0;
+  int bitCount_ = 0;
+
+  Tables *tables_ = nullptr;
+  uint8_t *window_ = nullptr;  // The last 32 KB of output, for back-references
+  uint32_t windowPos_ = 0;     // Next byte to write; flushed to out_ when it wraps
+  Print *out_ = nullptr;
+  uint32_t outTotal_ = 0;
+  uint32_t crc_ = 0;
+
+  const char *error_ = nullptr;
+};
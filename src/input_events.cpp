@@ -0,0 +1,207 @@
+// =============================================================================
+// INPUT EVENTS - Interrupt-captured, debounced touch and light switch edges
+// =============================================================================
+
+#include "input_events.h"
+
+#include <atomic>
+
+#include "board.h"
+
+// Level-triggered interrupts double as light sleep wake sources on the device
+#if defined(ESP_PLATFORM) && !defined(HAL_NATIVE)
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <hal/gpio_ll.h>
+#define INPUT_WAKE_FROM_SLEEP 1
+#else
+#define INPUT_WAKE_FROM_SLEEP 0
+#endif
+
+namespace
+{
+
+const uint32_t DEBOUNCE_MS = 25;
+
+struct InputPin
+{
+  uint8_t pin;
+  uint8_t activeLevel;
+};
+
+const InputPin INPUT_PINS[INPUT_COUNT] = {
+  {PIN_TOUCH, HIGH},    // TTP223B drives high while touched
+  {PIN_LIGHT_SW, LOW},  // Switch pulls to ground when on
+};
+
+// Raw edges from the ISRs. Both run at the same interrupt level and don't nest
+// on the single-core C3, so the ring has one producer and one consumer.
+struct RawEdge
+{
+  uint8_t input;
+  uint8_t level;
+  uint32_t atMs;
+};
+
+const uint8_t RING_SIZE = 32;  // Power of two
+RawEdge ring[RING_SIZE];
+std::atomic<uint8_t> ringHead{0};  // Written by the ISRs
+std::atomic<uint8_t> ringTail{0};  // Written by inputNextEvent()
+std::atomic<uint32_t> ringOverflows{0};
+TaskHandle_t wakeTask = nullptr;
+
+// Debounce state, loop task only
+struct InputState
+{
+  bool active;
+  uint32_t acceptedAtMs;
+  bool recheck;  // Edges were ignored; sample the pin once the window ends
+};
+InputState states[INPUT_COUNT];
+
+void IRAM_ATTR recordEdge(uint8_t input)
+{
+  uint8_t pin = INPUT_PINS[input].pin;
+  uint8_t level = digitalRead(pin);
+
+#if INPUT_WAKE_FROM_SLEEP
+  // Re-arm for the opposite level. Reading first means a pin that already
+  // bounced back just re-arms for the level it is at, and fires again.
+  gpio_ll_wakeup_enable(&GPIO, (gpio_num_t)pin, level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+#endif
+
+  uint8_t head = ringHead.load(std::memory_order_relaxed);
+  uint8_t next = (head + 1) & (RING_SIZE - 1);
+  if (next == ringTail.load(std::memory_order_acquire))
+  {
+    ringOverflows.fetch_add(1, std::memory_order_relaxed);
+  }
+  else
+  {
+    ring[head].input = input;
+    ring[head].level = level;
+    ring[head].atMs = millis();
+    ringHead.store(next, std::memory_order_release);
+  }
+
+  if (wakeTask)
+  {
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(wakeTask, &higherPriorityTaskWoken);
+    if (higherPriorityTaskWoken)
+    {
+      portYIELD_FROM_ISR();
+    }
+  }
+}
+
+void IRAM_ATTR touchIsr() { recordEdge(INPUT_TOUCH); }
+void IRAM_ATTR lightSwitchIsr() { recordEdge(INPUT_LIGHT_SWITCH); }
+
+// Accept a level if it is a change and the last change has settled
+bool accept(uint8_t input, bool active, uint32_t atMs, InputEvent &event)
+{
+  InputState &state = states[input];
+  if (atMs - state.acceptedAtMs < DEBOUNCE_MS)
+  {
+    state.recheck = true;
+    return false;
+  }
+  if (active == state.active)
+  {
+    return false;
+  }
+
+  state.active = active;
+  state.acceptedAtMs = atMs;
+  event.input = input;
+  event.active = active;
+  event.atMs = atMs;
+  return true;
+}
+
+} // namespace
+
+void inputBegin(TaskHandle_t notifyTask)
+{
+  wakeTask = notifyTask;
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    states[i].active = (digitalRead(INPUT_PINS[i].pin) == INPUT_PINS[i].activeLevel);
+    states[i].acceptedAtMs = now - DEBOUNCE_MS;
+    states[i].recheck = false;
+  }
+
+#if INPUT_WAKE_FROM_SLEEP
+  void (*const handlers[INPUT_COUNT])(void) = {touchIsr, lightSwitchIsr};
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    uint8_t pin = INPUT_PINS[i].pin;
+    bool high = (digitalRead(pin) == HIGH);
+    gpio_wakeup_enable((gpio_num_t)pin, high ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+    attachInterrupt(digitalPinToInterrupt(pin), handlers[i], high ? ONLOW : ONHIGH);
+  }
+  esp_sleep_enable_gpio_wakeup();
+#else
+  attachInterrupt(digitalPinToInterrupt(PIN_TOUCH), touchIsr, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PIN_LIGHT_SW), lightSwitchIsr, CHANGE);
+#endif
+}
+
+bool inputNextEvent(InputEvent &event)
+{
+  uint32_t overflows = ringOverflows.exchange(0);
+  if (overflows > 0)
+  {
+    Serial.printf("Input: %u edges dropped (ring full)\n", (unsigned)overflows);
+  }
+
+  // Edges captured by the ISRs, in order
+  uint8_t tail = ringTail.load(std::memory_order_relaxed);
+  while (tail != ringHead.load(std::memory_order_acquire))
+  {
+    RawEdge edge = ring[tail];
+    tail = (tail + 1) & (RING_SIZE - 1);
+    ringTail.store(tail, std::memory_order_release);
+
+    bool active = (edge.level == INPUT_PINS[edge.input].activeLevel);
+    if (accept(edge.input, active, edge.atMs, event))
+    {
+      return true;
+    }
+  }
+
+  // Bursts that have settled: the pin may have ended up elsewhere than the
+  // edge we accepted
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    if (states[i].recheck && now - states[i].acceptedAtMs >= DEBOUNCE_MS)
+    {
+      states[i].recheck = false;
+      bool active = (digitalRead(INPUT_PINS[i].pin) == INPUT_PINS[i].activeLevel);
+      if (accept(i, active, now, event))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+uint32_t inputMsUntilSettled()
+{
+  uint32_t wait = UINT32_MAX;
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < INPUT_COUNT; i++)
+  {
+    if (states[i].recheck)
+    {
+      uint32_t elapsed = now - states[i].acceptedAtMs;
+      uint32_t left = (elapsed >= DEBOUNCE_MS) ? 0 : DEBOUNCE_MS - elapsed;
+      if (left < wait) wait = left;
+    }
+  }
+  return wait;
+}
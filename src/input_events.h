@@ -0,0 +1,45 @@
+#pragma once
+
+// =============================================================================
+// INPUT EVENTS - Interrupt-captured, debounced touch and light switch edges
+// =============================================================================
+// Both inputs raise a GPIO interrupt on every edge. The ISR only timestamps the
+// edge into a small ring; debouncing happens in inputNextEvent() on the loop
+// task. The first edge of a burst is accepted at once and later edges inside
+// DEBOUNCE_MS are ignored, so a touch registers without waiting out the bounce
+// and a tap is never lost to a slow loop() pass.
+//
+// After a burst the pin is sampled again, so a release that fell inside the
+// window is still reported.
+//
+// On the device the interrupts are level-triggered and re-armed for the
+// opposite level by the ISR. That still catches every edge, and unlike edge
+// interrupts a level can wake the chip from light sleep.
+
+#include <Arduino.h>
+
+enum InputId : uint8_t
+{
+  INPUT_TOUCH,
+  INPUT_LIGHT_SWITCH,
+  INPUT_COUNT
+};
+
+struct InputEvent
+{
+  uint8_t input;   // InputId
+  bool active;     // Touch pressed / light switch on
+  uint32_t atMs;   // millis() of the edge
+};
+
+// Attach the interrupts; pins must already be configured. Current levels are
+// taken as the starting state and not reported. Every edge notifies wakeTask
+// (xTaskNotifyGive) so it can sleep until there is input.
+void inputBegin(TaskHandle_t wakeTask);
+
+// Next debounced event, oldest first. False when there is none yet.
+bool inputNextEvent(InputEvent &event);
+
+// Time until a debounce window closes and the pins need sampling again;
+// UINT32_MAX when nothing is pending
+uint32_t inputMsUntilSettled();
@@ -0,0 +1,63 @@
+// =============================================================================
+// LED ANIMATOR - Non-blocking blink patterns for the notification LED
+// =============================================================================
+
+#include "led_animator.h"
+
+#include "power.h"
+
+LedAnimator::LedAnimator(uint8_t pin) : pin_(pin)
+{
+}
+
+void LedAnimator::blink(uint8_t count, uint8_t level, uint16_t onMs, uint16_t offMs)
+{
+  level_ = level;
+  onMs_ = onMs;
+  offMs_ = offMs;
+  stepsLeft_ = count * 2;
+  stepStartedAt_ = millis();
+  analogWrite(pin_, count > 0 ? level_ : 0);
+  powerStayAwake(POWER_HOLDER_LED, count > 0);  // LEDC stalls at whatever duty light sleep catches
+}
+
+void LedAnimator::stop()
+{
+  stepsLeft_ = 0;
+  analogWrite(pin_, 0);
+  powerStayAwake(POWER_HOLDER_LED, false);
+}
+
+void LedAnimator::update()
+{
+  // An even count left means the lit phase of a pulse is running
+  while (stepsLeft_ > 0)
+  {
+    uint16_t duration = (stepsLeft_ % 2 == 0) ? onMs_ : offMs_;
+    if (millis() - stepStartedAt_ < duration)
+    {
+      return;
+    }
+    stepStartedAt_ += duration;  // From the step's due time, so a late pass doesn't stretch the pattern
+    stepsLeft_--;
+    if (stepsLeft_ > 0)
+    {
+      analogWrite(pin_, (stepsLeft_ % 2 == 0) ? level_ : 0);
+    }
+    else
+    {
+      powerStayAwake(POWER_HOLDER_LED, false);  // Ended dark
+    }
+  }
+}
+
+uint32_t LedAnimator::msUntilUpdate() const
+{
+  if (stepsLeft_ == 0)
+  {
+    return UINT32_MAX;
+  }
+  uint16_t duration = (stepsLeft_ % 2 == 0) ? onMs_ : offMs_;
+  unsigned long elapsed = millis() - stepStartedAt_;
+  return (elapsed >= duration) ? 0 : duration - elapsed;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// =============================================================================
+// LED ANIMATOR - Non-blocking blink patterns for the notification LED
+// =============================================================================
+// blink() sets the LED straight away and returns; update() moves the pattern
+// on from loop(). The level goes out through analogWrite(), which is an LEDC
+// channel on the ESP32, so the PWM itself needs no CPU between steps; it does
+// need the APB clock, so a running pattern keeps the chip out of light sleep.
+// Starting a new pattern replaces the running one.
+
+#include <Arduino.h>
+
+class LedAnimator
+{
+public:
+  explicit LedAnimator(uint8_t pin);
+
+  // `count` pulses at PWM `level`, each onMs lit then offMs dark
+  void blink(uint8_t count, uint8_t level, uint16_t onMs, uint16_t offMs);
+
+  // LED off and pattern cancelled
+  void stop();
+
+  // Advance the pattern; call on every loop() pass
+  void update();
+
+  bool active() const { return stepsLeft_ > 0; }
+
+  // Time until update() has something to do; UINT32_MAX when idle
+  uint32_t msUntilUpdate() const;
+
+private:
+  uint8_t pin_;
+  uint8_t level_ = 0;
+  uint16_t onMs_ = 0;
+  uint16_t offMs_ = 0;
+  uint8_t stepsLeft_ = 0;          // Lit and dark phases still to finish
+  unsigned long stepStartedAt_ = 0;
+};
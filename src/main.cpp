@@ -11,10 +11,35 @@
 #include <Preferences.h>
 #include <WebServer.h>
 #include <DNSServer.h>
-#include <HTTPUpdate.h>
 #include <WiFiClientSecure.h>
 #include <esp_ota_ops.h>
+#include <esp_sntp.h>
+#include <esp_timer.h>
+#include <atomic>
+#include "alloc_guard.h"
+#include "base_url.h"
+#include "board.h"
+#include "boot_trace.h"
+#include "delta_ota.h"
+#include "display_transport.h"
+#include "fixed_format.h"
+#include "history_graph.h"
+#include "http_cache.h"
+#include "icon_blit.h"
 #include "icons.h"
+#include "icons_rle.h"  // Generated at build time by tools/icon_rle.py
+#include "inflate.h"
+#include "input_events.h"
+#include "led_animator.h"
+#include "metered_display.h"
+#include "metrics.h"
+#include "ota_image.h"
+#include "power.h"
+#include "screen_cache.h"
+#include "sensor_history.h"
+#include "seqlock.h"
+#include "text_renderer.h"
+#include "wifi_link.h"
 
 // =============================================================================
 // FIRMWARE VERSION (for OTA updates)
@@ -32,11 +57,30 @@ const char* FIRMWARE_VERSION = "1.0.2";
 #endif
 const char *ACCUWEATHER_API_KEY_STR = ACCUWEATHER_API_KEY;
 
+// Where the AccuWeather API is served from. Point it at test/replay_server to
+// test without the live API: -DWEATHER_BASE_URL=... in platformio_local.ini,
+// or the portal's weather server field (NVS, takes precedence). An http://
+// URL skips TLS, and the API key is then left out of requests.
+#ifndef WEATHER_BASE_URL
+#define WEATHER_BASE_URL "https://dataservice.accuweather.com"
+#endif
+BaseUrl weatherServer;
+
+// One connection to AccuWeather, kept open between requests on the network
+// task. Closed once idle: servers drop idle keep-alive connections on their
+// own, and the open session holds TLS buffers on the heap.
+WiFiClientSecure accuWeatherClient;
+WiFiClient accuWeatherPlainClient;  // Instead, for an http:// weather server
+unsigned long accuWeatherLastUse = 0;
+uint16_t accuWeatherRequests = 0;                      // On the open connection
+const unsigned long ACCUWEATHER_IDLE_CLOSE = 30000;    // Well inside common server keep-alive timeouts
+
 // These are loaded from non-volatile storage
 String cfg_wifiSsid = "";
 String cfg_wifiPassword = "";
 String cfg_postalCode = "";
 String cfg_countryCode = "US";
+String cfg_weatherUrl = "";  // Empty for WEATHER_BASE_URL
 bool cfg_useCelsius = false;
 bool cfg_use24Hour = false;
 bool configValid = false;
@@ -45,41 +89,13 @@ bool configValid = false;
 const char *AP_SSID = "Satellite-Setup";
 const char *AP_PASSWORD = "";  // Open network for easy setup
 
-// =============================================================================
-// PIN DEFINITIONS
-// =============================================================================
-
-// Display (ST7789 240x280, rotated to 280x240 landscape)
-#define TFT_CS 10
-#define TFT_DC 9
-#define TFT_RST 8
-#define TFT_MOSI 7
-#define TFT_SCLK 6
-
-// I2C (AHT10 sensor)
-#define PIN_I2C_SDA 4
-#define PIN_I2C_SCL 3
-
-// Controls
-#define PIN_TOUCH 2     // TTP223B capacitive touch
-#define PIN_LIGHT_SW 21 // Light switch (LOW = on, HIGH = off)
-
-// Outputs
-#define PIN_BACKLIGHT 20 // Display backlight (PWM)
-#define PIN_LED 0        // Notification LED (PWM)
-
-// =============================================================================
-// DISPLAY CONFIGURATION
-// =============================================================================
-
-#define SCREEN_W 280
-#define SCREEN_H 240
-
 // =============================================================================
 // GLOBAL OBJECTS
 // =============================================================================
 
-Adafruit_ST7789 tft = Adafruit_ST7789(TFT_CS, TFT_DC, TFT_RST);
+MeteredST7789 tft(TFT_CS, TFT_DC, TFT_RST);  // Counts its bytes for /metrics
+DisplayTransport tftTransport(tft);  // DMA path for bulk fills
+LedAnimator led(PIN_LED);
 Adafruit_AHTX0 aht;
 Preferences preferences;
 WebServer server(80);
@@ -92,8 +108,6 @@ DNSServer dnsServer;
 bool setupMode = false;  // True when in captive portal setup mode
 bool ahtFound = false;
 bool lightsEnabled = true;
-bool lastTouchState = LOW;
-bool touchHandled = false;
 
 // Location data from AccuWeather
 String LOCATION_KEY = "";
@@ -101,32 +115,128 @@ String TIME_ZONE = "";
 float GMT_OFFSET_HOURS = 0;
 bool IS_DST = false;
 
+// Location cache (resolved location persisted in NVS, keyed by postal + country code)
+const uint32_t LOCATION_CACHE_TTL = 30UL * 24 * 3600;     // Revalidate after 30 days (seconds)
+const unsigned long LOCATION_CHECK_INTERVAL = 3600000;    // Check the cache every 1 hour
+const time_t MIN_VALID_EPOCH = 1700000000;                // Earlier than this means NTP hasn't set the clock
+uint32_t locationSavedAt = 0;            // UTC when the cache entry was fetched, 0 if before NTP sync
+uint32_t locationNextOffsetChange = 0;   // UTC of the next DST switch, 0 if none
+bool locationChecked = false;
+unsigned long lastLocationCheck = 0;
+HttpCacheEntry locationHttpCache = {};  // Validators of the response the cache came from
+
 // Time display
 unsigned long lastTimeUpdate = 0;
-String lastTimeStr = "";
+const unsigned long CLOCK_TICK_INTERVAL = 1000;  // Screen one redraws every second
 bool colonVisible = true;
 
+// Screen one text, redrawn by glyph diff instead of clearing the screen
+TextRenderer clockText(tft, 5, ST77XX_GREEN, ST77XX_BLACK);
+TextRenderer statusText(tft, 2, ST77XX_CYAN, ST77XX_BLACK);  // In place of the clock until NTP syncs
+TextRenderer tempText(tft, 2, ST77XX_ORANGE, ST77XX_BLACK);
+TextRenderer humText(tft, 2, ST77XX_ORANGE, ST77XX_BLACK);
+bool screenOneDrawn = false;  // Static parts (satellite, divider) are on the panel
+
 // Screen state
-int currentScreen = 1;  // 1 = screen one, 2 = screen two
+int currentScreen = 1;  // 1 = screen one, 2 = screen two, 3 = indoor history
 
-// Sensor caching (to prevent self-heating from frequent polling)
+// Sensor history (read every 30 s whatever is on screen; no faster, to
+// prevent self-heating). The display shows the filtered value.
 unsigned long lastSensorRead = 0;
 const unsigned long SENSOR_READ_INTERVAL = 30000;  // Read sensor every 30 seconds
-float cachedTempF = 0;
-float cachedHumidity = 0;
-bool sensorDataValid = false;
+const float TEMP_OFFSET_F = -6.0;                  // Calibration: sensor reads ~6°F high
+const int32_t TEMP_OFFSET_CENTI_F = lroundf(TEMP_OFFSET_F * 100);  // For the integer display path
+const uint32_t SENSOR_TREND_WINDOW = 3600;         // Logged with each reading (seconds)
+bool sensorSampled = false;                        // A read was attempted
+bool sensorHistoryOnUtc = false;                   // Stamped with UTC, not uptime
+SensorHistory sensorHistory;
+
+// Screen three: the last 24 h of sensorHistory, scrolled by the panel. Bands
+// are 50-90°F and 0-100% as displayed, given in sensor units.
+const float GRAPH_TEMP_LO_F = 50.0;
+const float GRAPH_TEMP_HI_F = 90.0;
+HistoryGraph historyGraph(tft, tftTransport,
+                          (int16_t)lround((GRAPH_TEMP_LO_F - 32.0 - TEMP_OFFSET_F) * 500.0 / 9.0),
+                          (int16_t)lround((GRAPH_TEMP_HI_F - 32.0 - TEMP_OFFSET_F) * 500.0 / 9.0),
+                          0, 10000);
+TextRenderer graphTempText(tft, 2, ST77XX_ORANGE, ST77XX_BLACK);  // Current values in the label strip
+TextRenderer graphHumText(tft, 2, ST77XX_CYAN, ST77XX_BLACK);
+TextRenderer graphTempHigh(tft, 1, ST77XX_ORANGE, ST77XX_BLACK);  // 24 h high, low and 1 h trend
+TextRenderer graphTempLow(tft, 1, ST77XX_ORANGE, ST77XX_BLACK);
+TextRenderer graphTempTrend(tft, 1, ST77XX_ORANGE, ST77XX_BLACK);
+TextRenderer graphHumHigh(tft, 1, ST77XX_CYAN, ST77XX_BLACK);
+TextRenderer graphHumLow(tft, 1, ST77XX_CYAN, ST77XX_BLACK);
+TextRenderer graphHumTrend(tft, 1, ST77XX_CYAN, ST77XX_BLACK);
 
 // Forecast data
 struct DayForecast {
   int iconNum;
   int highTemp;
   int lowTemp;
-  String dayName;
+  char dayName[4];
 };
-DayForecast forecast[3];
+DayForecast forecast[3];  // UI copy, updated from forecastShared
 bool forecastValid = false;
-unsigned long lastForecastFetch = 0;
-const unsigned long FORECAST_REFRESH_INTERVAL = 3600000;  // Refresh forecast every 1 hour
+uint32_t forecastFetchedAt = 0;       // UI copy; UTC, 0 until the clock was set
+unsigned long lastForecastFetch = 0;  // Network task
+bool forecastFetched = false;         // Network task
+const unsigned long FORECAST_REFRESH_INTERVAL = 3600000;  // Refresh forecast every 1 hour, unless the response says otherwise
+const unsigned long FORECAST_MIN_REFRESH_INTERVAL = 600000; // But never more often than every 10 minutes
+const uint32_t FORECAST_STALE_AGE = 2 * 3600;             // Mark the forecast as aged after 2 hours (seconds)
+const uint16_t FORECAST_STALE_COLOR = 0x8410;             // Grey
+
+// Forecast cache (last good forecast persisted in NVS, shown right after boot)
+const uint8_t FORECAST_RECORD_VERSION = 1;
+uint32_t forecastRestoredAt = 0;  // UTC fetch time of the restored record, 0 if none
+HttpCacheEntry forecastHttpCache = {};  // Network task, saved with the record
+bool forecastSavePending = false; // Network task: fetched before the clock was set
+
+// Network task (location, NTP, forecast, OTA check); loop() only talks to it
+// through the notification, forecastShared and otaStatus
+TaskHandle_t networkTaskHandle = nullptr;
+const uint32_t NETWORK_TASK_STACK = 8192;                // Same as the Arduino loop task
+const unsigned long NETWORK_CHECK_INTERVAL = 60000;      // Location revalidation check every 1 minute
+
+struct ForecastSnapshot {
+  DayForecast days[3];
+  uint32_t fetchedAt;  // UTC, 0 if fetched before the clock was set
+};
+SeqLock<ForecastSnapshot> forecastShared;  // Written by the network task only
+uint32_t forecastSeenVersion = 0;
+
+// WiFi link, supervised by loop() and shown there until the clock is set
+WiFiLink wifiLink;
+bool allocGuardArmed = false;  // loop(): set at the first connection
+const bool WIFI_REUSE_LEASE = false;  // Skip DHCP with the last lease; needs an address reservation on the router
+
+// Boot trace stamps from the WiFi and SNTP callbacks (see boot_trace.h)
+uint32_t wifiBeginUs = 0;
+std::atomic<uint32_t> wifiAssociatedUs{0};
+std::atomic<uint32_t> timeSyncStartUs{0};
+
+// Status server on port 80 once the station is up (the captive portal uses
+// the same server in setup mode)
+TaskHandle_t webTaskHandle = nullptr;
+const uint32_t WEB_TASK_STACK = 4096;
+const uint32_t WEB_POLL_INTERVAL = 100;  // ms between handleClient() calls
+
+// Firmware update progress, shown by loop()
+enum OtaStatus : uint8_t { OTA_IDLE, OTA_UPDATING, OTA_FAILED };
+std::atomic<uint8_t> otaStatus{OTA_IDLE};
+uint8_t otaStatusShown = OTA_IDLE;
+
+// loop() sleeps between events; input ISRs and the network task wake it
+// through its task notification
+TaskHandle_t loopTaskHandle = nullptr;
+const unsigned long WAKEUP_REPORT_INTERVAL = 60000;  // Log wakeups per minute
+unsigned long lastWakeupReport = 0;
+uint32_t timerWakeups = 0;   // Woken by a deadline (clock tick, LED step, debounce)
+uint32_t eventWakeups = 0;   // Woken by an input edge or the network task
+
+// Pre-rendered forecast screen, so a touch shows it in one bulk transfer
+const bool USE_SCREEN_CACHE = true;
+ScreenCache screenTwoCache(SCREEN_W, SCREEN_H, ST77XX_BLACK);
+const size_t SCREEN_TWO_CACHE_RUNS = 2048;  // A forecast frame is about 950 runs; 8 KB
 
 // =============================================================================
 // CONFIGURATION STORAGE FUNCTIONS
@@ -140,10 +250,20 @@ void loadConfiguration()
   cfg_wifiPassword = preferences.getString("wifiPass", "");
   cfg_postalCode = preferences.getString("postalCode", "");
   cfg_countryCode = preferences.getString("countryCode", "US");
+  cfg_weatherUrl = preferences.getString("weatherUrl", "");
   cfg_useCelsius = preferences.getBool("useCelsius", false);
   cfg_use24Hour = preferences.getBool("use24Hour", false);
   
   preferences.end();
+
+  if (cfg_weatherUrl.length() == 0 || !parseBaseUrl(cfg_weatherUrl.c_str(), weatherServer))
+  {
+    if (cfg_weatherUrl.length() > 0)
+    {
+      Serial.printf("Weather server %s is not an http(s) URL, ignoring it\n", cfg_weatherUrl.c_str());
+    }
+    parseBaseUrl(WEATHER_BASE_URL, weatherServer);
+  }
   
   // Configuration is valid if we have the essentials
   configValid = (cfg_wifiSsid.length() > 0 && cfg_postalCode.length() > 0);
@@ -154,6 +274,7 @@ void loadConfiguration()
     Serial.printf("  WiFi SSID: %s\n", cfg_wifiSsid.c_str());
     Serial.printf("  Postal Code: %s\n", cfg_postalCode.c_str());
     Serial.printf("  Country: %s\n", cfg_countryCode.c_str());
+    Serial.printf("  Weather server: %s\n", weatherServer.url.c_str());
     Serial.printf("  Celsius: %s\n", cfg_useCelsius ? "Yes" : "No");
     Serial.printf("  24-Hour: %s\n", cfg_use24Hour ? "Yes" : "No");
   }
@@ -167,6 +288,7 @@ void saveConfiguration()
   preferences.putString("wifiPass", cfg_wifiPassword);
   preferences.putString("postalCode", cfg_postalCode);
   preferences.putString("countryCode", cfg_countryCode);
+  preferences.putString("weatherUrl", cfg_weatherUrl);
   preferences.putBool("useCelsius", cfg_useCelsius);
   preferences.putBool("use24Hour", cfg_use24Hour);
   
@@ -181,10 +303,224 @@ void clearConfiguration()
   preferences.begin("weather", false);
   preferences.clear();
   preferences.end();
+  preferences.begin("location", false);
+  preferences.clear();
+  preferences.end();
+  preferences.begin("forecast", false);  // Or the next owner boots to this one's forecast
+  preferences.clear();
+  preferences.end();
+  // The HTTP validators were saved with their data (the "http" keys above);
+  // drop any already loaded as well
+  httpCacheClear(locationHttpCache);
+  httpCacheClear(forecastHttpCache);
+  WiFiLink::forgetSavedAp();  // Its BSSID and lease belong to the old network
   configValid = false;
   Serial.println("Configuration cleared!");
 }
 
+// =============================================================================
+// LOCATION CACHE FUNCTIONS
+// =============================================================================
+
+// Postal and country code the cached location was resolved from
+String locationCacheId()
+{
+  return cfg_postalCode + "," + cfg_countryCode;
+}
+
+bool clockIsSet()
+{
+  return time(nullptr) >= MIN_VALID_EPOCH;
+}
+
+// Parse "2024-03-10T07:00:00Z" as UTC (newlib has no timegm)
+uint32_t parseUtcTimestamp(const char *iso)
+{
+  int year, month, day, hour, minute, second;
+  if (sscanf(iso, "%4d-%2d-%2dT%2d:%2d:%2d", &year, &month, &day, &hour, &minute, &second) != 6)
+  {
+    return 0;
+  }
+
+  // Days since 1970-01-01 in the proleptic Gregorian calendar
+  if (month <= 2) year--;
+  long era = year / 400;
+  long yearOfEra = year - era * 400;
+  long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long days = era * 146097 + dayOfEra - 719468;
+
+  return (uint32_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+// Load the resolved location for the configured postal code, if we have one
+bool loadCachedLocation()
+{
+  preferences.begin("location", true);  // Read-only mode
+
+  bool found = (preferences.getString("id", "") == locationCacheId());
+  if (found)
+  {
+    LOCATION_KEY = preferences.getString("key", "");
+    TIME_ZONE = preferences.getString("tzName", "");
+    GMT_OFFSET_HOURS = preferences.getFloat("gmtOffset", 0);
+    IS_DST = preferences.getBool("isDst", false);
+    locationSavedAt = preferences.getUInt("savedAt", 0);
+    locationNextOffsetChange = preferences.getUInt("nextChange", 0);
+    httpCacheLoad(preferences, "http", locationHttpCache);
+    found = (LOCATION_KEY.length() > 0);
+  }
+
+  preferences.end();
+
+  if (found)
+  {
+    Serial.printf("Using cached location: %s (%s, GMT %.1f)\n",
+                  LOCATION_KEY.c_str(), TIME_ZONE.c_str(), GMT_OFFSET_HOURS);
+  }
+  return found;
+}
+
+void saveCachedLocation()
+{
+  locationSavedAt = clockIsSet() ? (uint32_t)time(nullptr) : 0;
+
+  preferences.begin("location", false);  // Read-write mode
+
+  preferences.putString("id", locationCacheId());
+  preferences.putString("key", LOCATION_KEY);
+  preferences.putString("tzName", TIME_ZONE);
+  preferences.putFloat("gmtOffset", GMT_OFFSET_HOURS);
+  preferences.putBool("isDst", IS_DST);
+  preferences.putUInt("savedAt", locationSavedAt);
+  preferences.putUInt("nextChange", locationNextOffsetChange);
+  httpCacheSave(preferences, "http", locationHttpCache);
+
+  preferences.end();
+}
+
+// =============================================================================
+// FORECAST CACHE FUNCTIONS
+// =============================================================================
+// The last good forecast is kept in NVS as one packed record, so screen two has
+// something to show straight after a reboot, before WiFi is even up. The record
+// carries its fetch time for the stale marker and a CRC, and belongs to one
+// location key.
+
+struct __attribute__((packed)) StoredDay {
+  uint8_t iconNum;
+  int16_t highTemp;
+  int16_t lowTemp;
+  char dayName[4];
+};
+
+struct __attribute__((packed)) ForecastRecord {
+  uint8_t version;       // FORECAST_RECORD_VERSION
+  uint32_t locationCrc;  // crc32 of LOCATION_KEY
+  uint32_t fetchedAt;    // UTC
+  StoredDay days[3];
+  uint32_t crc;          // crc32 of everything above
+};
+
+// CRC-32 (IEEE, as zlib), bit by bit: records are a few dozen bytes
+uint32_t crc32(const void *data, size_t length)
+{
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < length; i++)
+  {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++)
+    {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// Restore the saved forecast and the validators it was fetched with. Needs the
+// location loaded.
+bool loadCachedForecast()
+{
+  ForecastRecord record;
+  preferences.begin("forecast", true);  // Read-only mode
+  size_t length = preferences.getBytes("record", &record, sizeof(record));
+  httpCacheLoad(preferences, "http", forecastHttpCache);
+  preferences.end();
+
+  if (length != sizeof(record) || record.version != FORECAST_RECORD_VERSION ||
+      record.crc != crc32(&record, offsetof(ForecastRecord, crc)))
+  {
+    httpCacheClear(forecastHttpCache);  // Validators without the data are no use
+    return false;
+  }
+  if (LOCATION_KEY.length() == 0 || record.locationCrc != crc32(LOCATION_KEY.c_str(), LOCATION_KEY.length()))
+  {
+    Serial.println("Cached forecast is for another location, ignoring it");
+    httpCacheClear(forecastHttpCache);
+    return false;
+  }
+
+  // Published like a fetched forecast; loop() takes it over on its first pass
+  ForecastSnapshot snapshot = {};
+  for (int i = 0; i < 3; i++)
+  {
+    snapshot.days[i].iconNum = record.days[i].iconNum;
+    snapshot.days[i].highTemp = record.days[i].highTemp;
+    snapshot.days[i].lowTemp = record.days[i].lowTemp;
+    memcpy(snapshot.days[i].dayName, record.days[i].dayName, sizeof(snapshot.days[i].dayName));
+    snapshot.days[i].dayName[sizeof(snapshot.days[i].dayName) - 1] = '\0';
+  }
+  snapshot.fetchedAt = record.fetchedAt;
+  forecastShared.write(snapshot);  // Before the network task exists, so still one writer
+  forecastRestoredAt = record.fetchedAt;
+
+  Serial.printf("Using cached forecast from UTC %lu\n", (unsigned long)record.fetchedAt);
+  return true;
+}
+
+// Save a freshly fetched forecast. Runs on the network task; without a wall
+// clock the fetch time is unknown, so the save waits for NTP.
+void saveCachedForecast(const ForecastSnapshot &snapshot)
+{
+  if (snapshot.fetchedAt == 0)
+  {
+    forecastSavePending = true;
+    return;
+  }
+  forecastSavePending = false;
+
+  ForecastRecord record = {};
+  record.version = FORECAST_RECORD_VERSION;
+  record.locationCrc = crc32(LOCATION_KEY.c_str(), LOCATION_KEY.length());
+  record.fetchedAt = snapshot.fetchedAt;
+  for (int i = 0; i < 3; i++)
+  {
+    record.days[i].iconNum = (uint8_t)snapshot.days[i].iconNum;
+    record.days[i].highTemp = (int16_t)snapshot.days[i].highTemp;
+    record.days[i].lowTemp = (int16_t)snapshot.days[i].lowTemp;
+    memcpy(record.days[i].dayName, snapshot.days[i].dayName, sizeof(record.days[i].dayName));
+  }
+  record.crc = crc32(&record, offsetof(ForecastRecord, crc));
+
+  preferences.begin("forecast", false);  // Read-write mode
+  preferences.putBytes("record", &record, sizeof(record));
+  httpCacheSave(preferences, "http", forecastHttpCache);
+  preferences.end();
+}
+
+// Seconds since the forecast on screen was fetched, or -1 if it isn't aged
+// (or its age can't be told yet)
+long forecastStaleAge()
+{
+  if (forecastFetchedAt == 0 || !clockIsSet())
+  {
+    return -1;
+  }
+  long age = (long)(time(nullptr) - forecastFetchedAt);
+  return age > (long)FORECAST_STALE_AGE ? age : -1;
+}
+
 // =============================================================================
 // CAPTIVE PORTAL HTML
 // =============================================================================
@@ -238,6 +574,9 @@ const char SETUP_HTML[] PROGMEM = R"rawliteral(
       <label>Country Code</label>
       <input type="text" name="country" value="US" maxlength="2" placeholder="e.g., US, CA, UK">
       <p class="note">2 digit country code</p>
+      <label>Weather Server</label>
+      <input type="text" name="weatherUrl" placeholder="Leave blank for AccuWeather">
+      <p class="note">For testing only, e.g. a replay server at http://192.168.1.10:8080. The API key is only sent to https:// servers.</p>
       
       <h2>Display Preferences</h2>
       <div class="checkbox-group">
@@ -299,6 +638,8 @@ void handleSave()
   cfg_wifiPassword = server.arg("password");
   cfg_postalCode = server.arg("postal");
   cfg_countryCode = server.arg("country");
+  cfg_weatherUrl = server.arg("weatherUrl");
+  cfg_weatherUrl.trim();
   cfg_useCelsius = server.hasArg("celsius");
   cfg_use24Hour = server.hasArg("hour24");
   
@@ -406,6 +747,122 @@ String urlEncode(const String &str)
   return encoded;
 }
 
+// Open a TLS connection ahead of the request, so the handshake can be timed
+// apart from it. HTTPClient reuses a client that's connected. No certificate
+// check, same as HTTPClient's own client without a CA cert.
+bool connectTls(WiFiClientSecure &client, const char *host, uint16_t port, const char *what)
+{
+  client.setInsecure();
+  uint32_t startUs = bootTraceNow();
+  if (!client.connect(host, port))
+  {
+    Serial.printf("Could not connect to %s\n", host);
+    return false;
+  }
+  uint32_t endUs = bootTraceNow();
+  bootTraceSpan(PHASE_TLS_HANDSHAKE, startUs, endUs, what);
+  Serial.printf("TLS handshake for %s: %lu ms\n", what, (unsigned long)((endUs - startUs + 500) / 1000));
+  return true;
+}
+
+// The client requests to the weather server go through: TLS unless the base
+// URL is http://
+WiFiClient &accuWeatherConnection()
+{
+  if (weatherServer.tls)
+  {
+    return accuWeatherClient;
+  }
+  return accuWeatherPlainClient;
+}
+
+// The API key goes over TLS only: on an http:// weather server anyone on the
+// path could read it, and the replay server and fleet proxy don't need it
+void addApiKeyHeader(HTTPClient &http)
+{
+  if (weatherServer.tls)
+  {
+    http.addHeader("Authorization", String("Bearer ") + ACCUWEATHER_API_KEY_STR);
+  }
+}
+
+// Get accuWeatherConnection() ready for a request: the open connection if
+// it's still up and hasn't sat idle too long, else a new one
+bool connectAccuWeather(const char *what)
+{
+  WiFiClient &client = accuWeatherConnection();
+  if (client.connected() && millis() - accuWeatherLastUse < ACCUWEATHER_IDLE_CLOSE)
+  {
+    Serial.printf("TLS handshake for %s: none, reusing the connection (request %u on it)\n", what,
+                  (unsigned)accuWeatherRequests + 1);
+    return true;
+  }
+
+  client.stop();
+  accuWeatherRequests = 0;
+  if (weatherServer.tls)
+  {
+    return connectTls(accuWeatherClient, weatherServer.host.c_str(), weatherServer.port, what);
+  }
+  if (!client.connect(weatherServer.host.c_str(), weatherServer.port))
+  {
+    Serial.printf("Could not connect to %s:%u\n", weatherServer.host.c_str(), (unsigned)weatherServer.port);
+    return false;
+  }
+  Serial.printf("Connected for %s without TLS\n", what);
+  return true;
+}
+
+// After http.end(): HTTPClient has already closed the connection if the
+// server didn't keep it open. After a failed request its state is unknown,
+// so it goes too.
+void releaseAccuWeather(int httpCode)
+{
+  if (httpCode < 0)
+  {
+    accuWeatherConnection().stop();
+  }
+  accuWeatherRequests++;
+  accuWeatherLastUse = millis();
+}
+
+// Close the connection once it has been idle for ACCUWEATHER_IDLE_CLOSE;
+// returns how long until that is due (0 when nothing is open)
+uint32_t closeIdleAccuWeather()
+{
+  WiFiClient &client = accuWeatherConnection();
+  if (!client.connected())
+  {
+    return 0;
+  }
+  unsigned long idle = millis() - accuWeatherLastUse;
+  if (idle < ACCUWEATHER_IDLE_CLOSE)
+  {
+    return (uint32_t)(ACCUWEATHER_IDLE_CLOSE - idle);
+  }
+  Serial.printf("Closing the idle connection to %s after %u requests\n", weatherServer.host.c_str(),
+                (unsigned)accuWeatherRequests);
+  client.stop();
+  return 0;
+}
+
+// Log heap headroom. The low-water mark is since boot, so comparing it before
+// and after a request shows whether that request set a new peak.
+void logHeap(const char *label)
+{
+  Serial.printf("%s: free %u, min free %u, largest block %u\n", label,
+                (unsigned)ESP.getFreeHeap(), (unsigned)ESP.getMinFreeHeap(), (unsigned)ESP.getMaxAllocHeap());
+}
+
+// Wake loop() to pick up something the network task published
+void notifyLoop()
+{
+  if (loopTaskHandle)
+  {
+    xTaskNotifyGive(loopTaskHandle);
+  }
+}
+
 // Map AccuWeather icon number to local bitmap
 const unsigned char* getWeatherIcon(int iconNum)
 {
@@ -461,9 +918,25 @@ const unsigned char* getWeatherIcon(int iconNum)
   }
 }
 
+// Run-length stream for one of the icons.h bitmaps
+const IconRle &getIconRle(const unsigned char* bitmap)
+{
+  for (int i = 0; i < weather_allArray_LEN; i++)
+  {
+    if (weather_allArray[i] == bitmap)
+    {
+      return weather_allArray_rle[i];
+    }
+  }
+  return weather_allArray_rle[0];  // Not reached, every icon is in weather_allArray
+}
+
 void displayCenteredText(const char *text, uint16_t color)
 {
-  tft.fillScreen(ST77XX_BLACK);
+  historyGraph.end();  // Draw unscrolled
+
+  // Clear by DMA and lay out the text while it transfers
+  tftTransport.fillRect(0, 0, SCREEN_W, SCREEN_H, ST77XX_BLACK);
   tft.setTextColor(color);
   tft.setTextSize(2);
 
@@ -473,17 +946,20 @@ void displayCenteredText(const char *text, uint16_t color)
   const int maxWidth = SCREEN_W - (padding * 2);
   const int maxCharsPerLine = maxWidth / charWidth;
 
-  // Split text into lines
-  String inputText = String(text);
-  String lines[4]; // Max 4 lines
+  // Split text into lines, as pieces of `text`
+  const char *lines[4]; // Max 4 lines
+  int lineLengths[4];
   int lineCount = 0;
+  const char *rest = text;
 
-  while (inputText.length() > 0 && lineCount < 4)
+  while (*rest && lineCount < 4)
   {
-    if ((int)inputText.length() <= maxCharsPerLine)
+    int restLength = strlen(rest);
+    if (restLength <= maxCharsPerLine)
     {
       // Remaining text fits on one line
-      lines[lineCount++] = inputText;
+      lines[lineCount] = rest;
+      lineLengths[lineCount++] = restLength;
       break;
     }
     else
@@ -492,15 +968,20 @@ void displayCenteredText(const char *text, uint16_t color)
       int breakPoint = maxCharsPerLine;
       for (int i = maxCharsPerLine; i >= 0; i--)
       {
-        if (inputText.charAt(i) == ' ')
+        if (rest[i] == ' ')
         {
           breakPoint = i;
           break;
         }
       }
 
-      lines[lineCount++] = inputText.substring(0, breakPoint);
-      inputText = inputText.substring(breakPoint + 1); // Skip the space
+      lines[lineCount] = rest;
+      lineLengths[lineCount++] = breakPoint;
+      rest += breakPoint;
+      if (*rest == ' ')
+      {
+        rest++; // Skip the space
+      }
     }
   }
 
@@ -508,33 +989,60 @@ void displayCenteredText(const char *text, uint16_t color)
   int totalHeight = lineCount * lineHeight;
   int startY = (SCREEN_H - totalHeight) / 2;
 
+  tftTransport.fence();  // Screen must be clear before drawing over it
+
   // Draw each line centered
   for (int i = 0; i < lineCount; i++)
   {
-    int textWidth = lines[i].length() * charWidth;
+    int textWidth = lineLengths[i] * charWidth;
     int x = (SCREEN_W - textWidth) / 2;
     int y = startY + (i * lineHeight);
 
     tft.setCursor(x, y);
-    tft.println(lines[i]);
+    tft.write(lines[i], lineLengths[i]);
+  }
+}
+
+// Where the network is during boot, shown in the clock's place
+void displayLinkStatus(bool show)
+{
+  const char *text = "";
+  if (show)
+  {
+    switch (wifiLink.state())
+    {
+      case LINK_CONNECTING:
+        text = "Connecting to Earth...";
+        break;
+      case LINK_UP:
+        text = "Connected to Earth";
+        break;
+      default:
+        text = "Could not reach Earth";  // One line: the full message is too wide
+        break;
+    }
   }
+
+  int x = (SCREEN_W - (int)strlen(text) * statusText.charWidth()) / 2;
+  int y = (SCREEN_H - statusText.charHeight()) / 2;
+  statusText.draw(text, x, y);
 }
 
 void displayTime()
 {
   struct tm timeinfo;
-  if (!getLocalTime(&timeinfo))
+  if (!getLocalTime(&timeinfo, 0))
   {
+    displayLinkStatus(true);  // No clock until NTP has synced
     return;
   }
+  displayLinkStatus(false);
 
   // Format time string based on 12/24 hour setting
-  char baseTimeStr[16];
   char timeStr[16];
   
   if (cfg_use24Hour)
   {
-    sprintf(baseTimeStr, "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
     if (colonVisible)
     {
       sprintf(timeStr, "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
@@ -549,7 +1057,6 @@ void displayTime()
     int hour12 = timeinfo.tm_hour % 12;
     if (hour12 == 0) hour12 = 12;
     const char *ampm = (timeinfo.tm_hour < 12) ? "AM" : "PM";
-    sprintf(baseTimeStr, "%d:%02d %s", hour12, timeinfo.tm_min, ampm);
     if (colonVisible)
     {
       sprintf(timeStr, "%d:%02d %s", hour12, timeinfo.tm_min, ampm);
@@ -561,115 +1068,164 @@ void displayTime()
   }
   colonVisible = !colonVisible;  // Toggle for next update
 
-  // Check if time actually changed (not just colon blink)
-  bool timeChanged = (String(baseTimeStr) != lastTimeStr);
-
   // Calculate centered position
-  int charWidth = 6 * 5;  // 6 pixels per char * text size 5
-  int textWidth = strlen(timeStr) * charWidth;
+  int textWidth = strlen(timeStr) * clockText.charWidth();
   int x = (SCREEN_W - textWidth) / 2;
-  int y = (SCREEN_H - 40) / 2;  // 8 pixels tall * 5 = 40
+  int y = (SCREEN_H - clockText.charHeight()) / 2;
+
+  // Only the glyph pixels that changed since the last second are sent
+  clockText.draw(timeStr, x, y);
+}
 
-  // Only clear screen if time changed, not just colon blink
-  if (timeChanged)
+// Calibrated hundredths of a degree Fahrenheit for a sensor history value
+int32_t sensorCentiF(int16_t centiC)
+{
+  return divRound(centiC * 9, 5) + 3200 + TEMP_OFFSET_CENTI_F;
+}
+
+// Calibrated, in hundredths of a degree F or C per the settings
+int32_t displayCentiTemp(int16_t centiC)
+{
+  return cfg_useCelsius ? centiC + divRound(TEMP_OFFSET_CENTI_F * 5, 9) : sensorCentiF(centiC);
+}
+
+// A temperature change, in hundredths of a degree F or C per the settings
+int32_t displayCentiTempDelta(int16_t centiC)
+{
+  return cfg_useCelsius ? centiC : divRound(centiC * 9, 5);
+}
+
+// Timestamp for a sensorHistory sample: UTC once the clock is set, so the
+// graph's hours are clock hours; until then seconds since boot, from the
+// 64-bit esp_timer (millis() wraps after 49 days). The first sample after the
+// clock is set moves the uptime-stamped ones onto UTC.
+uint32_t sensorSampleTime()
+{
+  uint32_t uptimeS = (uint32_t)(esp_timer_get_time() / 1000000);
+  if (!sensorHistoryOnUtc && clockIsSet())
   {
-    tft.fillScreen(ST77XX_BLACK);
-    lastTimeStr = String(baseTimeStr);
+    sensorHistory.shiftTime((uint32_t)time(nullptr) - uptimeS);
+    sensorHistoryOnUtc = true;
+  }
+  // Read each time: a new location can bring a new offset
+  historyGraph.setUtcOffset(sensorHistoryOnUtc ? (int32_t)lroundf(GMT_OFFSET_HOURS * 3600) : 0);
+  return sensorHistoryOnUtc ? (uint32_t)time(nullptr) : uptimeS;
+}
+
+// Read the AHT10 into sensorHistory once SENSOR_READ_INTERVAL has passed.
+// Returns true if a sample was added.
+bool sampleSensor()
+{
+  if (!ahtFound || (sensorSampled && millis() - lastSensorRead < SENSOR_READ_INTERVAL))
+  {
+    return false;
   }
+  lastSensorRead = millis();
+  sensorSampled = true;
 
-  // Use setTextColor with background to overwrite without flicker
-  tft.setTextColor(ST77XX_GREEN, ST77XX_BLACK);
-  tft.setTextSize(5);  // Large font
-  tft.setCursor(x, y);
-  tft.print(timeStr);
+  sensors_event_t humidity, temp;
+  if (!aht.getEvent(&humidity, &temp))
+  {
+    Serial.println("Sensor read failed");
+    return false;
+  }
+  sensorHistory.add(sensorSampleTime(), temp.temperature, humidity.relative_humidity);
+
+  const SensorSample &latest = sensorHistory.latest();
+  SensorStats hour;
+  sensorHistory.stats(latest.atS, SENSOR_TREND_WINDOW, hour);
+  char tempStr[8], humStr[8], tempTrend[8], humTrend[8];
+  formatFixed(tempStr, sizeof(tempStr), sensorCentiF(latest.value.centiC), 2, 1);
+  formatFixed(humStr, sizeof(humStr), latest.value.centiRh, 2, 1);
+  formatFixed(tempTrend, sizeof(tempTrend), divRound(hour.trendPerHour.centiC * 9, 5), 2, 1, true);
+  formatFixed(humTrend, sizeof(humTrend), hour.trendPerHour.centiRh, 2, 1, true);
+  // Short enough for Serial.printf's stack buffer (64 bytes; longer goes to the heap)
+  Serial.printf("Sensor read: %s°F, %s%% (%s°F/h, %s%%/h)\n", tempStr, humStr, tempTrend, humTrend);
+  return true;
 }
 
 void displayTempHum()
 {
-  // Display temperature and humidity from AHT10
-  if (ahtFound)
+  // Display temperature and humidity from AHT10, filtered
+  if (ahtFound && !sensorHistory.empty())
   {
-    // Only read sensor every SENSOR_READ_INTERVAL ms to prevent self-heating
-    if (!sensorDataValid || (millis() - lastSensorRead >= SENSOR_READ_INTERVAL))
-    {
-      sensors_event_t humidity, temp;
-      aht.getEvent(&humidity, &temp);
-      
-      // Calibration offset (in Fahrenheit)
-      const float TEMP_OFFSET_F = -6.0;  // Calibration: sensor reads ~6°F high
-      cachedTempF = (temp.temperature * 9.0 / 5.0) + 32.0 + TEMP_OFFSET_F;
-      cachedHumidity = humidity.relative_humidity;
-      
-      lastSensorRead = millis();
-      sensorDataValid = true;
-      
-      Serial.printf("Sensor read: %.1f°F, %.1f%%\n", cachedTempF, cachedHumidity);
-    }
-    
-    // Format strings using cached values
+    SensorReading reading = sensorHistory.filtered();
+
+    char value[8];
     char tempStr[16];
     char humStr[16];
-    if (cfg_useCelsius)
-    {
-      float tempC = (cachedTempF - 32.0) * 5.0 / 9.0;
-      sprintf(tempStr, "Temp: %.0f%cC", tempC, 247);  // 247 is degree symbol
-    }
-    else
-    {
-      sprintf(tempStr, "Temp: %.0f%cF", cachedTempF, 247);  // 247 is degree symbol
-    }
-    sprintf(humStr, "Hum: %.0f%%", cachedHumidity);
+    formatFixed(value, sizeof(value), displayCentiTemp(reading.centiC), 2, 0);
+    sprintf(tempStr, "Temp: %s%c%c", value, 247, cfg_useCelsius ? 'C' : 'F');  // 247 is degree symbol
+    formatFixed(value, sizeof(value), reading.centiRh, 2, 0);
+    sprintf(humStr, "Hum: %s%%", value);
     
-    tft.setTextColor(ST77XX_ORANGE, ST77XX_BLACK);
-    tft.setTextSize(2);  // Small text
-    
-    int charWidth = 6 * 2;  // 6 pixels per char * text size 2
     int y = SCREEN_H - 40;  // Bottom of screen with some padding
     
-    // Draw horizontal line above temp/humidity
-    tft.drawFastHLine(0, y - 12, SCREEN_W, ST77XX_ORANGE);
-    
     // Left column - Temperature (centered in left half)
-    int tempWidth = strlen(tempStr) * charWidth;
+    int tempWidth = strlen(tempStr) * tempText.charWidth();
     int tempX = (SCREEN_W / 4) - (tempWidth / 2);
-    tft.setCursor(tempX, y);
-    tft.print(tempStr);
+    tempText.draw(tempStr, tempX, y);
     
     // Right column - Humidity (centered in right half)
-    int humWidth = strlen(humStr) * charWidth;
+    int humWidth = strlen(humStr) * humText.charWidth();
     int humX = (SCREEN_W * 3 / 4) - (humWidth / 2);
-    tft.setCursor(humX, y);
-    tft.print(humStr);
+    humText.draw(humStr, humX, y);
   }
 }
 
+// Call with the screen cleared to black; later calls only update what changed
 void displayScreenOne()
 {
+  MetricsRenderTimer timer(SCREEN_CLOCK);
+  if (!screenOneDrawn)
+  {
+    clockText.invalidate();
+    statusText.invalidate();
+    tempText.invalidate();
+    humText.invalidate();
+
+    // Draw satellite icon in upper left corner (32x32)
+    blitIcon(tftTransport, 20, 20, getIconRle(weather_satellite), ST77XX_CYAN, ST77XX_BLACK);
+    tftTransport.fence();
+
+    // Draw horizontal line above temp/humidity
+    if (ahtFound)
+    {
+      tft.drawFastHLine(0, SCREEN_H - 52, SCREEN_W, ST77XX_ORANGE);
+    }
+    screenOneDrawn = true;
+  }
+
   displayTime();
   displayTempHum();
-  
-  // Draw satellite icon in upper left corner (32x32)
-  tft.drawBitmap(20, 20, weather_satellite, 32, 32, ST77XX_CYAN);
 }
 
-void displayScreenTwo()
+// Identifies everything drawForecast() reads, so the cache knows when to rebuild
+uint32_t forecastScreenKey()
 {
-  tft.fillScreen(ST77XX_BLACK);
-  
-  if (!forecastValid)
+  long staleAge = forecastStaleAge();
+  int fields[11] = {cfg_useCelsius ? 1 : 0, staleAge < 0 ? -1 : (int)(staleAge / 3600)};
+  for (int i = 0; i < 3; i++)
   {
-    tft.setTextColor(ST77XX_WHITE);
-    tft.setTextSize(2);
-    const char* text = "Loading forecast...";
-    int charWidth = 6 * 2;
-    int textWidth = strlen(text) * charWidth;
-    int x = (SCREEN_W - textWidth) / 2;
-    int y = (SCREEN_H - 16) / 2;
-    tft.setCursor(x, y);
-    tft.print(text);
-    return;
+    fields[2 + i * 3] = forecast[i].iconNum;
+    fields[3 + i * 3] = forecast[i].highTemp;
+    fields[4 + i * 3] = forecast[i].lowTemp;
   }
-  
+
+  // FNV-1a
+  uint32_t key = 2166136261u;
+  const uint8_t *bytes = (const uint8_t *)fields;
+  for (size_t i = 0; i < sizeof(fields); i++)
+  {
+    key = (key ^ bytes[i]) * 16777619u;
+  }
+  return key;
+}
+
+// Draw the 3-day forecast (everything on screen two except the clock) onto a
+// black screen. Used for the panel directly and for rendering the cache.
+void drawForecast(Adafruit_GFX &gfx)
+{
   // Display 3-day forecast in 3 columns
   // Screen is 280x240
   // Each column: ~93px wide
@@ -687,49 +1243,108 @@ void displayScreenTwo()
     // Weather icon centered in column (48x48)
     const unsigned char* icon = getWeatherIcon(forecast[i].iconNum);
     int iconX = colCenterX - (iconSize / 2);
-    tft.drawBitmap(iconX, startY, icon, iconSize, iconSize, ST77XX_WHITE);
+    drawIcon(gfx, iconX, startY, getIconRle(icon), ST77XX_WHITE);
     
     // High temp (orange)
-    tft.setTextColor(ST77XX_ORANGE, ST77XX_BLACK);
-    tft.setTextSize(2);
+    gfx.setTextColor(ST77XX_ORANGE, ST77XX_BLACK);
+    gfx.setTextSize(2);
     char highStr[8];
     int highDisplay = cfg_useCelsius ? (int)round((forecast[i].highTemp - 32) * 5.0 / 9.0) : forecast[i].highTemp;
     sprintf(highStr, "%d%c", highDisplay, 247);
     int highWidth = strlen(highStr) * 12;  // 6 * 2 = 12 pixels per char
     int highX = colCenterX - (highWidth / 2);
-    tft.setCursor(highX, startY + 58);
-    tft.print(highStr);
+    gfx.setCursor(highX, startY + 58);
+    gfx.print(highStr);
     
     // Low temp (blue)
-    tft.setTextColor(ST77XX_BLUE, ST77XX_BLACK);
-    tft.setTextSize(2);
+    gfx.setTextColor(ST77XX_BLUE, ST77XX_BLACK);
+    gfx.setTextSize(2);
     char lowStr[8];
     int lowDisplay = cfg_useCelsius ? (int)round((forecast[i].lowTemp - 32) * 5.0 / 9.0) : forecast[i].lowTemp;
     sprintf(lowStr, "%d%c", lowDisplay, 247);
     int lowWidth = strlen(lowStr) * 12;
     int lowX = colCenterX - (lowWidth / 2);
-    tft.setCursor(lowX, startY + 82);
-    tft.print(lowStr);
+    gfx.setCursor(lowX, startY + 82);
+    gfx.print(lowStr);
   }
-  
-  // Display current time at bottom
-  struct tm timeinfo;
-  if (getLocalTime(&timeinfo))
+
+  // Aged data (restored after a reboot, or fetches failing): say how old
+  long staleAge = forecastStaleAge();
+  if (staleAge >= 0)
   {
-    char timeStr[16];
-    if (cfg_use24Hour)
+    char ageStr[32];
+    if (staleAge < 48 * 3600)
     {
-      sprintf(timeStr, "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
+      sprintf(ageStr, "Updated %ldh ago", staleAge / 3600);
     }
     else
     {
-      int hour12 = timeinfo.tm_hour % 12;
-      if (hour12 == 0) hour12 = 12;
-      const char *ampm = (timeinfo.tm_hour < 12) ? "AM" : "PM";
-      sprintf(timeStr, "%d:%02d %s", hour12, timeinfo.tm_min, ampm);
+      sprintf(ageStr, "Updated %ldd ago", staleAge / 86400);
     }
-    
-    tft.setTextColor(ST77XX_GREEN, ST77XX_BLACK);
+    gfx.setTextColor(FORECAST_STALE_COLOR, ST77XX_BLACK);
+    gfx.setTextSize(2);
+    gfx.setCursor((SCREEN_W - (int)strlen(ageStr) * 12) / 2, 16);
+    gfx.print(ageStr);
+  }
+}
+
+// Rebuild the forecast screen cache if the forecast or units changed
+bool updateScreenTwoCache()
+{
+  return USE_SCREEN_CACHE && forecastValid && screenTwoCache.update(forecastScreenKey(), drawForecast);
+}
+
+void displayScreenTwo()
+{
+  MetricsRenderTimer timer(SCREEN_FORECAST);
+  if (!forecastValid)
+  {
+    tftTransport.fillRect(0, 0, SCREEN_W, SCREEN_H, ST77XX_BLACK);
+    tftTransport.fence();
+    tft.setTextColor(ST77XX_WHITE);
+    tft.setTextSize(2);
+    const char* text = "Loading forecast...";
+    int charWidth = 6 * 2;
+    int textWidth = strlen(text) * charWidth;
+    int x = (SCREEN_W - textWidth) / 2;
+    int y = (SCREEN_H - 16) / 2;
+    tft.setCursor(x, y);
+    tft.print(text);
+    return;
+  }
+  
+  if (updateScreenTwoCache())
+  {
+    // One address window, whole frame streamed as pixel runs
+    screenTwoCache.push(tftTransport);
+  }
+  else
+  {
+    tftTransport.fillRect(0, 0, SCREEN_W, SCREEN_H, ST77XX_BLACK);
+    tftTransport.fence();
+    drawForecast(tft);
+  }
+  
+  // Display current time at bottom, read while the frame is still streaming
+  struct tm timeinfo;
+  bool haveTime = getLocalTime(&timeinfo, 0);
+  tftTransport.fence();
+  if (haveTime)
+  {
+    char timeStr[16];
+    if (cfg_use24Hour)
+    {
+      sprintf(timeStr, "%02d:%02d", timeinfo.tm_hour, timeinfo.tm_min);
+    }
+    else
+    {
+      int hour12 = timeinfo.tm_hour % 12;
+      if (hour12 == 0) hour12 = 12;
+      const char *ampm = (timeinfo.tm_hour < 12) ? "AM" : "PM";
+      sprintf(timeStr, "%d:%02d %s", hour12, timeinfo.tm_min, ampm);
+    }
+    
+    tft.setTextColor(ST77XX_GREEN, ST77XX_BLACK);
     tft.setTextSize(2);
     int timeWidth = strlen(timeStr) * 12;
     int timeX = (SCREEN_W - timeWidth) / 2;
@@ -738,13 +1353,170 @@ void displayScreenTwo()
   }
 }
 
+// Trend in hundredths per hour for the label strip, in at most 6 characters:
+// "+0.4/h", "-12/h"
+void formatTrend(char *out, size_t size, int32_t centiPerHour)
+{
+  int length = formatFixed(out, size, centiPerHour, 2, (abs(centiPerHour) < 995) ? 1 : 0, true);
+  snprintf(out + length, size - length, "/h");
+}
+
+// Current value, 24 h range and 1 h trend beside each band of the graph
+void displayGraphValues()
+{
+  char text[16];
+  if (sensorHistory.empty())
+  {
+    graphTempText.draw("--", 2, 20);
+    graphHumText.draw("--", 2, 140);
+    return;
+  }
+
+  SensorReading now = sensorHistory.filtered();
+  uint32_t nowS = sensorHistory.latest().atS;
+  SensorStats day, hour;
+  sensorHistory.stats(nowS, 24 * 3600, day);
+  sensorHistory.stats(nowS, SENSOR_TREND_WINDOW, hour);
+
+  formatFixed(text, sizeof(text), displayCentiTemp(now.centiC), 2, 0);
+  graphTempText.draw(text, 2, 20);
+  strcpy(text, "H ");
+  formatFixed(text + 2, sizeof(text) - 2, displayCentiTemp(day.max.centiC), 2, 0);
+  graphTempHigh.draw(text, 2, 44);
+  strcpy(text, "L ");
+  formatFixed(text + 2, sizeof(text) - 2, displayCentiTemp(day.min.centiC), 2, 0);
+  graphTempLow.draw(text, 2, 56);
+  formatTrend(text, sizeof(text), displayCentiTempDelta(hour.trendPerHour.centiC));
+  graphTempTrend.draw(text, 2, 68);
+
+  formatFixed(text, sizeof(text), now.centiRh, 2, 0);
+  graphHumText.draw(text, 2, 140);
+  strcpy(text, "H ");
+  formatFixed(text + 2, sizeof(text) - 2, day.max.centiRh, 2, 0);
+  graphHumHigh.draw(text, 2, 164);
+  strcpy(text, "L ");
+  formatFixed(text + 2, sizeof(text) - 2, day.min.centiRh, 2, 0);
+  graphHumLow.draw(text, 2, 176);
+  formatTrend(text, sizeof(text), hour.trendPerHour.centiRh);
+  graphHumTrend.draw(text, 2, 188);
+}
+
+// Indoor history: the whole graph once; displayScreenThreeUpdate() after that
+void displayScreenThree()
+{
+  MetricsRenderTimer timer(SCREEN_HISTORY);
+  tftTransport.fillRect(0, 0, SCREEN_W, SCREEN_H, ST77XX_BLACK);
+  tftTransport.fence();
+  graphTempText.invalidate();
+  graphTempHigh.invalidate();
+  graphTempLow.invalidate();
+  graphTempTrend.invalidate();
+  graphHumText.invalidate();
+  graphHumHigh.invalidate();
+  graphHumLow.invalidate();
+  graphHumTrend.invalidate();
+
+  tft.setTextSize(1);
+  tft.setTextColor(ST77XX_ORANGE);
+  tft.setCursor(2, 8);
+  tft.printf("TEMP%c%c", 247, cfg_useCelsius ? 'C' : 'F');  // 247 is degree symbol
+  tft.setTextColor(ST77XX_CYAN);
+  tft.setCursor(2, 128);
+  tft.print("HUM %");
+
+  historyGraph.draw(sensorHistory);
+  displayGraphValues();
+}
+
+// After a new sample: one column written, the rest scrolled by the panel
+void displayScreenThreeUpdate()
+{
+  MetricsRenderTimer timer(SCREEN_HISTORY);
+  historyGraph.update(sensorHistory);
+  displayGraphValues();
+}
+
+void displayCurrentScreen()
+{
+  historyGraph.end();  // Screens one and two draw unscrolled; three starts over
+  if (currentScreen == 1)
+  {
+    tft.fillScreen(ST77XX_BLACK);
+    screenOneDrawn = false;  // Redraw everything on the cleared screen
+    displayScreenOne();
+  }
+  else if (currentScreen == 2)
+  {
+    displayScreenTwo();
+  }
+  else
+  {
+    displayScreenThree();
+  }
+}
+
+// Show firmware update progress reported by the network task. Returns true
+// while an update message owns the screen.
+bool displayOtaStatus()
+{
+  uint8_t status = otaStatus.load();
+  if (status != otaStatusShown)
+  {
+    otaStatusShown = status;
+    if (status == OTA_UPDATING)
+    {
+      displayCenteredText("Updating firmware...", ST77XX_CYAN);
+    }
+    else if (status == OTA_FAILED)
+    {
+      displayCenteredText("Update failed", ST77XX_RED);
+    }
+    else
+    {
+      displayCurrentScreen();
+    }
+  }
+  return status != OTA_IDLE;
+}
+
+// Take over a forecast the network task published since the last call
+void applyForecastUpdate()
+{
+  if (forecastShared.version() == forecastSeenVersion)
+  {
+    return;
+  }
+
+  ForecastSnapshot snapshot;
+  uint32_t version;
+  if (!forecastShared.read(snapshot, version))
+  {
+    return;  // Caught it mid-write, try again next pass
+  }
+  forecastSeenVersion = version;
+  memcpy(forecast, snapshot.days, sizeof(forecast));
+  forecastFetchedAt = snapshot.fetchedAt;
+  forecastValid = true;
+
+  // Render the forecast screen now rather than on the next touch
+  updateScreenTwoCache();
+  if (currentScreen == 2 && lightsEnabled && otaStatusShown == OTA_IDLE)
+  {
+    displayScreenTwo();
+  }
+}
+
 // =============================================================================
 // OTA UPDATE FUNCTIONS
 // =============================================================================
 
 // OTA Update URLs (GitHub Releases)
+const char* OTA_HOST = "github.com";
 const char* OTA_VERSION_URL = "https://github.com/carsonxyz/weather-satellite/releases/latest/download/version.txt";
+const char* OTA_MANIFEST_URL = "https://github.com/carsonxyz/weather-satellite/releases/latest/download/firmware.sha256";
 const char* OTA_FIRMWARE_URL = "https://github.com/carsonxyz/weather-satellite/releases/latest/download/firmware.bin";
+const char* OTA_FIRMWARE_GZ_URL = "https://github.com/carsonxyz/weather-satellite/releases/latest/download/firmware.bin.gz";
+const char* OTA_DELTA_URL_PREFIX = "https://github.com/carsonxyz/weather-satellite/releases/latest/download/delta-";  // + running version + ".bin"
 const int OTA_TIMEOUT_MS = 30000;  // 30 second timeout for downloads
 
 // Parse semantic version string "major.minor.patch" into components
@@ -800,15 +1572,144 @@ int compareVersions(const char* v1, const char* v2)
   return 0;
 }
 
+// GET a release file over its own TLS connection (GitHub redirects to its CDN)
+int getReleaseFile(WiFiClientSecure &client, HTTPClient &http, const String &url, const char *what,
+                   HttpEndpoint endpoint)
+{
+  Serial.printf("Fetching %s from: %s\n", what, url.c_str());
+  if (!connectTls(client, OTA_HOST, 443, what))
+  {
+    metricsHttp(endpoint, HTTPC_ERROR_CONNECTION_REFUSED, 0, -1);
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  http.setTimeout(OTA_TIMEOUT_MS);
+  http.begin(client, url);
+  http.useHTTP10(true);  // A plain Content-Length body, streamed straight to flash
+  uint32_t requestUs = micros();
+  int httpCode = http.GET();
+  metricsHttp(endpoint, httpCode, micros() - requestUs, http.getSize());
+  return httpCode;
+}
+
+// The SHA-256 of the release's firmware.bin, from its sha256sum manifest.
+// Without it nothing is installed.
+bool fetchManifest(uint8_t sha[SHA256_SIZE])
+{
+  WiFiClientSecure client;
+  HTTPClient http;
+  int httpCode = getReleaseFile(client, http, OTA_MANIFEST_URL, "manifest", ENDPOINT_OTA_MANIFEST);
+  bool ok = (httpCode == HTTP_CODE_OK) && otaParseSha256(http.getString(), sha);
+  if (!ok)
+  {
+    Serial.printf("No usable manifest (HTTP code: %d)\n", httpCode);
+  }
+  http.end();
+  return ok;
+}
+
+// Apply the release's patch from the running version (tools/ota_delta.py), a
+// fraction of the full image for a small change. True once it is the boot
+// partition; false if the release has no patch for this version or it didn't
+// apply, and the full image is the way.
+bool tryDeltaUpdate(const uint8_t sha[SHA256_SIZE])
+{
+  WiFiClientSecure client;
+  HTTPClient http;
+  String url = String(OTA_DELTA_URL_PREFIX) + FIRMWARE_VERSION + ".bin";
+  int httpCode = getReleaseFile(client, http, url, "delta update", ENDPOINT_OTA_DELTA);
+
+  bool applied = false;
+  if (httpCode == HTTP_CODE_OK && http.getSize() > 0)
+  {
+    applied = deltaOtaApply(http.getStream(), http.getSize(), sha);
+  }
+  else if (httpCode == HTTP_CODE_NOT_FOUND)
+  {
+    Serial.printf("No delta from %s in this release\n", FIRMWARE_VERSION);
+  }
+  else
+  {
+    Serial.printf("Failed to fetch delta. HTTP code: %d\n", httpCode);
+  }
+  http.end();
+  return applied;
+}
+
+// Download the full image into the next OTA partition: gzipped and inflated
+// on the way if the release has firmware.bin.gz, else firmware.bin as is.
+// True once it is the boot partition.
+bool downloadFullImage(const uint8_t sha[SHA256_SIZE])
+{
+  WiFiClientSecure client;
+  HTTPClient http;
+  uint32_t startMs = millis();
+  bool compressed = true;
+  int httpCode = getReleaseFile(client, http, OTA_FIRMWARE_GZ_URL, "compressed image", ENDPOINT_OTA_IMAGE);
+  if (httpCode == HTTP_CODE_NOT_FOUND)
+  {
+    http.end();
+    compressed = false;
+    httpCode = getReleaseFile(client, http, OTA_FIRMWARE_URL, "image", ENDPOINT_OTA_IMAGE);
+  }
+  int size = http.getSize();
+  if (httpCode != HTTP_CODE_OK || size <= 0)
+  {
+    Serial.printf("Failed to fetch firmware. HTTP code: %d\n", httpCode);
+    http.end();
+    return false;
+  }
+
+  OtaImageWriter writer;
+  const char *error = nullptr;
+  if (!writer.begin(compressed ? 0 : size))  // The inflated size isn't known up front
+  {
+    error = writer.error();
+  }
+  else if (compressed)
+  {
+    GzipInflater inflater(http.getStream(), size);
+    if (!inflater.inflateTo(writer))
+    {
+      error = writer.error() ? writer.error() : inflater.error();
+    }
+  }
+  else
+  {
+    uint8_t buffer[512];
+    for (int left = size; left > 0 && !error;)
+    {
+      size_t got = http.getStream().readBytes((char *)buffer, min(left, (int)sizeof(buffer)));
+      if (got == 0 || writer.write(buffer, got) != got)
+      {
+        error = writer.error() ? writer.error() : "download broke off";
+      }
+      left -= got;
+    }
+  }
+  http.end();
+
+  if (!error && !writer.finish(sha))
+  {
+    error = writer.error();
+  }
+  if (error)
+  {
+    Serial.printf("Firmware update failed: %s\n", error);
+    return false;
+  }
+  Serial.printf("Wrote a %u byte image from %d bytes downloaded in %lu ms\n", (unsigned)writer.written(), size,
+                (unsigned long)(millis() - startMs));
+  return true;
+}
+
 // Check for and perform OTA firmware updates
-// Call this after WiFi is connected
+// Runs on the network task after WiFi is connected; progress goes to otaStatus
 void checkForUpdates()
 {
   Serial.println("\n--- Checking for Firmware Updates ---");
   Serial.printf("Current firmware version: %s\n", FIRMWARE_VERSION);
 
-  displayCenteredText("Checking for updates...", ST77XX_CYAN);
-
   if (WiFi.status() != WL_CONNECTED)
   {
     Serial.println("WiFi not connected, skipping update check");
@@ -819,6 +1720,16 @@ void checkForUpdates()
   // This should be called after the firmware has been verified to work
   esp_ota_mark_app_valid_cancel_rollback();
 
+  // A different host, and a download needs the heap the open session holds
+  accuWeatherConnection().stop();
+
+  WiFiClientSecure versionClient;
+  if (!connectTls(versionClient, OTA_HOST, 443, "update check"))
+  {
+    metricsHttp(ENDPOINT_OTA_VERSION, HTTPC_ERROR_CONNECTION_REFUSED, 0, -1);
+    Serial.println("Update check failed, continuing with current firmware");
+    return;
+  }
   HTTPClient http;
 
   // Configure for HTTPS with GitHub
@@ -828,9 +1739,11 @@ void checkForUpdates()
 
   // Fetch version.txt from GitHub releases
   Serial.printf("Fetching version from: %s\n", OTA_VERSION_URL);
-  http.begin(OTA_VERSION_URL);
+  http.begin(versionClient, OTA_VERSION_URL);
 
+  uint32_t requestUs = micros();
   int httpCode = http.GET();
+  metricsHttp(ENDPOINT_OTA_VERSION, httpCode, micros() - requestUs, http.getSize());
 
   if (httpCode != HTTP_CODE_OK)
   {
@@ -859,73 +1772,104 @@ void checkForUpdates()
   // Remote version is newer - perform update
   Serial.printf("New version available: %s -> %s\n", FIRMWARE_VERSION, remoteVersion.c_str());
 
-  displayCenteredText("Updating firmware...", ST77XX_CYAN);
+  uint8_t sha[SHA256_SIZE];
+  if (!fetchManifest(sha))
+  {
+    Serial.println("Update check failed, continuing with current firmware");
+    return;
+  }
 
-  Serial.printf("Downloading firmware from: %s\n", OTA_FIRMWARE_URL);
+  otaStatus = OTA_UPDATING;
+  notifyLoop();
 
-  // Configure HTTPUpdate
-  httpUpdate.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+  // Every path checks the image against the manifest before it can boot
+  if (tryDeltaUpdate(sha) || downloadFullImage(sha))
+  {
+    Serial.println("Update successful! Rebooting...");
+    ESP.restart();
+  }
 
-  // Create WiFiClient for HTTP (GitHub redirects to objects.githubusercontent.com)
-  WiFiClientSecure client;
-  client.setInsecure();  // Skip certificate verification
-  // NOTE: For production, you should add proper certificate validation:
-  // client.setCACert(github_root_ca);
+  Serial.println("Update failed, continuing with current firmware");
+  otaStatus = OTA_FAILED;
+  notifyLoop();
+  delay(3000);
+  otaStatus = OTA_IDLE;
+  notifyLoop();
 
-  // Perform the update
-  t_httpUpdate_return ret = httpUpdate.update(client, OTA_FIRMWARE_URL);
+  Serial.println("--- Update Check Complete ---\n");
+}
 
-  switch (ret)
+// Runs on the Arduino event task; stamps the boot trace and wakes loop() so
+// the link supervisor sees the change straight away
+void onWiFiEvent(arduino_event_id_t event)
+{
+  if (event == ARDUINO_EVENT_WIFI_STA_CONNECTED)
   {
-    case HTTP_UPDATE_FAILED:
-      Serial.printf("Update failed. Error (%d): %s\n",
-                    httpUpdate.getLastError(),
-                    httpUpdate.getLastErrorString().c_str());
-      displayCenteredText("Update failed", ST77XX_RED);
-      delay(3000);
-      break;
-
-    case HTTP_UPDATE_NO_UPDATES:
-      Serial.println("No update available");
-      break;
-
-    case HTTP_UPDATE_OK:
-      Serial.println("Update successful! Rebooting...");
-      // Device will reboot automatically after successful update
-      break;
+    wifiAssociatedUs = bootTraceNow();
+    bootTraceSpan(PHASE_WIFI_ASSOCIATE, wifiBeginUs, wifiAssociatedUs, "station");
+  }
+  else if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP)
+  {
+    bootTraceSpan(PHASE_DHCP, wifiAssociatedUs, "station");
+    notifyLoop();
+  }
+  else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED)
+  {
+    notifyLoop();
   }
-
-  Serial.println("--- Update Check Complete ---\n");
 }
 
-void connectToWiFi()
+// Start associating; loop() supervises the link from here and the network
+// task picks up the result in waitForWiFi(), while setup() carries on with
+// the sensor and the first frame
+void startWiFi()
 {
-  displayCenteredText("Connecting to Earth...", ST77XX_CYAN);
   Serial.printf("Connecting to WiFi: %s\n", cfg_wifiSsid.c_str());
+  wifiBeginUs = bootTraceNow();
+  wifiLink.begin(cfg_wifiSsid.c_str(), cfg_wifiPassword.c_str(), WIFI_REUSE_LEASE);
+}
 
-  WiFi.begin(cfg_wifiSsid.c_str(), cfg_wifiPassword.c_str());
-
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20)
+// loop(): the link came up or went down. The network task hears about a
+// connection, so whatever it skipped while the link was down happens now.
+// The first connection also arms the alloc guard: up to here loop() is still
+// finishing the boot, from here on it must not allocate.
+void handleLinkChange()
+{
+  if (wifiLink.state() != LINK_UP)
   {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+    return;
   }
-  Serial.println();
-
-  if (WiFi.status() == WL_CONNECTED)
+  if (!allocGuardArmed)
   {
-    displayCenteredText("Connected to Earth", ST77XX_CYAN);
-    Serial.printf("Connected! IP: %s\n", WiFi.localIP().toString().c_str());
+    allocGuardBegin();
+    allocGuardArmed = true;
   }
-  else
+  metricsWiFiConnected();
+  IPAddress ip = WiFi.localIP();  // Octets, not toString(): that builds a String
+  Serial.printf("Connected in %lu ms%s! IP: %u.%u.%u.%u\n", (unsigned long)wifiLink.connectMs(),
+                wifiLink.connectedDirect() ? " (saved AP)" : "", ip[0], ip[1], ip[2], ip[3]);
+
+  // Modem sleep: the radio wakes for DTIM beacons only, which keeps the
+  // association and lets the chip light-sleep in between
+  WiFi.setSleep(true);
+  if (networkTaskHandle)
   {
-    displayCenteredText("Could not connect to Earth", ST77XX_CYAN);
-    Serial.println("WiFi connection failed");
+    xTaskNotifyGive(networkTaskHandle);
   }
+}
 
-  delay(2000);
+// Network task: until loop()'s supervisor has the first connection or has
+// given up on it. Takes the notification a connection sends.
+void waitForWiFi()
+{
+  while (wifiLink.state() == LINK_CONNECTING)
+  {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+  }
+  if (wifiLink.state() != LINK_UP)
+  {
+    Serial.println("WiFi not up, carrying on without it for now");
+  }
 }
 
 void fetchAccuWeatherLocation()
@@ -938,35 +1882,67 @@ void fetchAccuWeatherLocation()
 
   Serial.println("\n--- Fetching AccuWeather Location Data ---");
 
+  if (!connectAccuWeather("location"))
+  {
+    metricsHttp(ENDPOINT_LOCATION, HTTPC_ERROR_CONNECTION_REFUSED, 0, -1);
+    return;
+  }
   HTTPClient http;
 
   // Build the AccuWeather Location API URL
-  String url = "https://dataservice.accuweather.com/locations/v1/postalcodes/search?q=";
+  String url = weatherServer.url + "/locations/v1/postalcodes/search?q=";
   url += urlEncode(cfg_postalCode);
   url += "&countryCode=";
   url += cfg_countryCode;
 
   Serial.printf("Request URL: %s\n", url.c_str());
 
-  http.begin(url);
+  http.begin(accuWeatherConnection(), url);
+  http.useHTTP10(true);  // No chunked encoding, so the body can be parsed straight off the socket
+  http.setReuse(true);   // useHTTP10() turns keep-alive off; a 1.0 response with a length can keep it
   http.addHeader("Accept", "application/json");
-  http.addHeader("Authorization", String("Bearer ") + ACCUWEATHER_API_KEY_STR);
+  addApiKeyHeader(http);
+  httpCacheCollectHeaders(http);
+  bool haveLocation = (LOCATION_KEY.length() > 0);
+  if (haveLocation)
+  {
+    httpCacheAddValidators(http, locationHttpCache);  // Revalidating what we hold
+  }
 
+  logHeap("Heap before location request");
+  uint32_t requestUs = bootTraceNow();
   int httpCode = http.GET();
+  bootTraceSpan(PHASE_HTTP_FIRST_BYTE, requestUs, "location");
+  metricsHttp(ENDPOINT_LOCATION, httpCode, bootTraceNow() - requestUs, http.getSize());
 
   if (httpCode > 0)
   {
     Serial.printf("HTTP Response Code: %d\n", httpCode);
-    String payload = http.getString();
+    HttpCacheEntry cacheEntry = locationHttpCache;  // Taken over once the response is used
+    httpCacheUpdate(cacheEntry, http, httpCode, clockIsSet() ? (uint32_t)time(nullptr) : 0);
 
-    if (httpCode == HTTP_CODE_OK)
+    if (httpCode == HTTP_CODE_NOT_MODIFIED && haveLocation)
     {
-      Serial.println("AccuWeather Response:");
-      Serial.println(payload);
+      Serial.println("Location not modified, keeping the cached one");
+      locationHttpCache = cacheEntry;
+      saveCachedLocation();  // Restamps it, so the TTL starts over
+    }
+    else if (httpCode == HTTP_CODE_OK)
+    {
+      // Keep only the fields we use; everything else is skipped while streaming
+      JsonDocument filter;
+      filter[0]["Key"] = true;
+      filter[0]["TimeZone"]["Name"] = true;
+      filter[0]["TimeZone"]["GmtOffset"] = true;
+      filter[0]["TimeZone"]["IsDaylightSaving"] = true;
+      filter[0]["TimeZone"]["NextOffsetChange"] = true;
 
-      // Parse JSON response
       JsonDocument doc;
-      DeserializationError error = deserializeJson(doc, payload);
+      uint32_t parseUs = bootTraceNow();
+      DeserializationError error = deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter));
+      bootTraceSpan(PHASE_JSON_PARSE, parseUs, "location");
+      metricsJsonParse(ENDPOINT_LOCATION, bootTraceNow() - parseUs);
+      logHeap("Heap after location parse");
 
       if (error)
       {
@@ -983,11 +1959,15 @@ void fetchAccuWeatherLocation()
           TIME_ZONE = location["TimeZone"]["Name"].as<String>();
           GMT_OFFSET_HOURS = location["TimeZone"]["GmtOffset"].as<float>();
           IS_DST = location["TimeZone"]["IsDaylightSaving"].as<bool>();
+          locationNextOffsetChange = parseUtcTimestamp(location["TimeZone"]["NextOffsetChange"] | "");
 
           Serial.printf("Location Key: %s\n", LOCATION_KEY.c_str());
           Serial.printf("Time Zone: %s\n", TIME_ZONE.c_str());
           Serial.printf("GMT Offset: %.1f hours\n", GMT_OFFSET_HOURS);
           Serial.printf("Daylight Saving: %s\n", IS_DST ? "Yes" : "No");
+
+          locationHttpCache = cacheEntry;
+          saveCachedLocation();
         }
         else
         {
@@ -998,7 +1978,7 @@ void fetchAccuWeatherLocation()
     else
     {
       Serial.println("AccuWeather Error Response:");
-      Serial.println(payload);
+      Serial.println(http.getString());
     }
   }
   else
@@ -1007,15 +1987,25 @@ void fetchAccuWeatherLocation()
   }
 
   http.end();
+  releaseAccuWeather(httpCode);
   Serial.println("--- AccuWeather Fetch Complete ---\n");
 }
 
-void syncTimeWithNTP()
+// Runs on the SNTP task when the clock is first set
+void onTimeSynced(struct timeval *tv)
+{
+  (void)tv;
+  bootTraceSpan(PHASE_NTP, timeSyncStartUs, "sntp");
+}
+
+// Point SNTP at the location's offset. The sync runs in the background from
+// here; waitForTimeSync() collects the result.
+bool startTimeSync()
 {
   if (TIME_ZONE.length() == 0)
   {
     Serial.println("No timezone set, skipping NTP sync");
-    return;
+    return false;
   }
 
   Serial.println("\n--- Syncing Time with NTP ---");
@@ -1031,13 +2021,18 @@ void syncTimeWithNTP()
 
   // Configure NTP with timezone offset
   // Using pool.ntp.org as the NTP server
+  timeSyncStartUs = bootTraceNow();
   configTime(gmtOffsetSec, daylightOffsetSec, "pool.ntp.org", "time.nist.gov");
+  return true;
+}
 
+void waitForTimeSync()
+{
   // Wait for time to be set
   Serial.print("Waiting for NTP time sync");
   int attempts = 0;
   struct tm timeinfo;
-  while (!getLocalTime(&timeinfo) && attempts < 10)
+  while (!getLocalTime(&timeinfo, 0) && attempts < 10)
   {
     Serial.print(".");
     delay(500);
@@ -1045,7 +2040,7 @@ void syncTimeWithNTP()
   }
   Serial.println();
 
-  if (getLocalTime(&timeinfo))
+  if (getLocalTime(&timeinfo, 0))
   {
     Serial.println("Time synchronized!");
     Serial.printf("Current time: %04d-%02d-%02d %02d:%02d:%02d\n",
@@ -1064,6 +2059,132 @@ void syncTimeWithNTP()
   Serial.println("--- NTP Sync Complete ---\n");
 }
 
+void syncTimeWithNTP()
+{
+  if (startTimeSync())
+  {
+    waitForTimeSync();
+  }
+}
+
+// Refresh the cached location once it expires or its GMT offset goes stale
+// (DST switch). Runs on the network task, checked every NETWORK_CHECK_INTERVAL.
+// Returns true if the location key changed.
+bool revalidateLocation()
+{
+  if (locationChecked && (millis() - lastLocationCheck < LOCATION_CHECK_INTERVAL))
+  {
+    return false;
+  }
+  if (WiFi.status() != WL_CONNECTED)
+  {
+    return false;
+  }
+
+  // With a location we need the wall clock to judge its age
+  bool haveLocation = (LOCATION_KEY.length() > 0);
+  if (haveLocation && !clockIsSet())
+  {
+    return false;
+  }
+
+  locationChecked = true;
+  lastLocationCheck = millis();
+
+  if (haveLocation)
+  {
+    uint32_t now = (uint32_t)time(nullptr);
+    if (locationSavedAt == 0)
+    {
+      saveCachedLocation();  // Fetched before NTP sync, stamp it now
+    }
+
+    bool expired = (now - locationSavedAt >= LOCATION_CACHE_TTL);
+    bool offsetChanged = (locationNextOffsetChange != 0 && now >= locationNextOffsetChange);
+    if (!expired && !offsetChanged)
+    {
+      return false;
+    }
+    Serial.printf("Cached location %s, revalidating\n", expired ? "expired" : "is past a GMT offset change");
+  }
+
+  String oldKey = LOCATION_KEY;
+  float oldOffset = GMT_OFFSET_HOURS;
+  fetchAccuWeatherLocation();
+
+  if (!haveLocation || GMT_OFFSET_HOURS != oldOffset)
+  {
+    syncTimeWithNTP();
+  }
+  if (LOCATION_KEY == oldKey)
+  {
+    return false;
+  }
+  forecastFetched = false;  // Forecast belongs to the old location
+  httpCacheClear(forecastHttpCache);
+  return true;
+}
+
+// Whether the forecast we hold is current: by the response's own lifetime if
+// it gave one, FORECAST_REFRESH_INTERVAL otherwise
+bool forecastIsFresh()
+{
+  if (!forecastFetched)
+  {
+    return false;
+  }
+  unsigned long age = millis() - lastForecastFetch;
+  if (age < FORECAST_MIN_REFRESH_INTERVAL)
+  {
+    return true;
+  }
+  if (forecastHttpCache.expiresAt != 0 && clockIsSet())
+  {
+    return httpCacheFresh(forecastHttpCache, (uint32_t)time(nullptr));
+  }
+  return age < FORECAST_REFRESH_INTERVAL;
+}
+
+// Hand a fetched (or revalidated) forecast to the UI in one go, and save it
+void publishForecast(ForecastSnapshot &snapshot)
+{
+  snapshot.fetchedAt = clockIsSet() ? (uint32_t)time(nullptr) : 0;
+  forecastShared.write(snapshot);
+  notifyLoop();
+  forecastFetched = true;
+  lastForecastFetch = millis();
+  saveCachedForecast(snapshot);
+}
+
+// Forecast response formats, most preferred first. MessagePack comes from a
+// compatible server (our proxy, test/replay_server): fewer bytes over the
+// radio and no number text to parse. AccuWeather ignores it and sends JSON.
+const char *FORECAST_ACCEPT = "application/msgpack, application/json;q=0.9";
+
+bool isMsgPack(const String &contentType)
+{
+  return contentType.startsWith("application/msgpack") || contentType.startsWith("application/x-msgpack") ||
+         contentType.startsWith("application/vnd.msgpack");
+}
+
+// Parse a forecast body in either format, keeping only the fields we display
+// (a filter applies to every array element, so all five days are kept but
+// each is only a few values). The simulator's --bench-forecast times it too.
+DeserializationError parseForecast(JsonDocument &doc, Stream &body, bool msgpack)
+{
+  JsonDocument filter;
+  filter["DailyForecasts"][0]["Date"] = true;
+  filter["DailyForecasts"][0]["Day"]["Icon"] = true;
+  filter["DailyForecasts"][0]["Temperature"]["Minimum"]["Value"] = true;
+  filter["DailyForecasts"][0]["Temperature"]["Maximum"]["Value"] = true;
+
+  if (msgpack)
+  {
+    return deserializeMsgPack(doc, body, DeserializationOption::Filter(filter));
+  }
+  return deserializeJson(doc, body, DeserializationOption::Filter(filter));
+}
+
 void fetchForecast()
 {
   if (WiFi.status() != WL_CONNECTED)
@@ -1078,8 +2199,7 @@ void fetchForecast()
     return;
   }
 
-  // Check if we need to refresh (every hour)
-  if (forecastValid && (millis() - lastForecastFetch < FORECAST_REFRESH_INTERVAL))
+  if (forecastIsFresh())
   {
     Serial.println("Forecast still fresh, skipping fetch");
     return;
@@ -1087,60 +2207,92 @@ void fetchForecast()
 
   Serial.println("\n--- Fetching 5-Day Forecast ---");
 
+  if (!connectAccuWeather("forecast"))
+  {
+    metricsHttp(ENDPOINT_FORECAST, HTTPC_ERROR_CONNECTION_REFUSED, 0, -1);
+    return;
+  }
   HTTPClient http;
 
   // Build the AccuWeather Forecast API URL
-  String url = "https://dataservice.accuweather.com/forecasts/v1/daily/5day/";
+  String url = weatherServer.url + "/forecasts/v1/daily/5day/";
   url += LOCATION_KEY;
 
   Serial.printf("Request URL: %s\n", url.c_str());
 
-  http.begin(url);
-  http.addHeader("Accept", "application/json");
-  http.addHeader("Authorization", String("Bearer ") + ACCUWEATHER_API_KEY_STR);
+  http.begin(accuWeatherConnection(), url);
+  http.useHTTP10(true);  // No chunked encoding, so the body can be parsed straight off the socket
+  http.setReuse(true);   // useHTTP10() turns keep-alive off; a 1.0 response with a length can keep it
+  http.addHeader("Accept", FORECAST_ACCEPT);
+  addApiKeyHeader(http);
+  httpCacheCollectHeaders(http);
+  if (forecastFetched)
+  {
+    httpCacheAddValidators(http, forecastHttpCache);  // forecastShared holds what they describe
+  }
 
+  logHeap("Heap before forecast request");
+  uint32_t requestUs = bootTraceNow();
   int httpCode = http.GET();
+  bootTraceSpan(PHASE_HTTP_FIRST_BYTE, requestUs, "forecast");
+  metricsHttp(ENDPOINT_FORECAST, httpCode, bootTraceNow() - requestUs, http.getSize());
 
   if (httpCode > 0)
   {
     Serial.printf("HTTP Response Code: %d\n", httpCode);
-    String payload = http.getString();
+    HttpCacheEntry cacheEntry = forecastHttpCache;  // Taken over once the response is used
+    httpCacheUpdate(cacheEntry, http, httpCode, clockIsSet() ? (uint32_t)time(nullptr) : 0);
 
-    if (httpCode == HTTP_CODE_OK)
+    if (httpCode == HTTP_CODE_NOT_MODIFIED && forecastFetched)
+    {
+      // Nothing to parse: what we hold is current, as of now
+      Serial.println("Forecast not modified, keeping it");
+      ForecastSnapshot snapshot;
+      uint32_t version;
+      forecastShared.read(snapshot, version);  // Only this task writes it, so it can't fail
+      forecastHttpCache = cacheEntry;
+      publishForecast(snapshot);
+    }
+    else if (httpCode == HTTP_CODE_OK)
     {
-      Serial.println("Forecast received, parsing...");
+      bool msgpack = isMsgPack(http.header("Content-Type"));
+      Serial.printf("Forecast received (%s, %d bytes), parsing...\n", msgpack ? "MessagePack" : "JSON",
+                    http.getSize());
 
-      // Parse JSON response
       JsonDocument doc;
-      DeserializationError error = deserializeJson(doc, payload);
+      uint32_t parseUs = bootTraceNow();
+      DeserializationError error = parseForecast(doc, http.getStream(), msgpack);
+      bootTraceSpan(PHASE_JSON_PARSE, parseUs, "forecast");
+      metricsJsonParse(ENDPOINT_FORECAST, bootTraceNow() - parseUs);
+      logHeap("Heap after forecast parse");
 
       if (error)
       {
-        Serial.printf("JSON parsing failed: %s\n", error.c_str());
+        Serial.printf("Forecast parsing failed: %s\n", error.c_str());
       }
       else
       {
         JsonArray dailyForecasts = doc["DailyForecasts"];
+        ForecastSnapshot snapshot = {};
         
         // Get first 3 days
-        for (int i = 0; i < 3 && i < dailyForecasts.size(); i++)
+        for (size_t i = 0; i < 3 && i < dailyForecasts.size(); i++)
         {
           JsonObject day = dailyForecasts[i];
+          DayForecast &out = snapshot.days[i];
           
           // Get day icon number (use Day icon, not Night)
-          forecast[i].iconNum = day["Day"]["Icon"].as<int>();
+          out.iconNum = day["Day"]["Icon"].as<int>();
           
           // Get high/low temps (already in Fahrenheit from API)
-          forecast[i].highTemp = (int)round(day["Temperature"]["Maximum"]["Value"].as<float>());
-          forecast[i].lowTemp = (int)round(day["Temperature"]["Minimum"]["Value"].as<float>());
+          out.highTemp = (int)round(day["Temperature"]["Maximum"]["Value"].as<float>());
+          out.lowTemp = (int)round(day["Temperature"]["Minimum"]["Value"].as<float>());
           
           // Parse date to get day name
-          String dateStr = day["Date"].as<String>();
           // Date format: "2024-01-15T07:00:00-05:00"
-          // Extract year, month, day
-          int year = dateStr.substring(0, 4).toInt();
-          int month = dateStr.substring(5, 7).toInt();
-          int dayNum = dateStr.substring(8, 10).toInt();
+          const char* dateStr = day["Date"] | "";
+          int year = 0, month = 0, dayNum = 0;
+          sscanf(dateStr, "%4d-%2d-%2d", &year, &month, &dayNum);
           
           // Calculate day of week using Zeller's formula (simplified)
           struct tm tm = {0};
@@ -1150,22 +2302,22 @@ void fetchForecast()
           mktime(&tm);
           
           const char* dayNames[] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
-          forecast[i].dayName = String(dayNames[tm.tm_wday]);
+          strcpy(out.dayName, dayNames[tm.tm_wday]);
           
-          Serial.printf("Day %d: %s - Icon:%d High:%d Low:%d\n", 
-                        i, forecast[i].dayName.c_str(), 
-                        forecast[i].iconNum, forecast[i].highTemp, forecast[i].lowTemp);
+          Serial.printf("Day %u: %s - Icon:%d High:%d Low:%d\n", 
+                        (unsigned)i, out.dayName, 
+                        out.iconNum, out.highTemp, out.lowTemp);
         }
         
-        forecastValid = true;
-        lastForecastFetch = millis();
+        forecastHttpCache = cacheEntry;
+        publishForecast(snapshot);
         Serial.println("Forecast parsed successfully!");
       }
     }
     else
     {
       Serial.println("AccuWeather Forecast Error:");
-      Serial.println(payload);
+      Serial.println(http.getString());
     }
   }
   else
@@ -1174,15 +2326,220 @@ void fetchForecast()
   }
 
   http.end();
+  releaseAccuWeather(httpCode);
   Serial.println("--- Forecast Fetch Complete ---\n");
 }
 
+// A forecast restored from NVS counts as fetched when it was, so
+// fetchForecast() only asks again once it is due, and then conditionally.
+// Needs the clock.
+void adoptCachedForecast()
+{
+  if (forecastRestoredAt == 0 || !clockIsSet())
+  {
+    return;
+  }
+  uint32_t age = (uint32_t)time(nullptr) - forecastRestoredAt;
+  if (age > FORECAST_REFRESH_INTERVAL / 1000)
+  {
+    age = FORECAST_REFRESH_INTERVAL / 1000;  // Due either way; also covers a record from the future
+  }
+
+  forecastFetched = true;
+  lastForecastFetch = millis() - age * 1000UL;  // Wraps harmlessly early in uptime
+}
+
+// A forecast fetched before NTP synced gets its fetch time, and is saved, once
+// the clock is set
+void completePendingForecastSave()
+{
+  if (!forecastSavePending || !clockIsSet())
+  {
+    return;
+  }
+
+  ForecastSnapshot snapshot;
+  uint32_t version;
+  if (!forecastShared.read(snapshot, version))
+  {
+    return;  // Only this task writes it, so this doesn't happen
+  }
+  snapshot.fetchedAt = (uint32_t)time(nullptr) - (millis() - lastForecastFetch) / 1000;
+  forecastShared.write(snapshot);
+  notifyLoop();
+  saveCachedForecast(snapshot);
+}
+
+// =============================================================================
+// STATUS SERVER
+// =============================================================================
+// Diagnostics over HTTP on the local network once the station is up. Requests
+// are served on their own task, so loop() can keep sleeping.
+
+void handleBootReport()
+{
+  server.send(200, "text/plain", bootTraceReport());
+}
+
+void handleMetrics()
+{
+  server.send(200, "text/plain; version=0.0.4", metricsReport(FIRMWARE_VERSION, tft.bytesSent()));
+}
+
+void webTask(void *param)
+{
+  (void)param;
+
+  server.on("/boot", HTTP_GET, handleBootReport);
+  server.on("/metrics", HTTP_GET, handleMetrics);
+  server.begin();
+  Serial.printf("Status server: http://%s/boot and /metrics\n", WiFi.localIP().toString().c_str());
+
+  for (;;)
+  {
+    server.handleClient();
+    delay(WEB_POLL_INTERVAL);
+  }
+}
+
+// Network task: the server starts with the first connection and keeps
+// running across reconnects
+void startStatusServer()
+{
+  if (!webTaskHandle && wifiLink.state() == LINK_UP)
+  {
+    xTaskCreate(webTask, "web", WEB_TASK_STACK, nullptr, 1, &webTaskHandle);
+  }
+}
+
+// =============================================================================
+// NETWORK TASK
+// =============================================================================
+// Everything that waits on the network runs here, so a slow response can't
+// hold up the clock, touch or the light switch. This task never draws: the
+// forecast goes to loop() through forecastShared, update progress through
+// otaStatus.
+
+void networkTask(void *param)
+{
+  (void)param;
+
+  // Boot pipeline, in dependency order. setup() started the association and
+  // has already drawn screen one; the UI runs alongside all of this.
+  waitForWiFi();
+  wifiLink.saveAp();
+  startStatusServer();
+  if (LOCATION_KEY.length() == 0)
+  {
+    fetchAccuWeatherLocation();  // Only without a cached location
+  }
+  bool timeSyncing = startTimeSync();  // Needs the location's GMT offset
+  if (timeSyncing && forecastRestoredAt != 0)
+  {
+    waitForTimeSync();                 // Only the clock can tell if the restored forecast is fresh
+    timeSyncing = false;
+    adoptCachedForecast();
+  }
+  fetchForecast();                     // Needs the location key; SNTP runs meanwhile
+  if (timeSyncing)
+  {
+    waitForTimeSync();                 // Usually done by now
+  }
+  completePendingForecastSave();
+  bootTraceFinish();                   // Up; the update check isn't startup
+  checkForUpdates();                   // Last: it may download and reboot
+
+  for (;;)
+  {
+    // Sleep until the next check, until a touch asks for the forecast, until
+    // the link comes back, or until the AccuWeather connection has been idle
+    // long enough to close
+    uint32_t wait = NETWORK_CHECK_INTERVAL;
+    uint32_t untilIdleClose = closeIdleAccuWeather();
+    if (untilIdleClose > 0)
+    {
+      wait = min(wait, untilIdleClose);
+    }
+    bool forecastRequested = (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait)) > 0);
+
+    wifiLink.saveAp();    // If the link came up on a different AP
+    startStatusServer();  // If the link was down at boot
+    bool locationChanged = revalidateLocation();
+    if (forecastRequested || locationChanged)
+    {
+      fetchForecast();  // Skips itself while the forecast is still fresh
+    }
+    completePendingForecastSave();  // If NTP only synced now
+  }
+}
+
+// =============================================================================
+// IDLE
+// =============================================================================
+// loop() blocks here between events. With automatic light sleep the chip
+// sleeps for the whole wait; an input edge or a result from the network task
+// ends it early through the loop task's notification.
+
+uint32_t msUntil(unsigned long since, unsigned long interval)
+{
+  unsigned long elapsed = millis() - since;
+  return (elapsed >= interval) ? 0 : (uint32_t)(interval - elapsed);
+}
+
+// Sleep until the next deadline or event. The clock deadline only counts
+// while screen one is showing; nothing else needs a periodic wakeup.
+void waitForNextEvent(bool clockRunning)
+{
+  uint32_t wait = msUntil(lastWakeupReport, WAKEUP_REPORT_INTERVAL);
+  if (clockRunning)
+  {
+    wait = min(wait, msUntil(lastTimeUpdate, CLOCK_TICK_INTERVAL));
+  }
+  wait = min(wait, led.msUntilUpdate());
+  wait = min(wait, inputMsUntilSettled());
+  wait = min(wait, wifiLink.msUntilUpdate());
+  if (ahtFound)
+  {
+    wait = min(wait, msUntil(lastSensorRead, SENSOR_READ_INTERVAL));
+  }
+
+  uint32_t sleepUs = micros();
+  if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait)) > 0)
+  {
+    eventWakeups++;
+  }
+  else
+  {
+    timerWakeups++;
+    metricsLoopWake((int32_t)(micros() - sleepUs - wait * 1000));
+  }
+}
+
+void reportWakeups()
+{
+  unsigned long elapsed = millis() - lastWakeupReport;
+  if (elapsed < WAKEUP_REPORT_INTERVAL)
+  {
+    return;
+  }
+  char perMinute[12];
+  formatFixed(perMinute, sizeof(perMinute), (int32_t)((timerWakeups + eventWakeups) * 600000ULL / elapsed), 1, 1);
+  Serial.printf("Wakeups: %s/min (%u timer, %u event)\n", perMinute, (unsigned)timerWakeups,
+                (unsigned)eventWakeups);
+  timerWakeups = 0;
+  eventWakeups = 0;
+  lastWakeupReport = millis();
+}
+
 // =============================================================================
 // SETUP
 // =============================================================================
 
 void setup()
 {
+  uint32_t setupStartUs = bootTraceNow();
+  bootTraceBegin();
+
   Serial.begin(115200);
   delay(1000);
 
@@ -1211,7 +2568,9 @@ void setup()
   Serial.println("Initializing display...");
   SPI.begin(TFT_SCLK, -1, TFT_MOSI, TFT_CS);
   tft.init(240, 280);
+  tft.setSPISpeed(TFT_SPI_HZ);
   tft.setRotation(3); // Landscape: 280x240
+  tftTransport.begin(TFT_MOSI, TFT_SCLK, TFT_SPI_HZ);
   tft.fillScreen(ST77XX_BLACK);
   Serial.println("Display ready");
 
@@ -1237,11 +2596,11 @@ void setup()
     return;  // Exit setup, loop will handle captive portal
   }
 
-  // Normal boot - connect to WiFi
-  connectToWiFi();
-
-  // Check for OTA firmware updates after WiFi connection
-  checkForUpdates();
+  // Normal boot. WiFi associates in the background while the sensor comes up
+  // and the first frame is drawn; the network task then takes it from there.
+  WiFi.onEvent(onWiFiEvent);
+  sntp_set_time_sync_notification_cb(onTimeSynced);
+  startWiFi();
 
   // Initialize AHT10 sensor
   Serial.println("Initializing AHT10...");
@@ -1255,19 +2614,33 @@ void setup()
     Serial.println("AHT10 sensor not found");
   }
 
-  // Read initial switch state
+  // Read initial switch state; changes arrive as input events from here on
   lightsEnabled = (digitalRead(PIN_LIGHT_SW) == LOW);
   Serial.printf("Light switch: %s\n", lightsEnabled ? "ON" : "OFF");
-
-  // Fetch AccuWeather location data and sync time
-  fetchAccuWeatherLocation();
-  syncTimeWithNTP();
-  fetchForecast();
-
-  // Clear display and show initial screen
-  tft.fillScreen(ST77XX_BLACK);
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  inputBegin(loopTaskHandle);
+  powerEnableLightSleep();
+
+  // First frame: indoor readings now, link status until the clock is set.
+  // The screen is still black from display init.
+  sampleSensor();
+  screenOneDrawn = false;
   displayScreenOne();
+  bootTraceSpan(PHASE_FIRST_FRAME, 0, "screen one");
 
+  // Location and last forecast from the NVS cache if we have them; the network
+  // task looks the location up otherwise, then syncs time, fetches the forecast
+  // and checks for updates
+  if (USE_SCREEN_CACHE)
+  {
+    screenTwoCache.reserve(SCREEN_TWO_CACHE_RUNS);  // Rebuilds in loop() then stay off the heap
+  }
+  loadCachedLocation();
+  loadCachedForecast();
+  xTaskCreate(networkTask, "network", NETWORK_TASK_STACK, nullptr, 1, &networkTaskHandle);
+
+  lastWakeupReport = millis();
+  bootTraceSpan(PHASE_SETUP, setupStartUs);
   Serial.println("Setup complete\n");
 }
 
@@ -1285,11 +2658,27 @@ void loop()
     return;
   }
 
+  // --- WiFi link supervision (reconnects with backoff) ---
+  if (wifiLink.update())
+  {
+    handleLinkChange();
+  }
+
+  // --- Pick up results from the network task ---
+  bool otaActive = displayOtaStatus();
+  applyForecastUpdate();
+
+  // --- Indoor readings into the history ---
+  if (sampleSensor() && currentScreen == 3 && lightsEnabled && !otaActive)
+  {
+    displayScreenThreeUpdate();
+  }
+
   // --- Update display every second ---
-  if (millis() - lastTimeUpdate >= 1000)
+  if (millis() - lastTimeUpdate >= CLOCK_TICK_INTERVAL)
   {
     lastTimeUpdate = millis();
-    if (lightsEnabled)
+    if (lightsEnabled && !otaActive)
     {
       if (currentScreen == 1)
       {
@@ -1299,68 +2688,63 @@ void loop()
     }
   }
 
-  // --- Check light switch ---
-  bool switchState = digitalRead(PIN_LIGHT_SW);
-  bool newLightsEnabled = (switchState == LOW);
-
-  if (newLightsEnabled != lightsEnabled)
+  // --- Input events (captured by interrupt, debounced) ---
+  InputEvent event;
+  while (inputNextEvent(event))
   {
-    lightsEnabled = newLightsEnabled;
-    Serial.printf("Light switch changed: %s\n", lightsEnabled ? "ON" : "OFF");
-
-    if (lightsEnabled)
+    if (event.input == INPUT_LIGHT_SWITCH)
     {
-      analogWrite(PIN_BACKLIGHT, 255);
+      lightsEnabled = event.active;
+      Serial.printf("Light switch changed: %s\n", lightsEnabled ? "ON" : "OFF");
+
+      if (lightsEnabled)
+      {
+        analogWrite(PIN_BACKLIGHT, 255);
+        if (currentScreen == 3 && !otaActive)
+        {
+          displayScreenThreeUpdate();  // Catch up on samples taken while dark
+        }
+      }
+      else
+      {
+        analogWrite(PIN_BACKLIGHT, 0);
+        led.stop();
+      }
     }
-    else
+    else if (event.input == INPUT_TOUCH && event.active)
     {
-      analogWrite(PIN_BACKLIGHT, 0);
-      analogWrite(PIN_LED, 0);
-    }
-  }
-
-  // --- Check touch button ---
-  bool touchState = digitalRead(PIN_TOUCH);
+      Serial.printf("Touch detected (%lu ms ago)\n", millis() - event.atMs);
 
-  if (touchState == HIGH && lastTouchState == LOW && !touchHandled)
-  {
-    Serial.println("Touch detected");
-    touchHandled = true;
+      // Cycle through the screens
+      if (currentScreen == 1)
+      {
+        currentScreen = 2;
+        xTaskNotifyGive(networkTaskHandle);  // Refresh forecast in the background if needed
+      }
+      else if (currentScreen == 2)
+      {
+        currentScreen = 3;
+      }
+      else
+      {
+        currentScreen = 1;
+      }
+      if (!otaActive)
+      {
+        displayCurrentScreen();
+      }
 
-    // Toggle between screens
-    if (currentScreen == 1)
-    {
-      currentScreen = 2;
-      fetchForecast();  // Refresh forecast if needed when switching to screen 2
-      displayScreenTwo();
-    }
-    else
-    {
-      currentScreen = 1;
-      lastTimeStr = "";  // Force time redraw
-      tft.fillScreen(ST77XX_BLACK);
-      displayScreenOne();
-    }
-    
-    // Blink LED 3 times at 25% brightness (only if lights enabled)
-    if (lightsEnabled)
-    {
-      for (int i = 0; i < 3; i++)
+      // Blink LED 3 times at 25% brightness (only if lights enabled)
+      if (lightsEnabled)
       {
-        analogWrite(PIN_LED, 64);  // 25% brightness
-        delay(100);
-        analogWrite(PIN_LED, 0);
-        delay(250);
+        led.blink(3, 64, 100, 250);
       }
     }
   }
+  led.update();
+  reportWakeups();
 
-  if (touchState == LOW && lastTouchState == LOW)
-  {
-    touchHandled = false;
-  }
-
-  lastTouchState = touchState;
-
-  delay(10);
+  // --- Sleep until the next deadline, input edge or network result ---
+  waitForNextEvent(lightsEnabled && currentScreen == 1 && !otaActive);
+  allocGuardCheck("loop()");
 }
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+// =============================================================================
+// METERED DISPLAY - ST7789 driver that counts the bytes sent to the panel
+// =============================================================================
+// Every pixel write, whether it comes from Adafruit_GFX, the DMA transport or
+// an icon blit, opens an address window first and then fills it. Counting at
+// setAddrWindow() therefore covers all pixel traffic: 11 bytes of
+// CASET/RASET/RAMWR plus 2 bytes per pixel in the window. One-off commands
+// (init, rotation, scroll) are not counted.
+//
+// Only the task that draws writes the count; any task may read it.
+
+#include <atomic>
+#include <Adafruit_ST7789.h>
+
+class MeteredST7789 : public Adafruit_ST7789
+{
+public:
+  using Adafruit_ST7789::Adafruit_ST7789;
+
+  void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) override
+  {
+    uint64_t sent = bytesSent_.load(std::memory_order_relaxed);
+    bytesSent_.store(sent + ADDR_WINDOW_BYTES + 2ull * w * h, std::memory_order_relaxed);
+    Adafruit_ST7789::setAddrWindow(x, y, w, h);
+  }
+
+  uint64_t bytesSent() const { return bytesSent_.load(std::memory_order_relaxed); }
+
+private:
+  static const uint32_t ADDR_WINDOW_BYTES = 11;
+
+  std::atomic<uint64_t> bytesSent_{0};
+};
@@ -0,0 +1,234 @@
+// =============================================================================
+// METRICS - Runtime counters for the status server's /metrics
+// =============================================================================
+
+#include "metrics.h"
+
+#include <atomic>
+#include <WiFi.h>
+#include <esp_timer.h>
+
+namespace
+{
+
+// Upper bounds of the loop wake lateness histogram buckets, microseconds
+const uint32_t WAKE_BUCKETS_US[] = {1000, 2000, 5000, 10000, 20000, 50000, 100000, 250000};
+const uint8_t WAKE_BUCKET_COUNT = sizeof(WAKE_BUCKETS_US) / sizeof(WAKE_BUCKETS_US[0]);
+
+const char *SCREEN_NAMES[SCREEN_COUNT] = {"clock", "forecast", "history"};
+const char *ENDPOINT_NAMES[ENDPOINT_COUNT] = {"location", "forecast", "ota_version",
+                                              "ota_manifest", "ota_delta", "ota_image"};
+
+// Count, total and worst of a duration; one writer
+struct Timing
+{
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint64_t> sumUs{0};
+  std::atomic<uint32_t> maxUs{0};
+
+  void add(uint32_t us)
+  {
+    sumUs.store(sumUs.load(std::memory_order_relaxed) + us, std::memory_order_relaxed);
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (us > maxUs.load(std::memory_order_relaxed)) maxUs.store(us, std::memory_order_relaxed);
+  }
+};
+
+struct HttpStats
+{
+  Timing latency;
+  std::atomic<uint32_t> errors{0};  // Connection errors and 4xx/5xx
+  std::atomic<uint64_t> bytes{0};
+  Timing jsonParse;
+};
+
+std::atomic<uint32_t> wakeBuckets[WAKE_BUCKET_COUNT + 1];  // Last one is +Inf
+std::atomic<uint64_t> wakeLateSumUs{0};
+Timing renders[SCREEN_COUNT];
+HttpStats http[ENDPOINT_COUNT];
+std::atomic<uint32_t> wifiConnects{0};
+
+void appendHeader(String &out, const char *name, const char *type, const char *help)
+{
+  char line[160];
+  snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+  out += line;
+}
+
+void appendCount(String &out, const char *name, const char *labels, uint64_t value)
+{
+  char line[160];
+  snprintf(line, sizeof(line), "%s%s %llu\n", name, labels, (unsigned long long)value);
+  out += line;
+}
+
+// Microseconds as exact decimal seconds; no float, so months of uptime keep
+// their last digit
+void appendSeconds(String &out, const char *name, const char *labels, uint64_t us)
+{
+  char line[160];
+  snprintf(line, sizeof(line), "%s%s %llu.%06lu\n", name, labels, (unsigned long long)(us / 1000000),
+           (unsigned long)(us % 1000000));
+  out += line;
+}
+
+// A Timing's _sum (seconds) and _count lines of a summary
+void appendTiming(String &out, const char *name, const char *labels, const Timing &timing)
+{
+  char metric[96];
+  snprintf(metric, sizeof(metric), "%s_sum", name);
+  appendSeconds(out, metric, labels, timing.sumUs.load());
+  snprintf(metric, sizeof(metric), "%s_count", name);
+  appendCount(out, metric, labels, timing.count.load());
+}
+
+} // namespace
+
+void metricsLoopWake(int32_t lateUs)
+{
+  uint32_t late = (lateUs > 0) ? (uint32_t)lateUs : 0;  // Tick rounding can wake a little early
+  uint8_t bucket = 0;
+  while (bucket < WAKE_BUCKET_COUNT && late > WAKE_BUCKETS_US[bucket])
+  {
+    bucket++;
+  }
+  wakeBuckets[bucket].store(wakeBuckets[bucket].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  wakeLateSumUs.store(wakeLateSumUs.load(std::memory_order_relaxed) + late, std::memory_order_relaxed);
+}
+
+void metricsRender(MetricsScreen screen, uint32_t us)
+{
+  renders[screen].add(us);
+}
+
+void metricsHttp(HttpEndpoint endpoint, int httpCode, uint32_t latencyUs, int32_t bytes)
+{
+  HttpStats &stats = http[endpoint];
+  if (httpCode > 0)
+  {
+    stats.latency.add(latencyUs);
+  }
+  if (httpCode <= 0 || httpCode >= 400)
+  {
+    stats.errors.store(stats.errors.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+  if (bytes > 0)
+  {
+    stats.bytes.store(stats.bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+  }
+}
+
+void metricsJsonParse(HttpEndpoint endpoint, uint32_t us)
+{
+  http[endpoint].jsonParse.add(us);
+}
+
+void metricsWiFiConnected()
+{
+  wifiConnects.store(wifiConnects.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+String metricsReport(const char *firmwareVersion, uint64_t displayBytes)
+{
+  String out;
+  char labels[64];
+
+  appendHeader(out, "satellite_info", "gauge", "Firmware version");
+  snprintf(labels, sizeof(labels), "{version=\"%s\"}", firmwareVersion);
+  appendCount(out, "satellite_info", labels, 1);
+
+  appendHeader(out, "satellite_uptime_seconds", "counter", "Time since boot");
+  appendSeconds(out, "satellite_uptime_seconds", "", esp_timer_get_time());
+
+  appendHeader(out, "satellite_heap_free_bytes", "gauge", "Free heap");
+  appendCount(out, "satellite_heap_free_bytes", "", ESP.getFreeHeap());
+  appendHeader(out, "satellite_heap_min_free_bytes", "gauge", "Lowest free heap since boot");
+  appendCount(out, "satellite_heap_min_free_bytes", "", ESP.getMinFreeHeap());
+  appendHeader(out, "satellite_heap_largest_free_block_bytes", "gauge", "Largest block malloc() can return");
+  appendCount(out, "satellite_heap_largest_free_block_bytes", "", ESP.getMaxAllocHeap());
+
+  // Cumulative buckets, as Prometheus wants them
+  appendHeader(out, "satellite_loop_wake_lateness_seconds", "histogram",
+               "How long after its deadline loop() woke from a timed sleep");
+  uint64_t cumulative = 0;
+  for (uint8_t i = 0; i <= WAKE_BUCKET_COUNT; i++)
+  {
+    cumulative += wakeBuckets[i].load();
+    if (i < WAKE_BUCKET_COUNT)
+    {
+      snprintf(labels, sizeof(labels), "{le=\"%lu.%06lu\"}", (unsigned long)(WAKE_BUCKETS_US[i] / 1000000),
+               (unsigned long)(WAKE_BUCKETS_US[i] % 1000000));
+    }
+    else
+    {
+      snprintf(labels, sizeof(labels), "{le=\"+Inf\"}");
+    }
+    appendCount(out, "satellite_loop_wake_lateness_seconds_bucket", labels, cumulative);
+  }
+  appendSeconds(out, "satellite_loop_wake_lateness_seconds_sum", "", wakeLateSumUs.load());
+  appendCount(out, "satellite_loop_wake_lateness_seconds_count", "", cumulative);
+
+  appendHeader(out, "satellite_render_seconds", "summary", "Time to draw or update a screen");
+  for (uint8_t i = 0; i < SCREEN_COUNT; i++)
+  {
+    snprintf(labels, sizeof(labels), "{screen=\"%s\"}", SCREEN_NAMES[i]);
+    appendTiming(out, "satellite_render_seconds", labels, renders[i]);
+  }
+  appendHeader(out, "satellite_render_max_seconds", "gauge", "Slowest draw of a screen since boot");
+  for (uint8_t i = 0; i < SCREEN_COUNT; i++)
+  {
+    snprintf(labels, sizeof(labels), "{screen=\"%s\"}", SCREEN_NAMES[i]);
+    appendSeconds(out, "satellite_render_max_seconds", labels, renders[i].maxUs.load());
+  }
+
+  appendHeader(out, "satellite_display_spi_bytes_total", "counter", "Bytes sent to the panel");
+  appendCount(out, "satellite_display_spi_bytes_total", "", displayBytes);
+
+  appendHeader(out, "satellite_http_request_seconds", "summary", "Request sent to response headers received");
+  for (uint8_t i = 0; i < ENDPOINT_COUNT; i++)
+  {
+    snprintf(labels, sizeof(labels), "{endpoint=\"%s\"}", ENDPOINT_NAMES[i]);
+    appendTiming(out, "satellite_http_request_seconds", labels, http[i].latency);
+  }
+  appendHeader(out, "satellite_http_request_max_seconds", "gauge", "Slowest response since boot");
+  for (uint8_t i = 0; i < ENDPOINT_COUNT; i++)
+  {
+    snprintf(labels, sizeof(labels), "{endpoint=\"%s\"}", ENDPOINT_NAMES[i]);
+    appendSeconds(out, "satellite_http_request_max_seconds", labels, http[i].latency.maxUs.load());
+  }
+  appendHeader(out, "satellite_http_errors_total", "counter", "Requests that failed to connect or got 4xx/5xx");
+  for (uint8_t i = 0; i < ENDPOINT_COUNT; i++)
+  {
+    snprintf(labels, sizeof(labels), "{endpoint=\"%s\"}", ENDPOINT_NAMES[i]);
+    appendCount(out, "satellite_http_errors_total", labels, http[i].errors.load());
+  }
+  appendHeader(out, "satellite_http_response_bytes_total", "counter", "Response bodies received");
+  for (uint8_t i = 0; i < ENDPOINT_COUNT; i++)
+  {
+    snprintf(labels, sizeof(labels), "{endpoint=\"%s\"}", ENDPOINT_NAMES[i]);
+    appendCount(out, "satellite_http_response_bytes_total", labels, http[i].bytes.load());
+  }
+
+  appendHeader(out, "satellite_json_parse_seconds", "summary", "Streaming parse of a JSON or MessagePack response");
+  for (uint8_t i = 0; i < ENDPOINT_COUNT; i++)
+  {
+    if (i == ENDPOINT_LOCATION || i == ENDPOINT_FORECAST)  // The parsed ones
+    {
+      snprintf(labels, sizeof(labels), "{endpoint=\"%s\"}", ENDPOINT_NAMES[i]);
+      appendTiming(out, "satellite_json_parse_seconds", labels, http[i].jsonParse);
+    }
+  }
+
+  appendHeader(out, "satellite_wifi_rssi_dbm", "gauge", "Signal strength of the AP");
+  if (WiFi.status() == WL_CONNECTED)  // No sample while there is no AP to measure
+  {
+    char line[64];
+    snprintf(line, sizeof(line), "satellite_wifi_rssi_dbm %d\n", WiFi.RSSI());
+    out += line;
+  }
+  appendHeader(out, "satellite_wifi_reconnects_total", "counter", "Connections after the first");
+  uint32_t connects = wifiConnects.load();
+  appendCount(out, "satellite_wifi_reconnects_total", "", connects > 0 ? connects - 1 : 0);
+
+  return out;
+}
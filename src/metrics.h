@@ -0,0 +1,70 @@
+#pragma once
+
+// =============================================================================
+// METRICS - Runtime counters for the status server's /metrics
+// =============================================================================
+// loop() and the network task record what they did as they go; the web task
+// formats it in the Prometheus text format when /metrics is scraped, along
+// with gauges read at that moment (heap, RSSI, uptime).
+//
+// Every counter is an atomic with a single writer, so recording costs a few
+// instructions and never blocks or allocates (loop() must not, see
+// alloc_guard.h). A scrape can catch a summary between its _sum and _count
+// updates; the next scrape is consistent again.
+
+#include <Arduino.h>
+
+enum MetricsScreen : uint8_t
+{
+  SCREEN_CLOCK,     // Screen one
+  SCREEN_FORECAST,  // Screen two
+  SCREEN_HISTORY,   // Screen three
+  SCREEN_COUNT
+};
+
+enum HttpEndpoint : uint8_t
+{
+  ENDPOINT_LOCATION,
+  ENDPOINT_FORECAST,
+  ENDPOINT_OTA_VERSION,
+  ENDPOINT_OTA_MANIFEST,
+  ENDPOINT_OTA_DELTA,
+  ENDPOINT_OTA_IMAGE,
+  ENDPOINT_COUNT
+};
+
+// loop(): woke from a timed sleep `lateUs` after the deadline it asked for
+void metricsLoopWake(int32_t lateUs);
+
+// loop(): drawing (or updating) `screen` took `us`
+void metricsRender(MetricsScreen screen, uint32_t us);
+
+// Network task: a request to `endpoint` got `httpCode` (negative for a
+// connection error) `latencyUs` after it was sent, with a `bytes` body
+// (Content-Length; negative if unknown). Latency only counts requests that
+// got a response.
+void metricsHttp(HttpEndpoint endpoint, int httpCode, uint32_t latencyUs, int32_t bytes);
+
+// Network task: parsing the response from `endpoint` (JSON or MessagePack)
+// took `us`
+void metricsJsonParse(HttpEndpoint endpoint, uint32_t us);
+
+// The station got an IP; every one after the first is a reconnect
+void metricsWiFiConnected();
+
+// Times a screen draw from construction to the end of the scope, so early
+// returns are covered too
+class MetricsRenderTimer
+{
+public:
+  explicit MetricsRenderTimer(MetricsScreen screen) : screen_(screen), startUs_(micros()) {}
+  ~MetricsRenderTimer() { metricsRender(screen_, micros() - startUs_); }
+
+private:
+  MetricsScreen screen_;
+  uint32_t startUs_;
+};
+
+// Everything in Prometheus text exposition format. `displayBytes` is what
+// the caller counted going to the panel.
+String metricsReport(const char *firmwareVersion, uint64_t displayBytes);
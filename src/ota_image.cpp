@@ -0,0 +1,164 @@
+// =============================================================================
+// OTA IMAGE - Write a firmware image into the next OTA partition, verified
+// =============================================================================
+
+#include "ota_image.h"
+
+#include <string.h>
+
+namespace
+{
+
+const size_t PAGE_SIZE = 4096;  // Flash sector; one write per page
+
+int hexDigit(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+} // namespace
+
+bool otaParseSha256(const String &line, uint8_t sha[SHA256_SIZE])
+{
+  if (line.length() < SHA256_SIZE * 2)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < SHA256_SIZE; i++)
+  {
+    int high = hexDigit(line[i * 2]);
+    int low = hexDigit(line[i * 2 + 1]);
+    if (high < 0 || low < 0)
+    {
+      return false;
+    }
+    sha[i] = (uint8_t)(high << 4 | low);
+  }
+  // The hash ends there: a 65th hex digit means it isn't a SHA-256
+  return line.length() == SHA256_SIZE * 2 || hexDigit(line[SHA256_SIZE * 2]) < 0;
+}
+
+OtaImageWriter::~OtaImageWriter()
+{
+  if (writing_)
+  {
+    esp_ota_abort(handle_);  // The boot partition stays as it was
+    mbedtls_sha256_free(&sha_);
+  }
+  free(page_);
+}
+
+bool OtaImageWriter::fail(const char *why)
+{
+  if (!error_)
+  {
+    error_ = why;
+  }
+  return false;
+}
+
+bool OtaImageWriter::begin(size_t size)
+{
+  partition_ = esp_ota_get_next_update_partition(nullptr);
+  if (!partition_)
+  {
+    return fail("no OTA partition to write");
+  }
+  if (size > partition_->size)
+  {
+    return fail("image does not fit the OTA partition");
+  }
+  page_ = (uint8_t *)malloc(PAGE_SIZE);
+  if (!page_)
+  {
+    return fail("out of memory");
+  }
+  if (esp_ota_begin(partition_, size ? size : OTA_SIZE_UNKNOWN, &handle_) != ESP_OK)
+  {
+    return fail("could not erase the OTA partition");
+  }
+  writing_ = true;
+  mbedtls_sha256_init(&sha_);
+  mbedtls_sha256_starts(&sha_, 0);
+  return true;
+}
+
+bool OtaImageWriter::flushPage()
+{
+  if (esp_ota_write(handle_, page_, pageUsed_) != ESP_OK)
+  {
+    return fail("flash write failed");
+  }
+  mbedtls_sha256_update(&sha_, page_, pageUsed_);
+  written_ += pageUsed_;
+  pageUsed_ = 0;
+  return true;
+}
+
+size_t OtaImageWriter::write(uint8_t byte)
+{
+  return write(&byte, 1);
+}
+
+size_t OtaImageWriter::write(const uint8_t *data, size_t size)
+{
+  if (!writing_ || error_)
+  {
+    return 0;
+  }
+  if (written() + size > partition_->size)
+  {
+    fail("image does not fit the OTA partition");
+    return 0;
+  }
+
+  size_t done = 0;
+  while (done < size)
+  {
+    size_t chunk = min(PAGE_SIZE - pageUsed_, size - done);
+    memcpy(page_ + pageUsed_, data + done, chunk);
+    pageUsed_ += chunk;
+    done += chunk;
+    if (pageUsed_ == PAGE_SIZE && !flushPage())
+    {
+      return 0;
+    }
+  }
+  return size;
+}
+
+bool OtaImageWriter::finish(const uint8_t expectedSha[SHA256_SIZE])
+{
+  if (!writing_ || error_)
+  {
+    return fail("nothing to finish");
+  }
+  if (pageUsed_ > 0 && !flushPage())
+  {
+    return false;
+  }
+
+  uint8_t digest[SHA256_SIZE];
+  mbedtls_sha256_finish(&sha_, digest);
+  mbedtls_sha256_free(&sha_);
+  if (memcmp(digest, expectedSha, SHA256_SIZE) != 0)
+  {
+    esp_ota_abort(handle_);
+    writing_ = false;
+    return fail("SHA-256 does not match the manifest");
+  }
+
+  writing_ = false;
+  if (esp_ota_end(handle_) != ESP_OK)
+  {
+    return fail("image did not validate");
+  }
+  if (esp_ota_set_boot_partition(partition_) != ESP_OK)
+  {
+    return fail("could not switch the boot partition");
+  }
+  return true;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+// =============================================================================
+// OTA IMAGE - Write a firmware image into the next OTA partition, verified
+// =============================================================================
+// Whatever produces the image (a plain download, the gzip inflater, the delta
+// applier) prints it into an OtaImageWriter. Bytes go to flash a sector at a
+// time as they come, and a SHA-256 runs over them on the way. finish() only
+// makes the image the boot partition if that hash matches the one the release
+// manifest gave, so a truncated, corrupted or substituted image is never
+// booted, with or without TLS certificate checks. The image then boots
+// pending verification like any OTA image, so app rollback still applies.
+
+#include <Arduino.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/sha256.h>
+
+const size_t SHA256_SIZE = 32;
+
+// Read the hash from a sha256sum line ("<64 hex digits>  firmware.bin")
+bool otaParseSha256(const String &line, uint8_t sha[SHA256_SIZE]);
+
+class OtaImageWriter : public Print
+{
+public:
+  ~OtaImageWriter();  // Aborts an image that wasn't finished
+
+  // Erase the next OTA partition for an image of `size` bytes (0 if unknown:
+  // the whole partition). False if there is none or the image can't fit.
+  bool begin(size_t size = 0);
+
+  size_t write(uint8_t byte) override;
+  size_t write(const uint8_t *data, size_t size) override;
+  using Print::write;
+
+  // Write out the rest and, if the SHA-256 of everything written is
+  // `expectedSha` and the image validates, make it the boot partition
+  bool finish(const uint8_t expectedSha[SHA256_SIZE]);
+
+  uint32_t written() const { return written_ + pageUsed_; }
+  const char *error() const { return error_; }
+
+private:
+  bool fail(const char *why);
+  bool flushPage();
+
+  const esp_partition_t *partition_ = nullptr;
+  esp_ota_handle_t handle_ = 0;
+  bool writing_ = false;  // Between esp_ota_begin() and esp_ota_end()
+  uint8_t *page_ = nullptr;
+  size_t pageUsed_ = 0;
+  uint32_t written_ = 0;  // Flushed to flash
+  mbedtls_sha256_context sha_;
+  const char *error_ = nullptr;
+};
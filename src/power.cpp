@@ -0,0 +1,79 @@
+// =============================================================================
+// POWER - Automatic light sleep between events
+// =============================================================================
+
+#include "power.h"
+
+#if defined(ESP_PLATFORM) && !defined(HAL_NATIVE)
+
+#include <esp_pm.h>
+
+namespace
+{
+
+const char *HOLDER_NAMES[POWER_HOLDER_COUNT] = {"led", "display_dma"};
+
+esp_pm_lock_handle_t locks[POWER_HOLDER_COUNT];
+bool held[POWER_HOLDER_COUNT];
+
+} // namespace
+
+bool powerEnableLightSleep()
+{
+  // No frequency scaling: the display SPI clock is derived from APB, and the
+  // Arduino SPI driver doesn't hold a PM lock while it writes
+  esp_pm_config_esp32c3_t config = {};
+  config.max_freq_mhz = getCpuFrequencyMhz();
+  config.min_freq_mhz = config.max_freq_mhz;
+  config.light_sleep_enable = true;
+
+  esp_err_t err = esp_pm_configure(&config);
+  if (err != ESP_OK)
+  {
+    Serial.printf("Light sleep unavailable (%s), idling awake\n", esp_err_to_name(err));
+    return false;
+  }
+  // Created here, once, since creating a lock allocates
+  for (uint8_t i = 0; i < POWER_HOLDER_COUNT; i++)
+  {
+    err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, HOLDER_NAMES[i], &locks[i]);
+    if (err != ESP_OK)
+    {
+      Serial.printf("PM lock %s failed (%s)\n", HOLDER_NAMES[i], esp_err_to_name(err));
+      locks[i] = nullptr;
+    }
+  }
+  Serial.println("Automatic light sleep enabled");
+  return true;
+}
+
+void powerStayAwake(PowerHolder holder, bool awake)
+{
+  if (!locks[holder] || held[holder] == awake)
+  {
+    return;
+  }
+  held[holder] = awake;
+  if (awake)
+  {
+    esp_pm_lock_acquire(locks[holder]);
+  }
+  else
+  {
+    esp_pm_lock_release(locks[holder]);
+  }
+}
+
+#else
+
+bool powerEnableLightSleep()
+{
+  Serial.println("Light sleep unavailable (not an ESP32 build), idling awake");
+  return false;
+}
+
+void powerStayAwake(PowerHolder, bool)
+{
+}
+
+#endif
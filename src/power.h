@@ -0,0 +1,34 @@
+#pragma once
+
+// =============================================================================
+// POWER - Automatic light sleep between events
+// =============================================================================
+// With automatic light sleep the idle task stops the CPU and most clocks
+// whenever every task is blocked, until the next FreeRTOS timeout, a GPIO
+// wake level (see input_events.h) or another interrupt. WiFi stays associated
+// in modem sleep, waking for DTIM beacons. loop() then only has to block in
+// ulTaskNotifyTake() instead of polling with delay().
+//
+// Light sleep gates the APB clock, which stalls the LEDC PWM mid-pattern and
+// SPI DMA mid-transfer. Code driving either holds the chip awake with
+// powerStayAwake() for as long as the peripheral is busy.
+
+#include <Arduino.h>
+
+// Who is keeping the chip out of light sleep; each has its own PM lock
+enum PowerHolder : uint8_t
+{
+  POWER_HOLDER_LED,          // A LedAnimator pattern is running
+  POWER_HOLDER_DISPLAY_DMA,  // Pixel transfers are queued
+  POWER_HOLDER_COUNT
+};
+
+// Turn on automatic light sleep. False if this build of the framework doesn't
+// support it (power management or tickless idle compiled out); the CPU then
+// just idles awake between events.
+bool powerEnableLightSleep();
+
+// Hold (true) or release (false) an ESP_PM_NO_LIGHT_SLEEP lock for `holder`.
+// Repeating the current state does nothing, so callers needn't track it.
+// Doesn't allocate; a no-op until powerEnableLightSleep() has succeeded.
+void powerStayAwake(PowerHolder holder, bool awake);
@@ -0,0 +1,174 @@
+// =============================================================================
+// SCREEN CACHE - Pre-rendered full-screen frame as an RGB565 run list
+// =============================================================================
+
+#include "screen_cache.h"
+
+#include <Arduino.h>
+#include <stdlib.h>
+
+namespace
+{
+
+// GFX target that only keeps the pixels falling inside a horizontal band
+class BandCanvas : public Adafruit_GFX
+{
+public:
+  BandCanvas(int16_t w, int16_t h, uint16_t *buffer, int16_t bandRows)
+      : Adafruit_GFX(w, h), buffer_(buffer), bandRows_(bandRows)
+  {
+  }
+
+  void setBand(int16_t y0, uint16_t bgColor)
+  {
+    y0_ = y0;
+    for (size_t i = 0; i < (size_t)WIDTH * bandRows_; i++) buffer_[i] = bgColor;
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override
+  {
+    if (x >= 0 && x < WIDTH && y >= y0_ && y < y0_ + bandRows_)
+    {
+      buffer_[(y - y0_) * WIDTH + x] = color;
+    }
+  }
+
+  void writePixel(int16_t x, int16_t y, uint16_t color) override { drawPixel(x, y, color); }
+
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override
+  {
+    // Clip to the screen and the band, then fill rows directly
+    int16_t x0 = x < 0 ? 0 : x;
+    int16_t x1 = (x + w > WIDTH) ? WIDTH : x + w;
+    int16_t y0 = y < y0_ ? y0_ : y;
+    int16_t y1 = (y + h > y0_ + bandRows_) ? y0_ + bandRows_ : y + h;
+    for (int16_t row = y0; row < y1; row++)
+    {
+      uint16_t *p = &buffer_[(row - y0_) * WIDTH];
+      for (int16_t col = x0; col < x1; col++) p[col] = color;
+    }
+  }
+
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override
+  {
+    writeFillRect(x, y, w, h, color);
+  }
+
+  void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override
+  {
+    writeFillRect(x, y, w, 1, color);
+  }
+
+private:
+  uint16_t *buffer_;
+  int16_t bandRows_;
+  int16_t y0_ = 0;
+};
+
+} // namespace
+
+ScreenCache::ScreenCache(int16_t width, int16_t height, uint16_t bgColor)
+    : width_(width), height_(height), bgColor_(bgColor)
+{
+}
+
+ScreenCache::~ScreenCache()
+{
+  free(band_);
+  free(runs_);
+}
+
+void ScreenCache::invalidate()
+{
+  valid_ = false;
+  runCount_ = 0;  // The memory stays for the next rebuild
+}
+
+bool ScreenCache::reserve(size_t runs)
+{
+  if (!band_)
+  {
+    band_ = (uint16_t *)malloc((size_t)width_ * BAND_ROWS * sizeof(uint16_t));
+    if (!band_) return false;
+  }
+  if (runs > runCapacity_)
+  {
+    Run *grown = (Run *)realloc(runs_, runs * sizeof(Run));
+    if (!grown) return false;
+    runs_ = grown;
+    runCapacity_ = runs;
+  }
+  return true;
+}
+
+bool ScreenCache::appendPixels(const uint16_t *pixels, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    uint16_t color = pixels[i];
+    if (runCount_ > 0 && runs_[runCount_ - 1].color == color && runs_[runCount_ - 1].count < 0xFFFF)
+    {
+      runs_[runCount_ - 1].count++;
+      continue;
+    }
+
+    if (runCount_ == runCapacity_ && !reserve(runCapacity_ ? runCapacity_ * 2 : 1024))
+    {
+      return false;
+    }
+    runs_[runCount_].count = 1;
+    runs_[runCount_].color = color;
+    runCount_++;
+  }
+  return true;
+}
+
+bool ScreenCache::update(uint32_t key, RenderFn render)
+{
+  if (valid() && key == key_) return true;
+
+  unsigned long start = millis();
+  invalidate();
+
+  if (!reserve(0))
+  {
+    Serial.println("Screen cache: no memory for render band");
+    return false;
+  }
+
+  BandCanvas canvas(width_, height_, band_, BAND_ROWS);
+  bool ok = true;
+  for (int16_t y = 0; y < height_ && ok; y += BAND_ROWS)
+  {
+    canvas.setBand(y, bgColor_);
+    render(canvas);
+    int16_t rows = (height_ - y < BAND_ROWS) ? height_ - y : BAND_ROWS;
+    ok = appendPixels(band_, (size_t)width_ * rows);
+  }
+
+  if (!ok)
+  {
+    Serial.println("Screen cache: out of memory, drawing directly");
+    invalidate();
+    return false;
+  }
+
+  key_ = key;
+  valid_ = true;
+
+  Serial.printf("Screen cache rebuilt: %u runs, %u bytes, %lu ms\n",
+                (unsigned)runCount_, (unsigned)sizeBytes(), millis() - start);
+  return true;
+}
+
+void ScreenCache::push(DisplayTransport &display) const
+{
+  if (!valid()) return;
+
+  display.setAddrWindow(0, 0, width_, height_);
+  for (size_t i = 0; i < runCount_; i++)
+  {
+    display.writeColor(runs_[i].color, runs_[i].count);
+  }
+  display.flush();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// =============================================================================
+// SCREEN CACHE - Pre-rendered full-screen frame as an RGB565 run list
+// =============================================================================
+// Renders a screen once, off-panel, and keeps it run-length encoded. Showing it
+// is then a single address window and one stream of pixel runs instead of
+// hundreds of GFX primitives, each with its own address window.
+//
+// Rendering goes through a small band buffer (SCREEN_W x BAND_ROWS) so the full
+// 134 KB frame never has to exist in RAM; the render function is called once
+// per band with drawing clipped to it, so it must draw the same thing each time.
+//
+// The band and the run list are kept between rebuilds; after reserve() a
+// rebuild only goes to the heap for a frame with more runs than reserved.
+
+#include <Adafruit_GFX.h>
+
+#include "display_transport.h"
+
+class ScreenCache
+{
+public:
+  typedef void (*RenderFn)(Adafruit_GFX &gfx);
+
+  ScreenCache(int16_t width, int16_t height, uint16_t bgColor);
+  ~ScreenCache();
+
+  // Allocate the band and room for `runs` runs up front. False if out of memory.
+  bool reserve(size_t runs);
+
+  // Re-render unless the cached frame was built for the same key. Returns
+  // false if there is no usable frame (out of memory).
+  bool update(uint32_t key, RenderFn render);
+
+  // Queue the frame to the panel, covering the whole screen. Returns while
+  // the last blocks are still on the wire; fence() the transport after.
+  void push(DisplayTransport &display) const;
+
+  void invalidate();
+  bool valid() const { return valid_; }
+  size_t sizeBytes() const { return runCount_ * sizeof(Run); }
+
+private:
+  static const int16_t BAND_ROWS = 16;
+
+  struct Run
+  {
+    uint16_t count;
+    uint16_t color;
+  };
+
+  bool appendPixels(const uint16_t *pixels, size_t len);
+
+  int16_t width_;
+  int16_t height_;
+  uint16_t bgColor_;
+  uint32_t key_ = 0;
+  bool valid_ = false;
+
+  uint16_t *band_ = nullptr;  // SCREEN_W x BAND_ROWS render target
+  Run *runs_ = nullptr;
+  size_t runCount_ = 0;
+  size_t runCapacity_ = 0;
+};
@@ -0,0 +1,151 @@
+// =============================================================================
+// SENSOR HISTORY - A day of AHT10 samples in fixed point, filtered
+// =============================================================================
+
+#include "sensor_history.h"
+
+namespace
+{
+
+int16_t toCenti(float value, float lo, float hi)
+{
+  value = constrain(value, lo, hi);  // Sensor range; keeps the result in int16
+  return (int16_t)lroundf(value * 100.0f);
+}
+
+int16_t clampInt16(int64_t value)
+{
+  return (int16_t)constrain(value, (int64_t)INT16_MIN, (int64_t)INT16_MAX);
+}
+
+// Least-squares slope of value against time, in value units per hour
+int16_t slopePerHour(int64_t n, int64_t sumT, int64_t sumV, int64_t sumTT, int64_t sumTV)
+{
+  int64_t denominator = n * sumTT - sumT * sumT;
+  if (n < 2 || denominator == 0)
+  {
+    return 0;
+  }
+  // A day of samples puts the numerator near 1e16; times 3600 would overflow
+  double perSecond = (double)(n * sumTV - sumT * sumV) / (double)denominator;
+  return clampInt16(llround(perSecond * 3600.0));
+}
+
+} // namespace
+
+void SensorHistory::add(uint32_t atS, float temperatureC, float humidityPercent)
+{
+  if (count_ > 0 && atS < latest().atS)
+  {
+    atS = latest().atS;
+  }
+  SensorSample &slot = samples_[head_];
+  slot.atS = atS;
+  slot.value.centiC = toCenti(temperatureC, -40.0f, 85.0f);
+  slot.value.centiRh = toCenti(humidityPercent, 0.0f, 100.0f);
+  head_ = (head_ + 1) % CAPACITY;
+  if (count_ < CAPACITY)
+  {
+    count_++;
+  }
+
+  int32_t medianC = (int32_t)median(false) << EMA_FRACTION_BITS;
+  int32_t medianRh = (int32_t)median(true) << EMA_FRACTION_BITS;
+  if (count_ == 1)
+  {
+    emaC_ = medianC;
+    emaRh_ = medianRh;
+  }
+  else
+  {
+    emaC_ += (medianC - emaC_) >> EMA_SHIFT;
+    emaRh_ += (medianRh - emaRh_) >> EMA_SHIFT;
+  }
+}
+
+void SensorHistory::shiftTime(uint32_t offsetS)
+{
+  for (uint16_t i = 0; i < count_; i++)
+  {
+    samples_[(head_ + CAPACITY - count_ + i) % CAPACITY].atS += offsetS;
+  }
+}
+
+const SensorSample &SensorHistory::sample(uint16_t i) const
+{
+  return samples_[(head_ + CAPACITY - count_ + i) % CAPACITY];
+}
+
+SensorReading SensorHistory::filtered() const
+{
+  const int32_t half = 1 << (EMA_FRACTION_BITS - 1);
+  return {(int16_t)((emaC_ + half) >> EMA_FRACTION_BITS), (int16_t)((emaRh_ + half) >> EMA_FRACTION_BITS)};
+}
+
+// Median of the newest MEDIAN_TAPS samples (fewer early on; the lower middle
+// for an even count)
+int16_t SensorHistory::median(bool humidity) const
+{
+  int16_t values[MEDIAN_TAPS];
+  uint8_t n = (count_ < MEDIAN_TAPS) ? count_ : MEDIAN_TAPS;
+  for (uint8_t i = 0; i < n; i++)
+  {
+    const SensorReading &value = sample(count_ - 1 - i).value;
+    int16_t v = humidity ? value.centiRh : value.centiC;
+
+    // Insertion sort; five values
+    uint8_t j = i;
+    while (j > 0 && values[j - 1] > v)
+    {
+      values[j] = values[j - 1];
+      j--;
+    }
+    values[j] = v;
+  }
+  return values[(n - 1) / 2];
+}
+
+bool SensorHistory::stats(uint32_t nowS, uint32_t windowS, SensorStats &out) const
+{
+  out = {};
+  int64_t sumT = 0, sumTT = 0;
+  int64_t sumC = 0, sumTC = 0;
+  int64_t sumRh = 0, sumTRh = 0;
+
+  // Newest first, until the window's start; times relative to now keep the
+  // sums small
+  for (uint16_t i = count_; i > 0; i--)
+  {
+    const SensorSample &s = sample(i - 1);
+    uint32_t age = nowS - s.atS;
+    if (age > windowS)
+    {
+      break;
+    }
+    if (out.count == 0)
+    {
+      out.min = out.max = s.value;
+    }
+    out.min.centiC = min(out.min.centiC, s.value.centiC);
+    out.max.centiC = max(out.max.centiC, s.value.centiC);
+    out.min.centiRh = min(out.min.centiRh, s.value.centiRh);
+    out.max.centiRh = max(out.max.centiRh, s.value.centiRh);
+    out.count++;
+
+    int64_t t = -(int64_t)age;
+    sumT += t;
+    sumTT += t * t;
+    sumC += s.value.centiC;
+    sumTC += t * s.value.centiC;
+    sumRh += s.value.centiRh;
+    sumTRh += t * s.value.centiRh;
+  }
+  if (out.count == 0)
+  {
+    return false;
+  }
+
+  out.trendPerHour.centiC = slopePerHour(out.count, sumT, sumC, sumTT, sumTC);
+  out.trendPerHour.centiRh = slopePerHour(out.count, sumT, sumRh, sumTT, sumTRh);
+  return true;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+// =============================================================================
+// SENSOR HISTORY - A day of AHT10 samples in fixed point, filtered
+// =============================================================================
+// Every reading goes into a ring of timestamped samples: temperature in
+// hundredths of a degree Celsius and humidity in hundredths of a percent,
+// both int16, so a day at one sample per 30 s is 23 KB of static RAM and no
+// heap. Samples are kept as read, with no calibration, so the graph and the
+// min/max show what the sensor measured.
+//
+// The value to display is filtered as samples come in: the median of the last
+// MEDIAN_TAPS samples drops a single bad read, then an exponential moving
+// average (integer, 1/2^EMA_SHIFT per sample) smooths the step between
+// readings. stats() gives min, max and trend over any window of the ring.
+
+#include <Arduino.h>
+
+struct SensorReading
+{
+  int16_t centiC;   // Hundredths of a degree Celsius
+  int16_t centiRh;  // Hundredths of a percent relative humidity
+};
+
+struct SensorSample
+{
+  uint32_t atS;  // UTC seconds, or seconds since boot until the clock is set
+  SensorReading value;
+};
+
+struct SensorStats
+{
+  uint16_t count;               // Samples in the window
+  SensorReading min;
+  SensorReading max;
+  SensorReading trendPerHour;   // Least-squares slope; 0 with fewer than two samples
+};
+
+class SensorHistory
+{
+public:
+  static const uint16_t CAPACITY = 2880;  // 24 h at one sample per 30 s
+  static const uint8_t MEDIAN_TAPS = 5;
+  static const uint8_t EMA_SHIFT = 2;
+
+  // Add a reading taken at `atS`. A time before the latest sample's (a clock
+  // step back) is taken as the latest's, so the ring stays in order.
+  void add(uint32_t atS, float temperatureC, float humidityPercent);
+
+  // Move every sample `offsetS` later: the samples so far were stamped with
+  // uptime and the clock has been set, offsetS being UTC minus uptime now
+  void shiftTime(uint32_t offsetS);
+
+  uint16_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+  // The i-th sample, 0 being the oldest still held
+  const SensorSample &sample(uint16_t i) const;
+  const SensorSample &latest() const { return sample(count_ - 1); }
+
+  // Median-then-EMA filtered value; only meaningful once a sample was added
+  SensorReading filtered() const;
+
+  // Min, max and trend of the samples taken in the last `windowS` seconds
+  // before `nowS`. False if there are none.
+  bool stats(uint32_t nowS, uint32_t windowS, SensorStats &out) const;
+
+private:
+  static const int EMA_FRACTION_BITS = 8;
+
+  int16_t median(bool humidity) const;
+
+  SensorSample samples_[CAPACITY];
+  uint16_t head_ = 0;   // Next slot to write
+  uint16_t count_ = 0;
+  int32_t emaC_ = 0;    // Scaled by 2^EMA_FRACTION_BITS
+  int32_t emaRh_ = 0;
+};
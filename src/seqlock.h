@@ -0,0 +1,51 @@
+#pragma once
+
+// =============================================================================
+// SEQLOCK - Single-writer snapshot shared between two tasks
+// =============================================================================
+// The writer bumps a sequence number to odd, copies the value in, then bumps it
+// back to even. A reader copies the value out and keeps it only if the sequence
+// was even and unchanged across the copy. Neither side ever blocks, so the UI
+// loop can poll it every pass without waiting on the network task.
+//
+// One writer only. T must be trivially copyable (plain structs and arrays).
+
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+
+template <typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+  void write(const T &value)
+  {
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);  // Odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&value_, &value, sizeof(T));
+    seq_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Copy out the latest value. False while a write is in progress (or if one
+  // overlapped the copy); try again on the next pass.
+  bool read(T &out, uint32_t &version) const
+  {
+    uint32_t before = seq_.load(std::memory_order_acquire);
+    if (before & 1) return false;
+    memcpy(&out, &value_, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (seq_.load(std::memory_order_relaxed) != before) return false;
+    version = before;
+    return true;
+  }
+
+  // Changes on every write; 0 until the first one
+  uint32_t version() const { return seq_.load(std::memory_order_acquire); }
+
+private:
+  std::atomic<uint32_t> seq_{0};
+  T value_ = {};
+};
@@ -0,0 +1,84 @@
+// =============================================================================
+// TEXT RENDERER - Glyph-level diff drawing for fixed-position text
+// =============================================================================
+
+#include "text_renderer.h"
+
+#include <string.h>
+
+TextRenderer::TextRenderer(Adafruit_GFX &gfx, uint8_t textSize, uint16_t color, uint16_t bgColor)
+    : gfx_(gfx), size_(textSize), color_(color), bgColor_(bgColor), oldGlyph_(6, 8), newGlyph_(6, 8)
+{
+  text_[0] = '\0';
+}
+
+void TextRenderer::draw(const char *text, int16_t x, int16_t y)
+{
+  size_t newLen = strlen(text);
+  if (newLen > MAX_CHARS) newLen = MAX_CHARS;
+  size_t oldLen = strlen(text_);
+
+  // Cells only line up if the text stays put. If it moved (a centered string
+  // changed length) clear just the old text and diff the new one against blank.
+  if (valid_ && (x != x_ || y != y_))
+  {
+    gfx_.fillRect(x_, y_, oldLen * charWidth(), charHeight(), bgColor_);
+    valid_ = false;
+  }
+  if (!valid_)
+  {
+    text_[0] = '\0';
+    oldLen = 0;
+  }
+
+  gfx_.startWrite();
+  size_t cells = (newLen > oldLen) ? newLen : oldLen;
+  for (size_t i = 0; i < cells; i++)
+  {
+    char oldChar = (i < oldLen) ? text_[i] : ' ';
+    char newChar = (i < newLen) ? text[i] : ' ';
+    if (oldChar != newChar)
+    {
+      drawCellDiff(x + i * charWidth(), y, oldChar, newChar);
+    }
+  }
+  gfx_.endWrite();
+
+  memcpy(text_, text, newLen);
+  text_[newLen] = '\0';
+  x_ = x;
+  y_ = y;
+  valid_ = true;
+}
+
+void TextRenderer::drawCellDiff(int16_t x, int16_t y, char oldChar, char newChar)
+{
+  // Rasterize both glyphs at 1x, then paint differing font pixels per column,
+  // merging vertical runs of the same color into one rect
+  oldGlyph_.fillScreen(0);
+  oldGlyph_.drawChar(0, 0, oldChar, 1, 0, 1);
+  newGlyph_.fillScreen(0);
+  newGlyph_.drawChar(0, 0, newChar, 1, 0, 1);
+
+  for (int16_t col = 0; col < 6; col++)
+  {
+    int16_t row = 0;
+    while (row < 8)
+    {
+      bool on = newGlyph_.getPixel(col, row);
+      if (on == oldGlyph_.getPixel(col, row))
+      {
+        row++;
+        continue;
+      }
+
+      int16_t runStart = row;
+      while (row < 8 && newGlyph_.getPixel(col, row) == on && oldGlyph_.getPixel(col, row) != on)
+      {
+        row++;
+      }
+      gfx_.writeFillRect(x + col * size_, y + runStart * size_, size_, (row - runStart) * size_,
+                         on ? color_ : bgColor_);
+    }
+  }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+// =============================================================================
+// TEXT RENDERER - Glyph-level diff drawing for fixed-position text
+// =============================================================================
+// Keeps the string that is on the panel and, on the next draw, repaints only the
+// font pixels that differ between the old and new glyph of each changed cell.
+// A minute tick on the big clock is then one digit's worth of small rects
+// instead of a full-screen clear; the blinking colon is a handful of rects.
+//
+// The area under the text must hold the background color when the renderer
+// starts (after invalidate()) - nothing else may draw over it.
+
+#include <Adafruit_GFX.h>
+
+class TextRenderer
+{
+public:
+  // Classic 6x8 GFX font scaled by textSize
+  TextRenderer(Adafruit_GFX &gfx, uint8_t textSize, uint16_t color, uint16_t bgColor);
+
+  // Draw text with its top-left corner at (x, y), diffing against the last draw
+  void draw(const char *text, int16_t x, int16_t y);
+
+  // Forget what is on the panel; call after clearing the screen
+  void invalidate() { valid_ = false; }
+
+  int16_t charWidth() const { return 6 * size_; }
+  int16_t charHeight() const { return 8 * size_; }
+
+private:
+  static const uint8_t MAX_CHARS = 23;  // A full panel row at text size 2
+
+  void drawCellDiff(int16_t x, int16_t y, char oldChar, char newChar);
+
+  Adafruit_GFX &gfx_;
+  uint8_t size_;
+  uint16_t color_;
+  uint16_t bgColor_;
+
+  GFXcanvas1 oldGlyph_;
+  GFXcanvas1 newGlyph_;
+
+  char text_[MAX_CHARS + 1];  // What is on the panel now
+  int16_t x_ = 0;
+  int16_t y_ = 0;
+  bool valid_ = false;
+};
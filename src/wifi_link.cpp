@@ -0,0 +1,213 @@
+// =============================================================================
+// WIFI LINK - Fast association and a supervisor that keeps the station up
+// =============================================================================
+
+#include "wifi_link.h"
+
+#include "alloc_guard.h"
+
+#include <Preferences.h>
+#include <WiFi.h>
+#include <string.h>
+
+namespace
+{
+
+const char *NVS_NAMESPACE = "wifi";
+const char *NVS_KEY = "ap";
+const uint32_t DIRECT_TIMEOUT_MS = 3000;  // Join on a known channel, DHCP included
+const uint32_t SCAN_TIMEOUT_MS = 10000;   // Scan, join and DHCP
+const uint32_t RETRY_MIN_MS = 1000;
+const uint32_t RETRY_MAX_MS = 60000;
+
+} // namespace
+
+void WiFiLink::begin(const char *ssid, const char *password, bool reuseLease)
+{
+  ssid_ = ssid;
+  password_ = password;
+  reuseLease_ = reuseLease;
+
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, true);  // Read-only mode
+  haveSaved_ = (prefs.getBytes(NVS_KEY, &saved_, sizeof(saved_)) == sizeof(saved_)) &&
+               strncmp(saved_.ssid, ssid, sizeof(saved_.ssid)) == 0 && saved_.channel != 0;
+  prefs.end();
+
+  WiFi.persistent(false);         // We keep our own record; the driver's costs a flash write per begin()
+  WiFi.setAutoReconnect(false);   // update() reconnects, with backoff
+  retryDelay_ = RETRY_MIN_MS;
+  startAttempt(haveSaved_);
+}
+
+void WiFiLink::forgetSavedAp()
+{
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, false);  // Read-write mode
+  prefs.clear();
+  prefs.end();
+}
+
+void WiFiLink::startAttempt(bool direct)
+{
+  attemptDirect_ = direct;
+  attemptStartedAt_ = millis();
+  state_ = LINK_CONNECTING;
+  AllocGuardExempt driverCalls;  // The IDF's WiFi and netif layers allocate while joining
+  if (WiFi.getMode() != WIFI_OFF)
+  {
+    WiFi.disconnect();  // Drop whatever the last attempt left half done
+  }
+
+  bool useLease = direct && reuseLease_ && saved_.ip != 0;
+  if (useLease)
+  {
+    WiFi.config(IPAddress(saved_.ip), IPAddress(saved_.gateway), IPAddress(saved_.subnet), IPAddress(saved_.dns));
+  }
+  else if (staticIp_)
+  {
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());  // Back to DHCP
+  }
+  staticIp_ = useLease;
+
+  if (direct)
+  {
+    WiFi.begin(ssid_, password_, saved_.channel, saved_.bssid);
+  }
+  else
+  {
+    WiFi.begin(ssid_, password_);
+  }
+}
+
+void WiFiLink::attemptFailed(const char *why)
+{
+  if (attemptDirect_)
+  {
+    // The AP may have moved channel or been replaced: look for the SSID
+    Serial.printf("Saved AP %s, scanning\n", why);
+    startAttempt(false);
+    return;
+  }
+
+  Serial.printf("WiFi connection failed (%s), retrying in %lu s\n", why, (unsigned long)retryDelay_ / 1000);
+  {
+    AllocGuardExempt driverCalls;
+    WiFi.disconnect();
+  }
+  state_ = LINK_DOWN;
+  retryAt_ = millis() + retryDelay_;
+  retryDelay_ = min(retryDelay_ * 2, RETRY_MAX_MS);
+}
+
+bool WiFiLink::update()
+{
+  LinkState before = state();
+  bool up = (WiFi.status() == WL_CONNECTED);
+
+  switch (before)
+  {
+    case LINK_CONNECTING:
+      if (up)
+      {
+        connectMs_ = millis() - attemptStartedAt_;
+        retryDelay_ = RETRY_MIN_MS;
+        state_ = LINK_UP;
+        rememberAp();
+      }
+      else if (millis() - attemptStartedAt_ >= (attemptDirect_ ? DIRECT_TIMEOUT_MS : SCAN_TIMEOUT_MS))
+      {
+        attemptFailed("did not answer");
+      }
+      break;
+
+    case LINK_UP:
+      if (!up)
+      {
+        Serial.println("WiFi link lost");
+        state_ = LINK_DOWN;
+        retryAt_ = millis() + RETRY_MIN_MS;
+        retryDelay_ = RETRY_MIN_MS * 2;
+      }
+      break;
+
+    default:
+      if (ssid_ && (long)(millis() - retryAt_) >= 0)
+      {
+        startAttempt(haveSaved_);  // A rebooted router usually comes back on the same channel
+      }
+      break;
+  }
+  return state() != before;
+}
+
+uint32_t WiFiLink::msUntilUpdate() const
+{
+  unsigned long elapsed = millis() - attemptStartedAt_;
+  switch (state())
+  {
+    case LINK_CONNECTING:
+    {
+      uint32_t timeout = attemptDirect_ ? DIRECT_TIMEOUT_MS : SCAN_TIMEOUT_MS;
+      return (elapsed >= timeout) ? 0 : (uint32_t)(timeout - elapsed);
+    }
+    case LINK_UP:
+      return UINT32_MAX;
+    default:
+    {
+      long untilRetry = (long)(retryAt_ - millis());
+      return (untilRetry <= 0) ? 0 : (uint32_t)untilRetry;
+    }
+  }
+}
+
+// Remember the AP we ended up on; saveAp() writes it out when it changed
+void WiFiLink::rememberAp()
+{
+  SavedAp ap;
+  memset(&ap, 0, sizeof(ap));
+  strncpy(ap.ssid, ssid_, sizeof(ap.ssid) - 1);
+  const uint8_t *bssid = WiFi.BSSID();
+  if (!bssid)
+  {
+    return;
+  }
+  memcpy(ap.bssid, bssid, sizeof(ap.bssid));
+  ap.channel = (uint8_t)WiFi.channel();
+  if (reuseLease_)
+  {
+    ap.ip = WiFi.localIP();
+    ap.gateway = WiFi.gatewayIP();
+    ap.subnet = WiFi.subnetMask();
+    ap.dns = WiFi.dnsIP();
+  }
+
+  if (haveSaved_ && memcmp(&ap, &saved_, sizeof(ap)) == 0)
+  {
+    return;
+  }
+  saved_ = ap;
+  haveSaved_ = true;
+  toSave_.write(ap);
+}
+
+void WiFiLink::saveAp()
+{
+  uint32_t version = toSave_.version();
+  if (version == savedVersion_)
+  {
+    return;
+  }
+  SavedAp ap;
+  if (!toSave_.read(ap, version))
+  {
+    return;  // Mid-write; the next link change brings us back
+  }
+  Preferences prefs;
+  prefs.begin(NVS_NAMESPACE, false);  // Read-write mode
+  prefs.putBytes(NVS_KEY, &ap, sizeof(ap));
+  prefs.end();
+  savedVersion_ = version;
+  Serial.printf("Saved AP %02x:%02x:%02x:%02x:%02x:%02x on channel %u for fast reconnects\n",
+                ap.bssid[0], ap.bssid[1], ap.bssid[2], ap.bssid[3], ap.bssid[4], ap.bssid[5], ap.channel);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// =============================================================================
+// WIFI LINK - Fast association and a supervisor that keeps the station up
+// =============================================================================
+// A plain WiFi.begin() scans every channel for the SSID before it associates,
+// and that scan is most of the time to an IP address. After each connection
+// the AP's BSSID and channel go to NVS, and the next attempt joins that AP on
+// that channel directly; only if it isn't there does the following attempt
+// scan. Optionally the DHCP lease is saved as well and reused as a static
+// configuration, which skips DHCP too. The NVS write happens on the network
+// task (saveAp()): it allocates and stalls on flash, and loop() must do
+// neither.
+//
+// update() runs on every loop() pass and never blocks. It times each attempt
+// out, notices when an established link drops, and associates again after
+// 1 s, 2 s, 4 s ... up to a minute, so a rebooting router is retried promptly
+// without being hammered. The driver's own auto-reconnect is turned off so
+// the two don't fight over the radio.
+
+#include <Arduino.h>
+#include <atomic>
+
+#include "seqlock.h"
+
+enum LinkState : uint8_t { LINK_CONNECTING, LINK_UP, LINK_DOWN };
+
+class WiFiLink
+{
+public:
+  // Start associating with `ssid`, straight to the remembered AP if there is
+  // one. With `reuseLease` the remembered DHCP lease is applied as a static
+  // IP; only safe when the router reserves that address for this device.
+  // The strings must outlive the link (they are the NVS configuration).
+  void begin(const char *ssid, const char *password, bool reuseLease);
+
+  // Erase the remembered AP and lease from NVS (factory reset)
+  static void forgetSavedAp();
+
+  // Follow the association; call on every loop() pass. True when state()
+  // changed on this call.
+  bool update();
+
+  // Network task: write the AP the link last came up on to NVS, if it changed
+  // since the last call. update() only notes it; loop() must not touch NVS.
+  void saveAp();
+
+  // Time until update() has something to do; UINT32_MAX while the link is up
+  // (a drop is noticed through the WiFi event that wakes loop())
+  uint32_t msUntilUpdate() const;
+
+  // Safe to read from any task
+  LinkState state() const { return (LinkState)state_.load(); }
+
+  // WiFi.begin() to IP address for the attempt that brought the link up, and
+  // whether it went straight to the remembered AP
+  uint32_t connectMs() const { return connectMs_; }
+  bool connectedDirect() const { return attemptDirect_; }
+
+private:
+  // What NVS keeps about the last AP, for the SSID it was found with
+  struct SavedAp
+  {
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;       // DHCP lease, 0 if none saved
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+  };
+
+  void startAttempt(bool direct);
+  void attemptFailed(const char *why);
+  void rememberAp();
+
+  const char *ssid_ = nullptr;
+  const char *password_ = nullptr;
+  bool reuseLease_ = false;
+  SavedAp saved_ = {};
+  bool haveSaved_ = false;
+  SeqLock<SavedAp> toSave_;       // rememberAp() to saveAp()
+  uint32_t savedVersion_ = 0;     // toSave_ version already in NVS
+
+  std::atomic<uint8_t> state_{LINK_DOWN};
+  bool attemptDirect_ = false;
+  bool staticIp_ = false;    // The station is configured with the saved lease
+  unsigned long attemptStartedAt_ = 0;
+  unsigned long retryAt_ = 0;
+  uint32_t retryDelay_ = 0;  // Next backoff step
+  uint32_t connectMs_ = 0;
+};
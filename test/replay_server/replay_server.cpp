@@ -0,0 +1,539 @@
+// =============================================================================
+// REPLAY SERVER - Recorded AccuWeather responses over plain HTTP, with faults
+// =============================================================================
+// Stands in for dataservice.accuweather.com on the local network, so fetch and
+// parse times can be measured on the device (its /metrics page) and bad
+// responses reproduced without touching the live API. Point the firmware at it
+// with an http:// weather server: -DWEATHER_BASE_URL=\"http://<host>:8080\" or
+// the setup portal's weather server field.
+//
+// Serves the same recordings as the simulator (test/fixtures):
+//   /locations/v1/postalcodes/search...  location.json
+//   /forecasts/v1/daily/5day/...         forecast_5day.json, or
+//                                        forecast_5day.msgpack to a client
+//                                        that accepts application/msgpack
+// Anything else gets a 404. Query strings and the Authorization header are
+// ignored.
+//
+// Build and run (Linux or macOS):
+//   g++ -std=c++17 -O2 -pthread test/replay_server/replay_server.cpp -o replay_server
+//   ./replay_server --latency 400 --jitter 200 --throttle 4000
+//
+// Options:
+//   --port N            Listen on port N (8080)
+//   --fixtures DIR      Recordings directory (test/fixtures)
+//   --latency MS        Wait before sending the response headers (0)
+//   --jitter MS         Plus a random 0..MS on top of that (0)
+//   --throttle BPS      Send the body at BPS bytes per second (0: full speed)
+//   --truncate N        Close the connection after N body bytes; the headers
+//                       still announce the whole body (off)
+//   --truncate-every K  Only truncate every Kth response (1)
+//   --rate-limit N      Answer 503 like AccuWeather's quota once more than N
+//                       requests came in the last minute (off)
+//   --etag              Send an ETag and answer If-None-Match with 304
+//   --max-age S         Cache-Control max-age on responses (0)
+//   --json-only         Never send MessagePack, like AccuWeather itself
+//
+// Connections are kept alive when the client asks (HTTP/1.0 keep-alive, as
+// the firmware sends) or doesn't refuse (HTTP/1.1), one thread each.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+struct Options
+{
+  uint16_t port = 8080;
+  std::string fixturesDir = "test/fixtures";
+  uint32_t latencyMs = 0;
+  uint32_t jitterMs = 0;
+  uint32_t throttleBps = 0;
+  long truncateBytes = -1;  // Off if negative
+  uint32_t truncateEvery = 1;
+  uint32_t rateLimit = 0;   // Requests per minute; off if 0
+  bool etag = false;
+  uint32_t maxAge = 0;
+  bool jsonOnly = false;
+};
+
+struct Representation
+{
+  std::string body;
+  std::string etag;
+};
+
+struct Fixture
+{
+  const char *match;        // Substring of the request path that selects it
+  const char *file;
+  const char *msgpackFile;  // The same as MessagePack, if there is one
+  Representation json;
+  Representation msgpack;
+};
+
+const uint32_t IDLE_TIMEOUT_S = 30;     // Close a kept-alive connection idle this long
+const uint32_t THROTTLE_TICK_MS = 50;   // Throttled bodies go out in slices this often
+const size_t MAX_REQUEST_HEADER = 8192;
+
+Options options;
+Fixture fixtures[] = {
+    {"/locations/v1/postalcodes/search", "location.json", nullptr, {}, {}},
+    {"/forecasts/v1/daily/5day/", "forecast_5day.json", "forecast_5day.msgpack", {}, {}},
+};
+
+std::atomic<uint32_t> requestCount{0};
+std::atomic<uint32_t> okCount{0};  // 200s, counted for --truncate-every
+std::mutex rateMutex;
+std::deque<std::chrono::steady_clock::time_point> recentRequests;
+std::mutex randomMutex;
+std::mt19937 randomEngine{std::random_device{}()};
+
+bool parseUint(const char *text, uint32_t &out)
+{
+  char *end;
+  unsigned long value = strtoul(text, &end, 10);
+  if (end == text || *end != '\0' || value > UINT32_MAX)
+  {
+    return false;
+  }
+  out = (uint32_t)value;
+  return true;
+}
+
+bool parseOptions(int argc, char **argv)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    if (arg == "--etag")
+    {
+      options.etag = true;
+      continue;
+    }
+    if (arg == "--json-only")
+    {
+      options.jsonOnly = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      fprintf(stderr, "missing value for %s\n", arg.c_str());
+      return false;
+    }
+    const char *value = argv[++i];
+    bool ok = true;
+    if (arg == "--port")
+    {
+      uint32_t port = 0;
+      ok = parseUint(value, port) && port > 0 && port <= 65535;
+      options.port = (uint16_t)port;
+    }
+    else if (arg == "--fixtures") options.fixturesDir = value;
+    else if (arg == "--latency") ok = parseUint(value, options.latencyMs);
+    else if (arg == "--jitter") ok = parseUint(value, options.jitterMs);
+    else if (arg == "--throttle") ok = parseUint(value, options.throttleBps);
+    else if (arg == "--truncate")
+    {
+      uint32_t bytes = 0;
+      ok = parseUint(value, bytes);
+      options.truncateBytes = (long)bytes;
+    }
+    else if (arg == "--truncate-every") ok = parseUint(value, options.truncateEvery) && options.truncateEvery > 0;
+    else if (arg == "--rate-limit") ok = parseUint(value, options.rateLimit);
+    else if (arg == "--max-age") ok = parseUint(value, options.maxAge);
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", arg.c_str());
+      return false;
+    }
+    if (!ok)
+    {
+      fprintf(stderr, "bad value for %s: %s\n", arg.c_str(), value);
+      return false;
+    }
+  }
+  return true;
+}
+
+// FNV-1a of the body, quoted, as a strong ETag
+std::string etagOf(const std::string &body)
+{
+  uint64_t hash = 1469598103934665603ULL;
+  for (unsigned char c : body)
+  {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  char text[24];
+  snprintf(text, sizeof(text), "\"%016llx\"", (unsigned long long)hash);
+  return text;
+}
+
+// As a JSON string literal, quotes included
+void writeJsonString(const std::string &text, std::string &out)
+{
+  out += '"';
+  for (unsigned char c : text)
+  {
+    if (c == '"' || c == '\\')
+    {
+      out += '\\';
+      out += (char)c;
+    }
+    else if (c < 0x20)
+    {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out += escaped;
+    }
+    else
+    {
+      out += (char)c;
+    }
+  }
+  out += '"';
+}
+
+bool loadRepresentation(const char *file, Representation &out)
+{
+  std::string path = options.fixturesDir + "/" + file;
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    fprintf(stderr, "cannot read %s\n", path.c_str());
+    return false;
+  }
+  std::ostringstream body;
+  body << in.rdbuf();
+  out.body = body.str();
+  out.etag = etagOf(out.body);
+  return true;
+}
+
+bool loadFixtures()
+{
+  for (Fixture &fixture : fixtures)
+  {
+    if (!loadRepresentation(fixture.file, fixture.json) ||
+        (fixture.msgpackFile && !options.jsonOnly && !loadRepresentation(fixture.msgpackFile, fixture.msgpack)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Whether this request is over --rate-limit for the last minute
+bool overRateLimit()
+{
+  if (options.rateLimit == 0)
+  {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(rateMutex);
+  auto now = std::chrono::steady_clock::now();
+  while (!recentRequests.empty() && now - recentRequests.front() >= std::chrono::minutes(1))
+  {
+    recentRequests.pop_front();
+  }
+  recentRequests.push_back(now);
+  return recentRequests.size() > options.rateLimit;
+}
+
+uint32_t headerDelayMs()
+{
+  uint32_t delayMs = options.latencyMs;
+  if (options.jitterMs > 0)
+  {
+    std::lock_guard<std::mutex> lock(randomMutex);
+    delayMs += std::uniform_int_distribution<uint32_t>(0, options.jitterMs)(randomEngine);
+  }
+  return delayMs;
+}
+
+std::string lower(std::string text)
+{
+  std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)tolower(c); });
+  return text;
+}
+
+// Value of a request header, empty if absent. `headers` is the block after
+// the request line; names match case-insensitively.
+std::string headerValue(const std::string &headers, const char *name)
+{
+  std::istringstream lines(headers);
+  std::string line;
+  std::string wanted = lower(name) + ":";
+  while (std::getline(lines, line))
+  {
+    if (lower(line.substr(0, wanted.size())) == wanted)
+    {
+      size_t start = line.find_first_not_of(' ', wanted.size());
+      size_t end = line.find_last_not_of("\r ");
+      return (start == std::string::npos || end < start) ? "" : line.substr(start, end - start + 1);
+    }
+  }
+  return "";
+}
+
+std::string httpDate()
+{
+  char text[40];
+  time_t now = time(nullptr);
+  struct tm utc;
+  gmtime_r(&now, &utc);
+  strftime(text, sizeof(text), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+  return text;
+}
+
+bool sendAll(int fd, const char *data, size_t len)
+{
+  while (len > 0)
+  {
+    ssize_t sent = send(fd, data, len, 0);
+    if (sent <= 0)
+    {
+      return false;
+    }
+    data += sent;
+    len -= (size_t)sent;
+  }
+  return true;
+}
+
+// Body at --throttle's rate, stopping after `limit` bytes. False if the
+// client went away.
+bool sendBody(int fd, const std::string &body, size_t limit)
+{
+  size_t len = std::min(limit, body.size());
+  if (options.throttleBps == 0)
+  {
+    return sendAll(fd, body.data(), len);
+  }
+  size_t slice = std::max<size_t>(1, (size_t)options.throttleBps * THROTTLE_TICK_MS / 1000);
+  for (size_t offset = 0; offset < len; offset += slice)
+  {
+    if (!sendAll(fd, body.data() + offset, std::min(slice, len - offset)))
+    {
+      return false;
+    }
+    if (offset + slice < len)
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(THROTTLE_TICK_MS));
+    }
+  }
+  return true;
+}
+
+// Read one request's line and headers into `request`. Anything read past
+// them stays in `buffer` for the next request on the connection.
+bool readRequest(int fd, std::string &buffer, std::string &request)
+{
+  size_t end;
+  while ((end = buffer.find("\r\n\r\n")) == std::string::npos)
+  {
+    if (buffer.size() > MAX_REQUEST_HEADER)
+    {
+      return false;
+    }
+    char chunk[1024];
+    ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+    if (got <= 0)
+    {
+      return false;  // Closed, or idle past IDLE_TIMEOUT_S
+    }
+    buffer.append(chunk, (size_t)got);
+  }
+  request = buffer.substr(0, end + 2);
+  buffer.erase(0, end + 4);
+  return true;
+}
+
+// Answer one request. Returns false once the connection is to be closed.
+bool serveRequest(int fd, const std::string &request)
+{
+  auto startTime = std::chrono::steady_clock::now();
+  uint32_t number = ++requestCount;
+
+  std::string requestLine = request.substr(0, request.find("\r\n"));
+  std::string headers = request.substr(requestLine.size() + 2);
+  char method[16] = "";
+  char target[2048] = "";
+  char version[16] = "";
+  sscanf(requestLine.c_str(), "%15s %2047s %15s", method, target, version);
+  std::string path = target;
+
+  // Kept alive if the client asks (1.0) or doesn't refuse (1.1)
+  std::string connection = lower(headerValue(headers, "Connection"));
+  bool http11 = strcmp(version, "HTTP/1.1") == 0;
+  bool keepAlive = http11 ? connection != "close" : connection == "keep-alive";
+
+  int status = 200;
+  const char *reason = "OK";
+  std::string body;
+  const Fixture *fixture = nullptr;
+  const Representation *representation = nullptr;
+  bool msgpack = false;
+  if (strcmp(method, "GET") != 0)
+  {
+    status = 405;
+    reason = "Method Not Allowed";
+  }
+  else if (overRateLimit())
+  {
+    // What AccuWeather sends once the key's quota is used up
+    status = 503;
+    reason = "Service Unavailable";
+    body = "{\"Code\":\"ServiceUnavailable\",\"Message\":\"The allowed number of requests has been exceeded.\","
+           "\"Reference\":";
+    writeJsonString(path, body);  // The path is the client's, quotes and all
+    body += '}';
+  }
+  else
+  {
+    for (const Fixture &candidate : fixtures)
+    {
+      if (path.find(candidate.match) != std::string::npos)
+      {
+        fixture = &candidate;
+      }
+    }
+    if (!fixture)
+    {
+      status = 404;
+      reason = "Not Found";
+      body = "{\"Code\":\"ResourceNotFound\",\"Message\":\"Api Authorization failed\",\"Reference\":";
+      writeJsonString(path, body);
+      body += '}';
+    }
+    else
+    {
+      // No q-value ranking: a client that names MessagePack at all gets it
+      msgpack = !fixture->msgpack.body.empty() && headerValue(headers, "Accept").find("application/msgpack") !=
+                                                      std::string::npos;
+      representation = msgpack ? &fixture->msgpack : &fixture->json;
+      if (options.etag && headerValue(headers, "If-None-Match") == representation->etag)
+      {
+        status = 304;
+        reason = "Not Modified";
+      }
+      else
+      {
+        body = representation->body;
+      }
+    }
+  }
+
+  // Every --truncate-every'th 200 is cut short
+  long truncateAt = -1;
+  if (status == 200 && options.truncateBytes >= 0 && ++okCount % options.truncateEvery == 0)
+  {
+    truncateAt = std::min<long>(options.truncateBytes, (long)body.size());
+    keepAlive = false;
+  }
+
+  std::string response = std::string(http11 ? "HTTP/1.1 " : "HTTP/1.0 ") + std::to_string(status) + " " + reason +
+                          "\r\nDate: " + httpDate() +
+                          "\r\nContent-Type: " + (msgpack ? "application/msgpack" : "application/json; charset=utf-8") +
+                          "\r\nContent-Length: " + std::to_string(body.size()) +
+                          "\r\nCache-Control: max-age=" + std::to_string(options.maxAge);
+  if (representation && options.etag)
+  {
+    response += "\r\nETag: " + representation->etag;
+  }
+  if (fixture && fixture->msgpackFile)
+  {
+    response += "\r\nVary: Accept";
+  }
+  if (status == 503)
+  {
+    response += "\r\nRetry-After: 60";
+  }
+  response += keepAlive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+
+  uint32_t delayMs = headerDelayMs();
+  std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+  bool sent = sendAll(fd, response.data(), response.size()) &&
+              sendBody(fd, body, truncateAt >= 0 ? (size_t)truncateAt : body.size());
+
+  auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime);
+  printf("[replay] #%u %s %s -> %d, %zu bytes%s, headers after %u ms, done in %lld ms%s%s\n", number, method,
+         path.c_str(), status, truncateAt >= 0 ? (size_t)truncateAt : body.size(), msgpack ? " MessagePack" : "",
+         delayMs, (long long)elapsedMs.count(), truncateAt >= 0 ? " (truncated)" : "",
+         sent ? "" : " (client went away)");
+  fflush(stdout);
+  return sent && keepAlive;
+}
+
+void serveConnection(int fd)
+{
+  timeval timeout = {IDLE_TIMEOUT_S, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  std::string buffer;
+  std::string request;
+  while (readRequest(fd, buffer, request) && serveRequest(fd, request))
+  {
+  }
+  close(fd);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (!parseOptions(argc, argv) || !loadFixtures())
+  {
+    return 2;
+  }
+  signal(SIGPIPE, SIG_IGN);  // A client closing mid-body is a failed send, not the end of the server
+
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  int reuse = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons(options.port);
+  if (listener < 0 || bind(listener, (sockaddr *)&address, sizeof(address)) < 0 || listen(listener, 16) < 0)
+  {
+    perror("replay server");
+    return 1;
+  }
+  printf("[replay] serving %s on port %u: latency %u+%u ms, throttle %u B/s, truncate %ld every %u, "
+         "rate limit %u/min%s%s\n",
+         options.fixturesDir.c_str(), (unsigned)options.port, options.latencyMs, options.jitterMs,
+         options.throttleBps, options.truncateBytes, options.truncateEvery, options.rateLimit,
+         options.etag ? ", ETag" : "", options.jsonOnly ? ", JSON only" : "");
+  fflush(stdout);
+
+  for (;;)
+  {
+    int fd = accept(listener, nullptr, nullptr);
+    if (fd < 0)
+    {
+      continue;
+    }
+    std::thread(serveConnection, fd).detach();
+  }
+}
@@ -0,0 +1,130 @@
+"""
+Expand the 1-bit bitmaps in src/icons.h into run-length blit streams.
+
+Each icon becomes alternating background/foreground run lengths (background
+first, one byte each, a 255 run followed by a 0 run when a run is longer) over
+the whole icon in row-major order, which is what blitIcon() streams into a
+single address window. The output is icons_rle.h, with weather_allArray_rle[]
+in the same order as weather_allArray[].
+
+Runs as a PlatformIO pre-build script (writes into the build directory and
+adds it to the include path), or standalone:
+
+    python tools/icon_rle.py src/icons.h icons_rle.h
+"""
+
+import os
+import re
+import sys
+
+ICON_RE = re.compile(
+    r"//\s*'([^']+)',\s*(\d+)x(\d+)px\s*\n"
+    r"\s*const\s+unsigned\s+char\s+(\w+)\s*\[\]\s*PROGMEM\s*=\s*\{([^}]*)\}",
+    re.S,
+)
+ALL_ARRAY_RE = re.compile(r"weather_allArray\s*\[\s*\d+\s*\]\s*=\s*\{([^}]*)\}", re.S)
+
+
+def parse_icons(text):
+    icons = {}
+    for match in ICON_RE.finditer(text):
+        _, width, height, name, body = match.groups()
+        data = [int(v, 16) for v in re.findall(r"0x[0-9a-fA-F]{2}", body)]
+        icons[name] = (int(width), int(height), data)
+
+    order_match = ALL_ARRAY_RE.search(text)
+    if not order_match:
+        raise ValueError("weather_allArray not found")
+    order = re.findall(r"\w+", order_match.group(1))
+    missing = [name for name in order if name not in icons]
+    if missing:
+        raise ValueError("weather_allArray lists unknown icons: " + ", ".join(missing))
+    return icons, order
+
+
+def encode(width, height, data):
+    """Run lengths over the icon; bytes are MSB-first rows padded to whole bytes,
+    the layout Adafruit_GFX::drawBitmap() reads."""
+    stride = (width + 7) // 8
+    if len(data) != stride * height:
+        raise ValueError("bitmap size does not match %dx%d" % (width, height))
+
+    runs = []
+    current = 0  # Streams start with a background run
+    length = 0
+    for y in range(height):
+        for x in range(width):
+            bit = (data[y * stride + x // 8] >> (7 - (x & 7))) & 1
+            if bit != current:
+                runs.append(length)
+                current = bit
+                length = 0
+            length += 1
+            if length == 255:
+                # Full run; a zero run of the other colour keeps the alternation
+                runs.extend([255, 0])
+                length = 0
+    runs.append(length)
+    return runs
+
+
+def generate(icons_path):
+    with open(icons_path) as f:
+        icons, order = parse_icons(f.read())
+
+    out = [
+        "#pragma once",
+        "",
+        "// Generated by tools/icon_rle.py from src/icons.h - do not edit",
+        "",
+        '#include "icon_blit.h"',
+        "",
+    ]
+    total = 0
+    for name in order:
+        width, height, data = icons[name]
+        runs = encode(width, height, data)
+        total += len(runs)
+        out.append("// %s, %dx%d, %d runs" % (name, width, height, len(runs)))
+        out.append("static const uint8_t %s_runs[] PROGMEM = {" % name)
+        for i in range(0, len(runs), 16):
+            out.append("\t" + ", ".join("%d" % v for v in runs[i:i + 16]) + ",")
+        out.append("};")
+        out.append("")
+
+    out.append("// Same order as weather_allArray (%d bytes of runs in total)" % total)
+    out.append("static const IconRle weather_allArray_rle[%d] = {" % len(order))
+    for name in order:
+        width, height, _ = icons[name]
+        out.append("\t{%d, %d, sizeof(%s_runs), %s_runs}," % (width, height, name, name))
+    out.append("};")
+    out.append("")
+    return "\n".join(out)
+
+
+def write_if_changed(path, text):
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    os.makedirs(os.path.dirname(os.path.abspath(path)), exist_ok=True)
+    with open(path, "w") as f:
+        f.write(text)
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+except NameError:
+    env = None
+
+if env is not None:
+    gen_dir = os.path.join(env.subst("$BUILD_DIR"), "generated")
+    write_if_changed(
+        os.path.join(gen_dir, "icons_rle.h"),
+        generate(os.path.join(env.subst("$PROJECT_SRC_DIR"), "icons.h")),
+    )
+    env.Append(CPPPATH=[gen_dir])
+elif __name__ == "__main__":
+    if len(sys.argv) != 3:
+        sys.exit("usage: icon_rle.py ICONS_H OUTPUT_H")
+    write_if_changed(sys.argv[2], generate(sys.argv[1]))
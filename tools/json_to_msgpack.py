@@ -0,0 +1,107 @@
+"""
+Convert a recorded JSON response to MessagePack, for the MessagePack forecast
+path (fetchForecast() asks for application/msgpack first).
+
+    python tools/json_to_msgpack.py test/fixtures/forecast_5day.json test/fixtures/forecast_5day.msgpack
+
+The simulator (--msgpack) and test/replay_server serve the result to clients
+that accept it. Keys keep their order. Integers take the smallest encoding;
+floats are float32 when that holds the value exactly (as ArduinoJson's
+serializeMsgPack() does), else float64.
+"""
+
+import json
+import struct
+import sys
+
+
+def pack(value, out):
+    if value is None:
+        out.append(0xC0)
+    elif value is True:
+        out.append(0xC3)
+    elif value is False:
+        out.append(0xC2)
+    elif isinstance(value, int):
+        pack_int(value, out)
+    elif isinstance(value, float):
+        if struct.unpack(">f", struct.pack(">f", value))[0] == value:
+            out += b"\xCA" + struct.pack(">f", value)
+        else:
+            out += b"\xCB" + struct.pack(">d", value)
+    elif isinstance(value, str):
+        data = value.encode("utf-8")
+        if len(data) < 32:
+            out.append(0xA0 | len(data))
+        elif len(data) < 0x100:
+            out += b"\xD9" + struct.pack(">B", len(data))
+        elif len(data) < 0x10000:
+            out += b"\xDA" + struct.pack(">H", len(data))
+        else:
+            out += b"\xDB" + struct.pack(">I", len(data))
+        out += data
+    elif isinstance(value, list):
+        pack_length(len(value), 0x90, 0xDC, out)
+        for item in value:
+            pack(item, out)
+    elif isinstance(value, dict):
+        pack_length(len(value), 0x80, 0xDE, out)
+        for key, item in value.items():
+            pack(key, out)
+            pack(item, out)
+    else:
+        raise TypeError("cannot pack %r" % (value,))
+
+
+def pack_int(value, out):
+    if 0 <= value < 0x80:
+        out.append(value)
+    elif -32 <= value < 0:
+        out.append(value & 0xFF)
+    elif 0 <= value < 0x100:
+        out += b"\xCC" + struct.pack(">B", value)
+    elif 0 <= value < 0x10000:
+        out += b"\xCD" + struct.pack(">H", value)
+    elif 0 <= value < 0x100000000:
+        out += b"\xCE" + struct.pack(">I", value)
+    elif value >= 0:
+        out += b"\xCF" + struct.pack(">Q", value)
+    elif value >= -0x80:
+        out += b"\xD0" + struct.pack(">b", value)
+    elif value >= -0x8000:
+        out += b"\xD1" + struct.pack(">h", value)
+    elif value >= -0x80000000:
+        out += b"\xD2" + struct.pack(">i", value)
+    else:
+        out += b"\xD3" + struct.pack(">q", value)
+
+
+# fixarray/fixmap up to 15 entries, else the 16-bit form (32-bit would be next)
+def pack_length(length, fix, wide, out):
+    if length < 16:
+        out.append(fix | length)
+    else:
+        out += struct.pack(">BH", wide, length)
+
+
+def main(argv):
+    if len(argv) != 3:
+        print("usage: python tools/json_to_msgpack.py IN.json OUT.msgpack", file=sys.stderr)
+        return 2
+    with open(argv[1], "rb") as f:
+        text = f.read()
+    value = json.loads(text)
+
+    out = bytearray()
+    pack(value, out)
+    with open(argv[2], "wb") as f:
+        f.write(out)
+
+    compact = json.dumps(value, separators=(",", ":"), ensure_ascii=False).encode("utf-8")
+    print("%s: %d bytes; JSON %d as recorded, %d without whitespace" % (argv[2], len(out), len(text),
+                                                                      len(compact)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
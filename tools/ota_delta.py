@@ -0,0 +1,229 @@
+"""
+Make a delta patch from one firmware image to the next, for delta OTA.
+
+The device rebuilds the new image from the one it is running plus the patch
+(src/delta_ota.cpp), so an update that only moves or touches some of the code
+downloads a fraction of firmware.bin. A release ships one patch per recent
+version, named after the version it applies to:
+
+    python tools/ota_delta.py firmware-1.0.2.bin firmware.bin delta-1.0.2.bin
+
+The patch is applied back to the old image before it is written, and the
+result must come out byte for byte as the new one.
+
+Format (little-endian), as read by delta_ota.cpp:
+
+    header   u32 magic "WSD1", u32 source size, 32-byte source SHA-256,
+             u32 target size, 32-byte target SHA-256
+    commands until the target is complete, each starting with a varint
+             (LEB128) of length << 1 | kind:
+      DATA   kind 0: `length` literal bytes follow
+      COPY   kind 1: zigzag varint of the source offset relative to where the
+             previous COPY ended, varint edit count, then per edit a varint
+             of unchanged bytes to skip, a varint count and `count`
+             replacement bytes. Bytes after the last edit are copied as is.
+
+Matching follows bsdiff: exact seeds found through a hash of source windows,
+then grown forwards while most bytes still agree. Code that moved keeps its
+alignment through the scattered address changes, which become edits.
+"""
+
+import hashlib
+import struct
+import sys
+
+MAGIC = 0x31445357  # "WSD1"
+HEADER = struct.Struct("<I I 32s I 32s")
+
+SEED = 16           # Bytes that must match exactly to start a COPY
+INDEX_STEP = 4      # Source windows are indexed at every 4th offset
+GIVE_UP = 64        # Stop growing a COPY this far past its best score
+EDIT_MERGE_GAP = 3  # Equal runs shorter than this are cheaper inside an edit
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def index_source(source):
+    index = {}
+    for offset in range(0, len(source) - SEED + 1, INDEX_STEP):
+        index.setdefault(source[offset:offset + SEED], offset)
+    return index
+
+
+def grow(source, target, t, s):
+    """Length of the COPY from target[t] / source[s] that scores best, counting
+    +1 for each agreeing byte and -1 for each that needs an edit."""
+    limit = min(len(target) - t, len(source) - s)
+    score = best_score = best_length = 0
+    for k in range(limit):
+        score += 1 if target[t + k] == source[s + k] else -1
+        if score > best_score:
+            best_score, best_length = score, k + 1
+        elif score < best_score - GIVE_UP:
+            break
+    return best_length
+
+
+def edits(source, target, t, s, length):
+    """(skip, replacement bytes) runs where the target differs from the source"""
+    runs = []
+    k = 0
+    while k < length:
+        if target[t + k] == source[s + k]:
+            k += 1
+            continue
+        start = end = k
+        while end < length:
+            if target[t + end] != source[s + end]:
+                end += 1
+                continue
+            gap = end
+            while gap < length and gap - end < EDIT_MERGE_GAP and target[t + gap] == source[s + gap]:
+                gap += 1
+            if gap < length and gap - end < EDIT_MERGE_GAP:
+                end = gap  # Short equal run: fold it into this edit
+            else:
+                break
+        runs.append((start, target[t + start:t + end]))
+        k = end
+    return runs
+
+
+def make_patch(source, target):
+    index = index_source(source)
+    commands = bytearray()
+    literal_start = 0
+    source_end = 0  # Where the previous COPY ended in the source
+    diagonal = 0    # Source offset minus target offset of the previous COPY
+    t = 0
+
+    def emit_data(end):
+        if end > literal_start:
+            commands.extend(varint((end - literal_start) << 1))
+            commands.extend(target[literal_start:end])
+
+    while t + SEED <= len(target):
+        window = target[t:t + SEED]
+        s = t + diagonal
+        if not (0 <= s and s + SEED <= len(source) and source[s:s + SEED] == window):
+            s = index.get(window)
+            if s is None:
+                t += 1
+                continue
+
+        # Take back bytes that also match just before the seed
+        while t > literal_start and s > 0 and target[t - 1] == source[s - 1]:
+            t -= 1
+            s -= 1
+
+        length = grow(source, target, t, s)
+        emit_data(t)
+
+        runs = edits(source, target, t, s, length)
+        commands.extend(varint(length << 1 | 1))
+        commands.extend(varint(zigzag(s - source_end)))
+        commands.extend(varint(len(runs)))
+        position = 0
+        for start, data in runs:
+            commands.extend(varint(start - position))
+            commands.extend(varint(len(data)))
+            commands.extend(data)
+            position = start + len(data)
+
+        source_end = s + length
+        diagonal = s - t
+        t += length
+        literal_start = t
+
+    emit_data(len(target))
+    header = HEADER.pack(MAGIC, len(source), hashlib.sha256(source).digest(),
+                         len(target), hashlib.sha256(target).digest())
+    return header + bytes(commands)
+
+
+def apply_patch(source, patch):
+    """Reference applier, to check a patch before it ships"""
+    magic, source_size, source_sha, target_size, target_sha = HEADER.unpack_from(patch)
+    if magic != MAGIC or source_size != len(source) or hashlib.sha256(source).digest() != source_sha:
+        raise ValueError("patch does not apply to this source")
+
+    position = HEADER.size
+
+    def read_varint():
+        nonlocal position
+        value = shift = 0
+        while True:
+            byte = patch[position]
+            position += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                return value
+
+    def read_bytes(count):
+        nonlocal position
+        data = patch[position:position + count]
+        position += count
+        return data
+
+    target = bytearray()
+    source_end = 0
+    while len(target) < target_size:
+        command = read_varint()
+        length = command >> 1
+        if not command & 1:
+            target += read_bytes(length)
+            continue
+        delta = read_varint()
+        s = source_end + ((delta >> 1) ^ -(delta & 1))
+        copied = bytearray(source[s:s + length])
+        k = 0
+        for _ in range(read_varint()):
+            k += read_varint()
+            count = read_varint()
+            copied[k:k + count] = read_bytes(count)
+            k += count
+        target += copied
+        source_end = s + length
+
+    if len(target) != target_size or hashlib.sha256(target).digest() != target_sha:
+        raise ValueError("patch did not rebuild the target")
+    return bytes(target)
+
+
+def main(argv):
+    if len(argv) != 4:
+        print("usage: python tools/ota_delta.py OLD.bin NEW.bin PATCH.bin", file=sys.stderr)
+        return 2
+    with open(argv[1], "rb") as f:
+        source = f.read()
+    with open(argv[2], "rb") as f:
+        target = f.read()
+
+    patch = make_patch(source, target)
+    if apply_patch(source, patch) != target:
+        raise SystemExit("patch does not rebuild the target")
+    with open(argv[3], "wb") as f:
+        f.write(patch)
+
+    print("%s: %d bytes for a %d byte image (%.1f%%)" % (argv[3], len(patch), len(target),
+                                                        100.0 * len(patch) / max(len(target), 1)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))